@@ -0,0 +1,59 @@
+#include "AiScheduler.h"
+#include "ofMain.h"
+
+AiTask& AiTask::operator=(AiTask&& other) noexcept {
+    if (this != &other) {
+        if (m_handle) m_handle.destroy();
+        m_handle = std::exchange(other.m_handle, {});
+    }
+    return *this;
+}
+
+AiTask::~AiTask() {
+    if (m_handle) m_handle.destroy();
+}
+
+int AiTask::resume() {
+    if (this->isDone()) return 1;
+    m_handle.promise().sleepTicks = 1;
+    m_handle.resume();
+    return m_handle.promise().sleepTicks;
+}
+
+
+void AiScheduler::setBudget(int maxDecisions, double maxMicros) {
+    m_maxDecisions = std::max(1, maxDecisions);
+    m_maxMicros = std::max(0.0, maxMicros);
+}
+
+void AiScheduler::beginTick() {
+    m_tick++;
+    m_due.clear();
+}
+
+void AiScheduler::offer(AiBrain& brain, uint32_t order) {
+    if (brain.task.isDone() || brain.wakeTick > m_tick) return;
+    m_due.push_back(Due{brain.wakeTick, order, &brain});
+}
+
+void AiScheduler::run() {
+    uint64_t start = ofGetElapsedTimeMicros();
+    // only the ones that fit need to be in order
+    size_t take = std::min(m_due.size(), static_cast<size_t>(m_maxDecisions));
+    std::partial_sort(m_due.begin(), m_due.begin() + take, m_due.end(), [](const Due& a, const Due& b) {
+        return a.wakeTick != b.wakeTick ? a.wakeTick < b.wakeTick : a.order < b.order;
+    });
+
+    size_t done = 0;
+    for (; done < take; ++done) {
+        // checked before each decision so one decision always gets through
+        if (m_maxMicros > 0 && done > 0 && ofGetElapsedTimeMicros() - start >= m_maxMicros) break;
+        AiBrain& brain = *m_due[done].brain;
+        brain.wakeTick = m_tick + brain.task.resume();
+    }
+    // the rest keep their wake tick, so they are the oldest next tick
+
+    m_lastDecisions = static_cast<int>(done);
+    m_lastDeferred = static_cast<int>(m_due.size() - done);
+    m_lastMicros = static_cast<double>(ofGetElapsedTimeMicros() - start);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <utility>
+#include <vector>
+
+// Creature behaviors are C++20 coroutines. A behavior loops forever: it makes one
+// decision (pick a prey, work out a steering vector) and then sleeps with
+//     co_await AiSleep{ticks};
+// The AiScheduler wakes the behaviors that are due, the longest waiting first, until
+// the tick's budget runs out. Whatever doesn't fit waits for the next tick, so the
+// cost of thinking stays bounded however many creatures there are. Applying the
+// decision and moving are cheap and still happen every tick in Aquarium::update.
+class AiTask {
+public:
+    struct promise_type {
+        int sleepTicks = 1; // set by AiSleep when the behavior suspends
+        AiTask get_return_object() { return AiTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; } // the first decision waits for the scheduler
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    AiTask() = default;
+    AiTask(AiTask&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    AiTask& operator=(AiTask&& other) noexcept;
+    AiTask(const AiTask&) = delete;
+    AiTask& operator=(const AiTask&) = delete;
+    ~AiTask();
+
+    bool isValid() const { return static_cast<bool>(m_handle); }
+    bool isDone() const { return !m_handle || m_handle.done(); }
+    // runs the behavior up to its next sleep, returns how many ticks it wants to sleep
+    int resume();
+
+private:
+    explicit AiTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+struct AiSleep {
+    int ticks = 1;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<AiTask::promise_type> handle) const noexcept {
+        handle.promise().sleepTicks = std::max(1, ticks);
+    }
+    void await_resume() const noexcept {}
+};
+
+// A creature's behavior and the tick it wants to run again
+struct AiBrain {
+    AiTask task;
+    uint32_t wakeTick = 0;
+};
+
+class AiScheduler {
+public:
+    // At most maxDecisions behaviors resume per tick. maxMicros > 0 also stops once a
+    // tick has spent that long thinking; that follows the machine's speed, so leave it
+    // at 0 where runs have to repeat exactly (replays, the multiplayer server).
+    void setBudget(int maxDecisions, double maxMicros);
+    int getMaxDecisions() const { return m_maxDecisions; }
+    double getMaxMicros() const { return m_maxMicros; }
+
+    uint32_t getTick() const { return m_tick; }
+    // advances the clock and forgets last tick's due list
+    void beginTick();
+    // offers a brain for this tick, it is only kept when due. order breaks ties between
+    // brains that are equally late, use something stable like the creature id
+    void offer(AiBrain& brain, uint32_t order);
+    // resumes the due brains, longest waiting first, within the budget. The brains
+    // offered this tick must stay alive until it returns
+    void run();
+
+    int getLastDecisions() const { return m_lastDecisions; }
+    int getLastDeferred() const { return m_lastDeferred; } // due but left for a later tick
+    double getLastMicros() const { return m_lastMicros; }
+
+private:
+    struct Due {
+        uint32_t wakeTick;
+        uint32_t order;
+        AiBrain* brain;
+    };
+    std::vector<Due> m_due; // reused every tick
+    uint32_t m_tick = 0;
+    int m_maxDecisions = 2048;
+    double m_maxMicros = 0.0;
+    int m_lastDecisions = 0;
+    int m_lastDeferred = 0;
+    double m_lastMicros = 0.0;
+};
@@ -0,0 +1,135 @@
+#include "AllocTracker.h"
+
+
+const char* AllocTagToString(AllocTag tag) {
+    switch (tag) {
+        case AllocTag::OTHER: return "other";
+        case AllocTag::SIM: return "sim";
+        case AllocTag::EFFECTS: return "effects";
+        case AllocTag::ASSETS: return "assets";
+        case AllocTag::UI: return "ui";
+        case AllocTag::EVENTS: return "events";
+        default: return "unknown";
+    }
+}
+
+#ifdef AQUARIUM_ALLOC_TRACKING
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+const int TAG_COUNT = static_cast<int>(AllocTag::COUNT);
+
+struct TagCounters {
+    std::atomic<int64_t> frameAllocs{0};
+    std::atomic<int64_t> frameBytes{0};
+    std::atomic<int64_t> totalAllocs{0};
+    std::atomic<int64_t> totalBytes{0};
+    std::atomic<int64_t> liveBytes{0};
+    std::atomic<int64_t> peakBytes{0}; // since the last BeginFrame
+    // copies of the frame counters taken at BeginFrame
+    std::atomic<int64_t> lastFrameAllocs{0};
+    std::atomic<int64_t> lastFrameBytes{0};
+    std::atomic<int64_t> lastFramePeak{0};
+};
+
+// plain static storage, these must work before any constructor in the program ran
+TagCounters g_counters[TAG_COUNT];
+std::atomic<int64_t> g_textureBytes{0};
+thread_local AllocTag t_currentTag = AllocTag::OTHER;
+
+// every block carries its size and tag in front so delete can uncount it;
+// 16 bytes keeps the user pointer at malloc's alignment
+struct alignas(16) BlockHeader {
+    size_t size;
+    AllocTag tag;
+};
+
+void* trackedAlloc(size_t size) {
+    void* raw = std::malloc(sizeof(BlockHeader) + size);
+    if (!raw) throw std::bad_alloc();
+    BlockHeader* header = static_cast<BlockHeader*>(raw);
+    header->size = size;
+    header->tag = t_currentTag;
+
+    TagCounters& c = g_counters[static_cast<int>(header->tag)];
+    c.frameAllocs.fetch_add(1, std::memory_order_relaxed);
+    c.frameBytes.fetch_add(size, std::memory_order_relaxed);
+    c.totalAllocs.fetch_add(1, std::memory_order_relaxed);
+    c.totalBytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = c.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = c.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !c.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    return header + 1;
+}
+
+void trackedFree(void* ptr) {
+    if (!ptr) return;
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    g_counters[static_cast<int>(header->tag)].liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+    std::free(header);
+}
+
+} // namespace
+
+void AllocTracker::BeginFrame() {
+    for (TagCounters& c : g_counters) {
+        c.lastFrameAllocs.store(c.frameAllocs.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        c.lastFrameBytes.store(c.frameBytes.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        // the next frame's peak starts from what is live now
+        int64_t live = c.liveBytes.load(std::memory_order_relaxed);
+        c.lastFramePeak.store(c.peakBytes.exchange(live, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+AllocStats AllocTracker::GetStats(AllocTag tag) {
+    const TagCounters& c = g_counters[static_cast<int>(tag)];
+    AllocStats stats;
+    stats.frameAllocs = c.lastFrameAllocs.load(std::memory_order_relaxed);
+    stats.frameBytes = c.lastFrameBytes.load(std::memory_order_relaxed);
+    stats.framePeakBytes = c.lastFramePeak.load(std::memory_order_relaxed);
+    stats.totalAllocs = c.totalAllocs.load(std::memory_order_relaxed);
+    stats.totalBytes = c.totalBytes.load(std::memory_order_relaxed);
+    stats.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+AllocTag AllocTracker::GetCurrentTag() {
+    return t_currentTag;
+}
+
+AllocTag AllocTracker::SetCurrentTag(AllocTag tag) {
+    AllocTag previous = t_currentTag;
+    t_currentTag = tag;
+    return previous;
+}
+
+void AllocTracker::AddTextureBytes(int64_t bytes) {
+    g_textureBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+int64_t AllocTracker::GetTextureBytes() {
+    return g_textureBytes.load(std::memory_order_relaxed);
+}
+
+// Replacements for the global allocation functions. The aligned overloads are left
+// alone, their default new/delete pairs never meet these.
+void* operator new(size_t size) { return trackedAlloc(size); }
+void* operator new[](size_t size) { return trackedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return trackedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return trackedAlloc(size); } catch (...) { return nullptr; }
+}
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+
+#endif
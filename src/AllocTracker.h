@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Allocation tracking by subsystem. Build with AQUARIUM_ALLOC_TRACKING defined
+// (see PROJECT_DEFINES in config.make) to replace global new/delete with counting
+// versions; without it ALLOC_SCOPE and the texture hooks compile to nothing.
+
+enum class AllocTag : uint8_t {
+    OTHER,
+    SIM,
+    EFFECTS,
+    ASSETS,
+    UI,
+    EVENTS,
+    COUNT
+};
+
+const char* AllocTagToString(AllocTag tag);
+
+struct AllocStats {
+    int64_t frameAllocs = 0; // allocations made during the last finished frame
+    int64_t frameBytes = 0;
+    int64_t framePeakBytes = 0; // most live bytes at any point of the last finished frame
+    int64_t totalAllocs = 0;
+    int64_t totalBytes = 0;
+    int64_t liveBytes = 0;
+};
+
+#ifdef AQUARIUM_ALLOC_TRACKING
+
+class AllocTracker {
+public:
+    static constexpr bool ENABLED = true;
+    // closes the current frame, the per frame numbers restart from zero
+    static void BeginFrame();
+    static AllocStats GetStats(AllocTag tag);
+    static AllocTag GetCurrentTag();
+    static AllocTag SetCurrentTag(AllocTag tag);
+    // GPU memory isn't seen by operator new, sprites report their textures here
+    static void AddTextureBytes(int64_t bytes);
+    static int64_t GetTextureBytes();
+};
+
+// Everything allocated on this thread while the scope lives is charged to tag
+class AllocScope {
+public:
+    explicit AllocScope(AllocTag tag) : m_previous(AllocTracker::SetCurrentTag(tag)) {}
+    ~AllocScope() { AllocTracker::SetCurrentTag(m_previous); }
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+private:
+    AllocTag m_previous;
+};
+
+#define ALLOC_SCOPE_CONCAT2(a, b) a##b
+#define ALLOC_SCOPE_CONCAT(a, b) ALLOC_SCOPE_CONCAT2(a, b)
+#define ALLOC_SCOPE(tag) AllocScope ALLOC_SCOPE_CONCAT(allocScope_, __LINE__)(tag)
+
+#else
+
+class AllocTracker {
+public:
+    static constexpr bool ENABLED = false;
+    static void BeginFrame() {}
+    static AllocStats GetStats(AllocTag) { return AllocStats(); }
+    static void AddTextureBytes(int64_t) {}
+    static int64_t GetTextureBytes() { return 0; }
+};
+
+#define ALLOC_SCOPE(tag) ((void)0)
+
+#endif
@@ -1,5 +1,9 @@
 #include "Aquarium.h"
+#include "Snapshot.h"
+#include "Metrics.h"
+#include "Telemetry.h"
 #include <cstdlib>
+#include <type_traits>
 
 
 string AquariumCreatureTypeToString(AquariumCreatureType t){
@@ -50,17 +54,29 @@ void PlayerCreature::draw() const {
     
     ofLogVerbose() << "PlayerCreature at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
 
-    if (this->m_damage_debounce > 0) {
-        ofSetColor(ofColor::red); // Flash red if in damage debounce
-    } else {
-        ofSetColor(currentColor); 
-    }
+    SpriteInstance instance;
+    instance.flash = this->m_damage_debounce > 0 ? 1.0f : 0.0f; // Flash red if in damage debounce
+    instance.hue = this->m_hueCycle;
+    this->drawSprite(instance);
+}
 
-    if (m_sprite) {
-        m_sprite->draw(m_x, m_y);
-    }
+void PlayerCreature::writeState(SnapshotWriter& out) const {
+    Creature::writeState(out);
+    out.write(m_score);
+    out.write(m_lives);
+    out.write(m_power);
+    out.write(m_damage_debounce);
+    out.write(m_hueCycle);
+}
 
-    ofSetColor(ofColor::white); // Reset color
+void PlayerCreature::readState(SnapshotReader& in) {
+    Creature::readState(in);
+    m_score = in.read<int>();
+    m_lives = in.read<int>();
+    m_power = in.read<int>();
+    m_damage_debounce = in.read<int>();
+    m_hueCycle = in.read<float>();
+    if (m_lives < 0 || m_lives > MAX_LIVES) in.fail();
 }
 
 void PlayerCreature::changeSpeed(int speed) {
@@ -81,115 +97,139 @@ void PlayerCreature::loseLife(int debounce) {
 
 // NPCreature Implementation
 NPCreature::NPCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: Creature(x, y, speed, 30, 1, sprite) {
+: NPCreature(x, y, speed, std::move(sprite), TYPE) {}
+
+NPCreature::NPCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite, AquariumCreatureType type)
+: Creature(x, y, speed, GetCreatureTraits(type).collisionRadius, GetCreatureTraits(type).value, std::move(sprite))
+, m_creatureType(type) {
     m_dx = (rand() % 3 - 1); // -1, 0, or 1
     m_dy = (rand() % 3 - 1); // -1, 0, or 1
     normalize();
-
-    m_creatureType = AquariumCreatureType::NPCreature;
 }
 
 void NPCreature::move() {
     // Simple AI movement logic (random direction)
-    m_x += m_dx * m_speed;
-    m_y += m_dy * m_speed;
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
-    }
+    constexpr float speedFactor = GetCreatureTraits(TYPE).speedFactor;
+    m_x += m_dx * (m_speed * speedFactor);
+    m_y += m_dy * (m_speed * speedFactor);
     bounce();
 }
 
+void NPCreature::steer(float ax, float ay, float amount) {
+    m_dx += ax * amount;
+    m_dy += ay * amount;
+    normalize();
+    // a perfectly opposed steer can cancel the heading, keep the old one in that case
+    if (m_dx == 0.0f && m_dy == 0.0f) {
+        m_dx = -ax;
+        m_dy = -ay;
+        normalize();
+    }
+}
+
+void NPCreature::applySteering() {
+    if (m_steering.x == 0.0f && m_steering.y == 0.0f) return;
+    this->steer(m_steering.x, m_steering.y, m_turnRate);
+}
+
 void NPCreature::draw() const {
     ofLogVerbose() << "NPCreature at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    ofSetColor(ofColor::white);
-    if (m_sprite) {
-        m_sprite->draw(m_x, m_y);
-    }
+    this->drawSprite();
 }
 
 
 BiggerFish::BiggerFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite) {
+: NPCreature(x, y, speed, sprite, TYPE) {
     m_dx = (rand() % 3 - 1);
     m_dy = (rand() % 3 - 1);
     normalize();
-
-    setCollisionRadius(60); // Bigger fish have a larger collision radius
-    m_value = 5; // Bigger fish have a higher value
-    m_creatureType = AquariumCreatureType::BiggerFish;
 }
 
 void BiggerFish::move() {
-    // Bigger fish might move slower or have different logic
-    m_x += m_dx * (m_speed * 0.5); // Moves at half speed
-    m_y += m_dy * (m_speed * 0.5);
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
-    }
+    // Bigger fish move slower, see AQUARIUM_CREATURE_TRAITS
+    constexpr float speedFactor = GetCreatureTraits(TYPE).speedFactor;
+    m_x += m_dx * (m_speed * speedFactor);
+    m_y += m_dy * (m_speed * speedFactor);
 
     bounce();
 }
 
 void BiggerFish::draw() const {
     ofLogVerbose() << "BiggerFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    this->m_sprite->draw(this->m_x, this->m_y);
+    this->drawSprite();
+}
+
+// The simulation only draws from rand(), which snapshots and replays seed. ofRandom()
+// is shared with the particle effects, so using it here would make runs diverge.
+static float simRandom(float low, float high) {
+    return low + (high - low) * (rand() / static_cast<float>(RAND_MAX));
 }
 
 // ColorfulFish - behaves like normal fish
 ColorfulFish::ColorfulFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite) {
-    m_creatureType = AquariumCreatureType::ColorfulFish;
-    m_value = 3; // Worth 3 points
-    setCollisionRadius(70); // Larger to match 140x140 sprite size
+: NPCreature(x, y, speed, sprite, TYPE) {
     // Randomize wobble so fish don't sync
-    m_wobblePhase = ofRandom(0, TWO_PI);
-    m_wobbleSpeed = ofRandom(0.6f, 1.4f);
-    m_wobbleAngleAmp = ofRandom(0.08f, 0.16f); // ~5-9 degrees
+    m_wobblePhase = simRandom(0, TWO_PI);
+    m_wobbleSpeed = simRandom(0.6f, 1.4f);
+    m_wobbleAngleAmp = simRandom(0.08f, 0.16f); // ~5-9 degrees
+}
+
+void ColorfulFish::rethinkWobble() {
+    float bend = sinf(m_wobblePhase) * m_wobbleAngleAmp; // radians
+    m_bendCos = cosf(bend);
+    m_bendSin = sinf(bend);
 }
 
 void ColorfulFish::move() {
-    // Smooth curvy movement: gently bend direction over time
-    float t = ofGetElapsedTimef();
-    float bend = sinf(t * m_wobbleSpeed + m_wobblePhase) * m_wobbleAngleAmp; // radians
+    // Smooth curvy movement: gently bend direction over time. The phase advances by
+    // simulated time (the aquarium ticks every 6th frame at 60fps) so replays stay exact.
+    // The bend itself only changes when the wander behavior rethinks it.
+    const float tickSeconds = 6.0f / 60.0f;
+    m_wobblePhase = fmodf(m_wobblePhase + tickSeconds * m_wobbleSpeed, TWO_PI);
     // rotate current direction by small bend
-    float c = cosf(bend);
-    float s = sinf(bend);
-    float ndx = m_dx * c - m_dy * s;
-    float ndy = m_dx * s + m_dy * c;
+    float ndx = m_dx * m_bendCos - m_dy * m_bendSin;
+    float ndy = m_dx * m_bendSin + m_dy * m_bendCos;
     m_dx = ndx; m_dy = ndy;
     normalize();
 
-    m_x += m_dx * m_speed;
-    m_y += m_dy * m_speed;
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
-    }
+    constexpr float speedFactor = GetCreatureTraits(TYPE).speedFactor;
+    m_x += m_dx * (m_speed * speedFactor);
+    m_y += m_dy * (m_speed * speedFactor);
     bounce();
 }
 
+void ColorfulFish::writeState(SnapshotWriter& out) const {
+    NPCreature::writeState(out);
+    out.write(m_wobblePhase);
+    out.write(m_wobbleSpeed);
+    out.write(m_wobbleAngleAmp);
+}
+
+void ColorfulFish::readState(SnapshotReader& in) {
+    NPCreature::readState(in);
+    m_wobblePhase = in.read<float>();
+    m_wobbleSpeed = in.read<float>();
+    m_wobbleAngleAmp = in.read<float>();
+}
+
 void ColorfulFish::draw() const {
     ofLogVerbose() << "ColorfulFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    if (m_sprite) {
-        m_sprite->draw(m_x, m_y);
-    }
+    this->drawSprite();
 }
 
 // FastFish - behaves like BiggerFish (slower, boss-like)
 FastFish::FastFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite)
-: NPCreature(x, y, speed, sprite) {
+: NPCreature(x, y, speed, sprite, TYPE) {
     m_dx = (rand() % 3 - 1);
     m_dy = (rand() % 3 - 1);
     normalize();
-    
-    setCollisionRadius(30); // Small collision radius
-    m_value = 10; // High value - boss fish
-    m_creatureType = AquariumCreatureType::FastFish;
+}
+
+bool FastFish::trackPrey() {
+    std::shared_ptr<Creature> prey = m_prey.lock();
+    if (!prey) return false;
+    this->setTarget(prey->getX(), prey->getY());
+    return true;
 }
 
 void FastFish::move() {
@@ -207,23 +247,29 @@ void FastFish::move() {
         }
     }
 
-    // Move a bit faster than before
-    const float homingSpeedFactor = 0.95f; // slightly faster; still under player speed
-    m_x += m_dx * (m_speed * homingSpeedFactor);
-    m_y += m_dy * (m_speed * homingSpeedFactor);
-    if(m_dx < 0 ){
-        this->m_sprite->setFlipped(true);
-    }else {
-        this->m_sprite->setFlipped(false);
-    }
+    constexpr float speedFactor = GetCreatureTraits(TYPE).speedFactor;
+    m_x += m_dx * (m_speed * speedFactor);
+    m_y += m_dy * (m_speed * speedFactor);
     bounce();
 }
 
+void FastFish::writeState(SnapshotWriter& out) const {
+    NPCreature::writeState(out);
+    out.write(m_targetX);
+    out.write(m_targetY);
+    out.write(m_hasTarget);
+}
+
+void FastFish::readState(SnapshotReader& in) {
+    NPCreature::readState(in);
+    m_targetX = in.read<float>();
+    m_targetY = in.read<float>();
+    m_hasTarget = in.read<bool>();
+}
+
 void FastFish::draw() const {
     ofLogVerbose() << "FastFish at (" << m_x << ", " << m_y << ") with speed " << m_speed << std::endl;
-    if (m_sprite) {
-        m_sprite->draw(m_x, m_y);
-    }
+    this->drawSprite();
 }
 
 
@@ -237,15 +283,16 @@ AquariumSpriteManager::AquariumSpriteManager(){
 }
 
 std::shared_ptr<GameSprite> AquariumSpriteManager::GetSprite(AquariumCreatureType t){
+    // one sprite per type for everyone, facing and tint are per creature now
     switch(t){
         case AquariumCreatureType::BiggerFish:
-            return std::make_shared<GameSprite>(*this->m_big_fish);
+            return this->m_big_fish;
         case AquariumCreatureType::ColorfulFish:
-            return std::make_shared<GameSprite>(*this->m_colorful_fish);
+            return this->m_colorful_fish;
         case AquariumCreatureType::FastFish:
-            return std::make_shared<GameSprite>(*this->m_fast_fish);
+            return this->m_fast_fish;
         case AquariumCreatureType::NPCreature:
-            return std::make_shared<GameSprite>(*this->m_npc_fish);
+            return this->m_npc_fish;
         default:
             return nullptr;
     }
@@ -263,6 +310,7 @@ Aquarium::Aquarium(int width, int height, std::shared_ptr<AquariumSpriteManager>
 void Aquarium::addCreature(std::shared_ptr<Creature> creature) {
     creature->setBounds(m_width - 20, m_height - 20);
     m_creatures.push_back(creature);
+    m_gridDirty = true;
 }
 
 void Aquarium::addAquariumLevel(std::shared_ptr<AquariumLevel> level){
@@ -270,98 +318,422 @@ void Aquarium::addAquariumLevel(std::shared_ptr<AquariumLevel> level){
     this->m_aquariumlevels.push_back(level);
 }
 
+// Moves the creatures at ids, all of type Fish. One instantiation per type: no switch
+// per creature, the moves are direct calls that can be inlined and the type's traits
+// are constants in them. The creatures still sit behind shared_ptrs with their fields
+// interleaved, so this is not a loop the compiler can vectorize.
+template<class Fish>
+void Aquarium::stepCreatures(const std::vector<int>& ids, int& untilSample) {
+    for (int id : ids) {
+        Fish& fish = static_cast<Fish&>(*m_creatures[id]);
+        if constexpr (std::is_same_v<Fish, FastFish>) {
+            if (fish.isHuntingPlayer()) {
+                if (m_hasPlayerTarget) fish.setTarget(m_playerTarget.x, m_playerTarget.y);
+            } else {
+                fish.trackPrey(); // a prey that got eaten leaves its last position as the target
+            }
+        }
+        fish.applySteering();
+        fish.beginSweep(); // ResolvePredation and the next player check test this move
+        fish.Fish::move();
+        // counted here while the fish is still in cache, a slice of them per tick
+        if (untilSample-- == 0) {
+            m_telemetry->add(TelemetryLayer::Creature(Fish::TYPE), fish.getX(), fish.getY(), SpatialTelemetry::CREATURE_STRIDE);
+            untilSample = SpatialTelemetry::CREATURE_STRIDE - 1;
+        }
+    }
+}
+
 void Aquarium::update() {
+    if (m_gridDirty) {
+        this->rebuildSpatialGrid(); // something was added or removed since the last tick
+    }
+
+    // decisions first: every behavior that is due and fits in the budget looks at the
+    // tank as the last tick left it, nothing moves until they are all done
+    m_ai.beginTick();
     for (auto& creature : m_creatures) {
-        // If this is a FastFish, choose the nearest target (other fish or the player if available)
-        if (auto npc = std::dynamic_pointer_cast<NPCreature>(creature)) {
-            if (npc->GetType() == AquariumCreatureType::FastFish) {
-                if (auto ff = std::dynamic_pointer_cast<FastFish>(creature)) {
-                    ofVec2f bestPos = m_hasPlayerTarget ? m_playerTarget : ofVec2f(ff->getX(), ff->getY());
-                    float bestDist2 = m_hasPlayerTarget ? (m_playerTarget.x - ff->getX()) * (m_playerTarget.x - ff->getX()) +
-                                                          (m_playerTarget.y - ff->getY()) * (m_playerTarget.y - ff->getY())
-                                                       : std::numeric_limits<float>::max();
-                    // consider all other creatures as potential prey
-                    for (auto& other : m_creatures) {
-                        if (other == creature) continue;
-                        auto otherNpc = std::dynamic_pointer_cast<NPCreature>(other);
-                        if (!otherNpc) continue;
-                        float dx = other->getX() - ff->getX();
-                        float dy = other->getY() - ff->getY();
-                        float d2 = dx * dx + dy * dy;
-                        if (d2 < bestDist2) {
-                            bestDist2 = d2;
-                            bestPos.set(other->getX(), other->getY());
-                        }
-                    }
-                    ff->setTarget(bestPos.x, bestPos.y);
-                }
-            }
+        // every creature in the tank is an NPCreature, the player lives in the scene
+        NPCreature* npc = static_cast<NPCreature*>(creature.get());
+        AiBrain& brain = npc->getBrain();
+        if (!brain.task.isValid()) {
+            brain.task = this->StartBehavior(*npc);
+            brain.wakeTick = m_ai.getTick() + npc->getId() % 4; // spread the first decisions out
         }
-        creature->move();
+        m_ai.offer(brain, npc->getId());
+    }
+    m_ai.run();
+    AquariumMetrics::Get().aiDecisions->add(m_ai.getLastDecisions());
+    AquariumMetrics::Get().aiDeferred->set(m_ai.getLastDeferred());
+
+    // then the cheap part, every tick, one loop per type. Types go in enum order, so
+    // the FastFish move last and chase where their prey is this tick
+    for (auto& ids : m_creaturesByType) ids.clear();
+    for (int i = 0; i < static_cast<int>(m_creatures.size()); i++) {
+        AquariumCreatureType type = static_cast<const NPCreature&>(*m_creatures[i]).GetType();
+        m_creaturesByType[static_cast<int>(type)].push_back(i);
     }
+    int untilSample = m_telemetry ? m_telemetry->getCreatureOffset() : -1;
+    stepCreatures<NPCreature>(m_creaturesByType[static_cast<int>(NPCreature::TYPE)], untilSample);
+    stepCreatures<BiggerFish>(m_creaturesByType[static_cast<int>(BiggerFish::TYPE)], untilSample);
+    stepCreatures<ColorfulFish>(m_creaturesByType[static_cast<int>(ColorfulFish::TYPE)], untilSample);
+    stepCreatures<FastFish>(m_creaturesByType[static_cast<int>(FastFish::TYPE)], untilSample);
     
-    // FastFish can eat smaller fish (visual effect only)
-    this->HandleFastFishEating();
+    // creatures eating each other, against where everyone is now. Everyone moved, so
+    // the grid is stale; ResolvePredation rebuilds it only when the web has predators
+    m_gridDirty = true;
+    this->ResolvePredation();
     
     this->Repopulate();
+    this->PrewarmNextLevel();
+    this->ReleaseRetiredCreatures();
+    // final positions, used by draw until the next tick and by the next tick's decisions.
+    // ResolvePredation already built them when nothing was eaten or spawned since
+    if (m_gridDirty) {
+        this->rebuildSpatialGrid();
+    }
+    if (m_telemetry) m_telemetry->endTick();
 }
 
-void Aquarium::HandleFastFishEating() {
-    std::vector<std::shared_ptr<Creature>> toRemove;
-    
-    // Find all FastFish
-    for (auto& creature : m_creatures) {
-        auto npcCreature = std::dynamic_pointer_cast<NPCreature>(creature);
-        if (npcCreature && npcCreature->GetType() == AquariumCreatureType::FastFish) {
-            // Check if FastFish collides with smaller fish
-            for (auto& prey : m_creatures) {
-                if (prey == creature) continue; // Skip self
-                
-                auto preyNpc = std::dynamic_pointer_cast<NPCreature>(prey);
-                if (preyNpc) {
-                    AquariumCreatureType preyType = preyNpc->GetType();
-                    // FastFish can eat NPCreature, ColorfulFish, and BiggerFish (not other FastFish)
-                    if (preyType == AquariumCreatureType::NPCreature || 
-                        preyType == AquariumCreatureType::ColorfulFish ||
-                        preyType == AquariumCreatureType::BiggerFish) {
-                        
-                        if (checkCollision(creature, prey)) {
-                            toRemove.push_back(prey);
-                            // Store position for particle effect
-                            m_fastFishEatPositions.push_back(ofVec2f(prey->getX(), prey->getY()));
-                            ofLogNotice() << "FastFish ate a " << AquariumCreatureTypeToString(preyType) << "!" << std::endl;
-                        }
-                    }
-                }
+void Aquarium::rebuildSpatialGrid() {
+    m_grid.clear(m_width, m_height);
+    m_predatorGrid.clear(m_width, m_height);
+    for (int i = 0; i < static_cast<int>(m_creatures.size()); ++i) {
+        const Creature& creature = *m_creatures[i];
+        m_grid.insert(i, creature.getX(), creature.getY());
+        if (static_cast<const NPCreature&>(creature).GetType() == AquariumCreatureType::FastFish) {
+            m_predatorGrid.insert(i, creature.getX(), creature.getY());
+        }
+    }
+    m_grid.finalize();
+    m_predatorGrid.finalize();
+    m_gridDirty = false;
+    m_gridRemoved.clear();
+    m_gridCreatures = static_cast<int>(m_creatures.size());
+    m_gridIdsValid = true;
+}
+
+void Aquarium::noteRemovedFromGrid(int index) {
+    if (!m_gridIdsValid) return;
+    int inGrid = m_gridCreatures - static_cast<int>(m_gridRemoved.size());
+    if (index >= inGrid) return; // spawned since the build, the grid never had it
+    // step over the ids already removed below it to get back to its grid id
+    int id = index;
+    auto it = m_gridRemoved.begin();
+    for (; it != m_gridRemoved.end() && *it <= id; ++it) ++id;
+    m_gridRemoved.insert(it, id);
+}
+
+// Ticks between decisions, the aquarium ticks 12 times a second
+static const int HUNT_RETHINK_TICKS = 4;
+static const int SCHOOL_RETHINK_TICKS = 3;
+static const int FLEE_RETHINK_TICKS = 1;   // a FastFish is close, react right away
+static const int IDLE_RETHINK_TICKS = 12;  // nothing to do in this level, look again in a second
+static const float HUNT_RADIUS = 600.0f;   // prey further away than this is not worth a look
+
+AiTask Aquarium::StartBehavior(NPCreature& creature) {
+    return VisitAquariumCreature(creature, [this](auto& fish) {
+        using Fish = std::remove_reference_t<decltype(fish)>;
+        if constexpr (std::is_same_v<Fish, FastFish>) return this->Hunt(fish);
+        else if constexpr (std::is_same_v<Fish, ColorfulFish>) return this->Wander(fish);
+        else return this->School(fish);
+    });
+}
+
+// FastFish: pick the nearest prey (or the player) now and then, chase it in between
+AiTask Aquarium::Hunt(FastFish& fish) {
+    for (;;) {
+        this->rethinkHunt(fish);
+        co_await AiSleep{HUNT_RETHINK_TICKS};
+    }
+}
+
+// Plain and bigger fish: school with their kind and flee from FastFish when the level asks for it
+AiTask Aquarium::School(NPCreature& fish) {
+    for (;;) {
+        if (!currentSchoolingWeights(fish.GetType()).isEnabled()) {
+            fish.setSteering(ofVec2f(0.0f, 0.0f), 0.0f);
+            co_await AiSleep{IDLE_RETHINK_TICKS};
+            continue;
+        }
+        bool threatened = this->rethinkSchooling(fish);
+        co_await AiSleep{threatened ? FLEE_RETHINK_TICKS : SCHOOL_RETHINK_TICKS};
+    }
+}
+
+// ColorfulFish: curvy wandering, plus schooling and fleeing like the others
+AiTask Aquarium::Wander(ColorfulFish& fish) {
+    for (;;) {
+        fish.rethinkWobble();
+        bool threatened = false;
+        if (currentSchoolingWeights(fish.GetType()).isEnabled()) {
+            threatened = this->rethinkSchooling(fish);
+        } else {
+            fish.setSteering(ofVec2f(0.0f, 0.0f), 0.0f);
+        }
+        co_await AiSleep{threatened ? FLEE_RETHINK_TICKS : SCHOOL_RETHINK_TICKS};
+    }
+}
+
+const AquariumSchoolingWeights& Aquarium::currentSchoolingWeights(AquariumCreatureType type) const {
+    static const AquariumSchoolingWeights none;
+    if (m_aquariumlevels.empty()) return none;
+    int idx = this->currentLevel % this->m_aquariumlevels.size();
+    return this->m_aquariumlevels.at(idx)->GetSchoolingWeights(type);
+}
+
+void Aquarium::rethinkHunt(FastFish& fish) {
+    float bestDist2 = std::numeric_limits<float>::max();
+    if (m_hasPlayerTarget) {
+        float dx = m_playerTarget.x - fish.getX();
+        float dy = m_playerTarget.y - fish.getY();
+        bestDist2 = dx * dx + dy * dy;
+    }
+    int best = -1;
+    // the grid holds last tick's positions, close enough to choose who to chase
+    m_grid.forEachInRadius(fish.getX(), fish.getY(), HUNT_RADIUS, [&](int id, float, float, float d2) {
+        const NPCreature* other = static_cast<const NPCreature*>(m_creatures[id].get());
+        if (other == &fish || other->GetType() == AquariumCreatureType::FastFish) return true;
+        if (d2 < bestDist2) {
+            bestDist2 = d2;
+            best = id;
+        }
+        return true;
+    });
+    if (best >= 0) {
+        fish.setPrey(m_creatures[best], false);
+        fish.trackPrey();
+    } else if (m_hasPlayerTarget) {
+        fish.setPrey(std::weak_ptr<Creature>(), true);
+        fish.setTarget(m_playerTarget.x, m_playerTarget.y);
+    }
+    // nothing in range and no player: keep chasing whatever it had
+}
+
+// Separation, alignment and cohesion against a bounded number of same type neighbors,
+// plus fleeing from every FastFish in range. Predators come from their own grid, so
+// the neighbor walk can stop at the cap. Decisions of one tick all run before anyone
+// steers, so every fish sees the same headings and creature order doesn't matter.
+bool Aquarium::rethinkSchooling(NPCreature& fish) {
+    const AquariumSchoolingWeights& w = currentSchoolingWeights(fish.GetType());
+
+    float sepX = 0, sepY = 0;
+    float alignX = 0, alignY = 0;
+    float centerX = 0, centerY = 0;
+    float fleeX = 0, fleeY = 0;
+    int mates = 0;
+    int seen = 0;
+    bool threatened = false;
+    float separationSq = w.separationRadius * w.separationRadius;
+
+    if (w.flee > 0) {
+        m_predatorGrid.forEachInRadius(fish.getX(), fish.getY(), w.fleeRadius, [&](int, float dx, float dy, float d2) {
+            if (d2 > 0.0f) {
+                // closer predators push harder
+                fleeX -= dx / d2;
+                fleeY -= dy / d2;
+                threatened = true;
             }
+            return true;
+        });
+    }
+
+    m_grid.forEachInRadius(fish.getX(), fish.getY(), w.perceptionRadius, [&](int id, float dx, float dy, float d2) {
+        const NPCreature* other = static_cast<const NPCreature*>(m_creatures[id].get());
+        if (other == &fish || other->GetType() == AquariumCreatureType::FastFish) return true;
+        if (d2 < separationSq && d2 > 0.0f) {
+            sepX -= dx / d2;
+            sepY -= dy / d2;
+        }
+        if (other->GetType() == fish.GetType()) {
+            alignX += other->getDx();
+            alignY += other->getDy();
+            centerX += dx;
+            centerY += dy;
+            ++mates;
         }
+        return ++seen < w.maxNeighbors;
+    });
+
+    auto unit = [](float& x, float& y) {
+        float len = std::sqrt(x * x + y * y);
+        if (len > 0.0001f) { x /= len; y /= len; }
+    };
+    unit(sepX, sepY);
+    unit(fleeX, fleeY);
+    if (mates > 0) {
+        alignX = alignX / mates - fish.getDx();
+        alignY = alignY / mates - fish.getDy();
+        unit(alignX, alignY);
+        unit(centerX, centerY); // offsets are already relative, the mean has the same direction
     }
-    
-    // Remove eaten fish and decrement level population without adding to score
-    for (auto& fish : toRemove) {
-        auto it = std::find(m_creatures.begin(), m_creatures.end(), fish);
-        if (it != m_creatures.end()) {
-            // Update level population counts so Repopulate can spawn replacements
-            auto preyNpc = std::dynamic_pointer_cast<NPCreature>(fish);
-            if (preyNpc && !m_aquariumlevels.empty()) {
-                int idx = this->currentLevel % this->m_aquariumlevels.size();
-                this->m_aquariumlevels.at(idx)->ConsumePopulation(preyNpc->GetType(), 0 /*no score*/);
+
+    fish.setSteering(ofVec2f(
+        w.separation * sepX + w.alignment * alignX + w.cohesion * centerX + w.flee * fleeX,
+        w.separation * sepY + w.alignment * alignY + w.cohesion * centerY + w.flee * fleeY), w.turnRate);
+    return threatened;
+}
+
+// the biggest collision radius of any type, bounds how far apart two touching creatures can be
+static constexpr float maxCreatureRadius() {
+    float r = 0.0f;
+    for (const AquariumCreatureTraits& t : AQUARIUM_CREATURE_TRAITS) r = std::max(r, t.collisionRadius);
+    return r;
+}
+
+static float sweepLength(const Creature& c) {
+    float dx = c.getX() - c.getSweepX();
+    float dy = c.getY() - c.getSweepY();
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+const AquariumFoodWeb& Aquarium::getFoodWeb() const {
+    static const AquariumFoodWeb classic = AquariumFoodWeb::Classic();
+    if (m_aquariumlevels.empty()) return classic;
+    int idx = this->currentLevel % this->m_aquariumlevels.size();
+    return this->m_aquariumlevels.at(idx)->GetFoodWeb();
+}
+
+void Aquarium::ResolvePredation() {
+    const AquariumFoodWeb& web = this->getFoodWeb();
+    std::array<bool, AQUARIUM_CREATURE_TYPE_COUNT> predators;
+    bool anyPredator = false;
+    for (int t = 0; t < AQUARIUM_CREATURE_TYPE_COUNT; ++t) {
+        predators[t] = web.isPredator(t);
+        anyPredator = anyPredator || predators[t];
+    }
+    if (!anyPredator || m_creatures.empty()) return;
+    if (m_gridDirty) {
+        this->rebuildSpatialGrid();
+    }
+
+    // how far any prey could have come this tick, so the grid query can't miss a sweep
+    float maxStep = 0.0f;
+    for (const auto& creature : m_creatures) {
+        maxStep = std::max(maxStep, sweepLength(*creature));
+    }
+
+    // every predator/prey pair that touched, found from the grid around each predator
+    m_predationHits.clear();
+    for (int i = 0; i < static_cast<int>(m_creatures.size()); ++i) {
+        const NPCreature& predator = static_cast<const NPCreature&>(*m_creatures[i]);
+        int predatorType = static_cast<int>(predator.GetType());
+        if (!predators[predatorType]) continue;
+        float reach = predator.getCollisionRadius() + maxCreatureRadius() + sweepLength(predator) + maxStep;
+        m_grid.forEachInRadius(predator.getX(), predator.getY(), reach, [&](int id, float, float, float d2) {
+            if (id == i) return true;
+            const NPCreature& prey = static_cast<const NPCreature&>(*m_creatures[id]);
+            if (!web.canEat(predator, predatorType, prey, static_cast<int>(prey.GetType()))) return true;
+            if (checkSweptCollision(predator, prey)) {
+                m_predationHits.push_back(PredationHit{id, i, d2});
             }
-            m_creatures.erase(it);
+            return true;
+        });
+    }
+    if (m_predationHits.empty()) return;
+
+    // a prey is eaten once: by the closest predator, then the older one (lower id), so
+    // the outcome doesn't depend on creature or grid order. Everything in one tick
+    // happens at once, a predator that is eaten itself still gets its meal
+    std::sort(m_predationHits.begin(), m_predationHits.end(), [this](const PredationHit& a, const PredationHit& b) {
+        if (a.prey != b.prey) return a.prey < b.prey;
+        if (a.distSq != b.distSq) return a.distSq < b.distSq;
+        return m_creatures[a.predator]->getId() < m_creatures[b.predator]->getId();
+    });
+
+    m_eaten.assign(m_creatures.size(), 0);
+    std::shared_ptr<AquariumLevel> level;
+    if (!m_aquariumlevels.empty()) {
+        level = this->m_aquariumlevels.at(this->currentLevel % this->m_aquariumlevels.size());
+    }
+    for (size_t h = 0; h < m_predationHits.size(); ++h) {
+        const PredationHit& hit = m_predationHits[h];
+        if (m_eaten[hit.prey]) continue; // a further away predator of the same prey
+        m_eaten[hit.prey] = 1;
+        const NPCreature& prey = static_cast<const NPCreature&>(*m_creatures[hit.prey]);
+        const NPCreature& predator = static_cast<const NPCreature&>(*m_creatures[hit.predator]);
+        AquariumMetrics::Get().eatenByCreature[static_cast<int>(predator.GetType())][static_cast<int>(prey.GetType())]->add();
+        // Store position for particle effect
+        // only effects read these, nobody picking them up (the server) mustn't grow it forever
+        if (m_predationPositions.size() < MAX_PREDATION_POSITIONS) {
+            m_predationPositions.push_back(ofVec2f(prey.getX(), prey.getY()));
         }
+        if (m_telemetry) m_telemetry->add(TelemetryLayer::EatenBy(predator.GetType()), prey.getX(), prey.getY());
+        ofLogNotice() << AquariumCreatureTypeToString(predator.GetType()) << " ate a " << AquariumCreatureTypeToString(prey.GetType()) << "!" << std::endl;
+        // Update level population counts so Repopulate can spawn replacements, no score
+        if (level) level->ConsumePopulation(prey.GetType(), 0);
     }
+
+    // drop the eaten ones, keeping everyone else in order. The grid was built above,
+    // so an eaten index is its grid id
+    size_t kept = 0;
+    for (size_t i = 0; i < m_creatures.size(); ++i) {
+        if (m_eaten[i]) {
+            if (m_gridIdsValid) m_gridRemoved.push_back(static_cast<int>(i));
+            continue;
+        }
+        if (kept != i) m_creatures[kept] = std::move(m_creatures[i]);
+        ++kept;
+    }
+    m_creatures.resize(kept);
+    m_gridDirty = true;
 }
 
-std::vector<ofVec2f> Aquarium::GetAndClearFastFishEatPositions() {
-    std::vector<ofVec2f> positions = m_fastFishEatPositions;
-    m_fastFishEatPositions.clear();
+std::vector<ofVec2f> Aquarium::GetAndClearPredationPositions() {
+    std::vector<ofVec2f> positions = m_predationPositions;
+    m_predationPositions.clear();
     return positions;
 }
 
 void Aquarium::draw() const {
-    for (const auto& creature : m_creatures) {
-        creature->draw();
+    this->draw(ofRectangle(0, 0, m_width, m_height));
+}
+
+void Aquarium::draw(const ofRectangle& view) const {
+    // fade the freshly swapped in level so it doesn't pop in
+    float fade = 1.0f;
+    if (m_fadeStartTime >= 0.0f && m_transitionFadeSeconds > 0.0f) {
+        fade = ofClamp((m_clock - m_fadeStartTime) / m_transitionFadeSeconds, 0.0f, 1.0f);
+    }
+    SpriteBatch::Get().setTint(ofFloatColor(1.0f, 1.0f, 1.0f, fade));
+
+    // positions are the sprite's top left corner, so look a sprite width beyond the view
+    const float spriteMargin = 140.0f;
+    float minX = view.getLeft() - spriteMargin;
+    float minY = view.getTop() - spriteMargin;
+    float maxX = view.getRight();
+    float maxY = view.getBottom();
+    m_visible.clear();
+    auto addIfInView = [&](int from) {
+        for (int i = from; i < static_cast<int>(m_creatures.size()); ++i) {
+            float x = m_creatures[i]->getX();
+            float y = m_creatures[i]->getY();
+            if (x >= minX && x <= maxX && y >= minY && y <= maxY) m_visible.push_back(i);
+        }
+    };
+    if (m_gridIdsValid) {
+        // creatures eaten since the build are skipped, everyone after them moved down
+        m_grid.forEachInRect(minX, minY, maxX, maxY, [this](int id) {
+            auto removed = std::lower_bound(m_gridRemoved.begin(), m_gridRemoved.end(), id);
+            if (removed == m_gridRemoved.end() || *removed != id) {
+                m_visible.push_back(id - static_cast<int>(removed - m_gridRemoved.begin()));
+            }
+            return true;
+        });
+        // the grid hands them out cell by cell, keep the usual overlap order
+        std::sort(m_visible.begin(), m_visible.end());
+        // the few spawned since the build come after the grid's
+        addIfInView(m_gridCreatures - static_cast<int>(m_gridRemoved.size()));
+    } else {
+        addIfInView(0); // a new level or a load since the last tick
+    }
+    for (int id : m_visible) {
+        VisitAquariumCreature(static_cast<const NPCreature&>(*m_creatures[id]), [](const auto& fish) {
+            using Fish = std::remove_cv_t<std::remove_reference_t<decltype(fish)>>;
+            fish.Fish::draw();
+        });
     }
+    SpriteBatch::Get().setTint(ofFloatColor(1.0f, 1.0f, 1.0f, 1.0f));
 }
 
 
@@ -372,12 +744,16 @@ void Aquarium::removeCreature(std::shared_ptr<Creature> creature) {
         int selectLvl = this->currentLevel % this->m_aquariumlevels.size();
         auto npcCreature = std::static_pointer_cast<NPCreature>(creature);
         this->m_aquariumlevels.at(selectLvl)->ConsumePopulation(npcCreature->GetType(), npcCreature->getValue());
+        this->noteRemovedFromGrid(static_cast<int>(it - m_creatures.begin()));
         m_creatures.erase(it);
+        m_gridDirty = true;
     }
 }
 
 void Aquarium::clearCreatures() {
     m_creatures.clear();
+    m_gridDirty = true;
+    m_gridIdsValid = false;
 }
 
 std::shared_ptr<Creature> Aquarium::getCreatureAt(int index) {
@@ -389,29 +765,182 @@ std::shared_ptr<Creature> Aquarium::getCreatureAt(int index) {
 
 
 
-void Aquarium::SpawnCreature(AquariumCreatureType type) {
+std::shared_ptr<Creature> Aquarium::CreateCreature(AquariumCreatureType type) {
     int x = rand() % this->getWidth();
     int y = rand() % this->getHeight();
     int speed = 1 + rand() % 25; // Speed between 1 and 25
 
+    std::shared_ptr<GameSprite> sprite;
+    {
+        ALLOC_SCOPE(AllocTag::ASSETS);
+        sprite = this->m_sprite_manager->GetSprite(type);
+    }
+    std::shared_ptr<Creature> creature;
     switch (type) {
         case AquariumCreatureType::NPCreature:
-            this->addCreature(std::make_shared<NPCreature>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::NPCreature)));
+            creature = std::make_shared<NPCreature>(x, y, speed, sprite);
             break;
         case AquariumCreatureType::BiggerFish:
-            this->addCreature(std::make_shared<BiggerFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::BiggerFish)));
+            creature = std::make_shared<BiggerFish>(x, y, speed, sprite);
             break;
         case AquariumCreatureType::ColorfulFish:
-            this->addCreature(std::make_shared<ColorfulFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::ColorfulFish)));
+            creature = std::make_shared<ColorfulFish>(x, y, speed, sprite);
             break;
         case AquariumCreatureType::FastFish:
-            this->addCreature(std::make_shared<FastFish>(x, y, speed, this->m_sprite_manager->GetSprite(AquariumCreatureType::FastFish)));
+            creature = std::make_shared<FastFish>(x, y, speed, sprite);
             break;
         default:
             ofLogError() << "Unknown creature type to spawn!";
+            return nullptr;
+    }
+    creature->setBounds(m_width - 20, m_height - 20);
+    return creature;
+}
+
+void Aquarium::SpawnCreature(AquariumCreatureType type) {
+    std::shared_ptr<Creature> creature = this->CreateCreature(type);
+    if (creature) {
+        m_creatures.push_back(creature);
+        m_gridDirty = true;
+        // counted when a creature enters the tank, not when a load or the staging builds one
+        AquariumMetrics::Get().spawned[static_cast<int>(type)]->add();
+    }
+}
+
+// While a level plays, build the next level's creatures a few at a time into
+// m_next_creatures so the transition only has to swap two vectors. Sprites own GL
+// textures, so this has to stay on the main thread; the budget keeps each tick cheap.
+void Aquarium::PrewarmNextLevel() {
+    if (this->m_aquariumlevels.size() < 2) {return;} // the next level is this level, nothing to stage
+    int nextLevel = this->currentLevel + 1;
+    std::shared_ptr<AquariumLevel> next = this->m_aquariumlevels.at(nextLevel % this->m_aquariumlevels.size());
+
+    if (m_stagedLevel != nextLevel) {
+        // first tick of a new level, start counting the next one from scratch
+        m_next_creatures.clear();
+        next->populationReset();
+        m_stagedLevel = nextLevel;
+    }
+    if (!next->NeedsRepopulation()) {return;}
+
+    m_spawnQueue.clear();
+    next->Repopulate(m_spawnQueue, m_prewarmBudget);
+    for (AquariumCreatureType type : m_spawnQueue) {
+        std::shared_ptr<Creature> creature = this->CreateCreature(type);
+        if (creature) {
+            m_next_creatures.push_back(creature);
+        }
+    }
+}
+
+// Old creatures are destroyed a few per tick instead of all in the transition frame
+void Aquarium::ReleaseRetiredCreatures() {
+    int release = std::min<int>(m_retireBudget, m_retiredCreatures.size());
+    m_retiredCreatures.resize(m_retiredCreatures.size() - release);
+}
+
+void Aquarium::SwapInLevel(std::shared_ptr<AquariumLevel> level) {
+    m_retiredCreatures.insert(m_retiredCreatures.end(),
+                              std::make_move_iterator(m_creatures.begin()),
+                              std::make_move_iterator(m_creatures.end()));
+    m_creatures.clear();
+
+    if (m_stagedLevel == this->currentLevel) {
+        std::swap(m_creatures, m_next_creatures);
+        // bounds may have changed while the level was staged
+        for (auto& creature : m_creatures) {
+            creature->setBounds(m_width - 20, m_height - 20);
+            AquariumMetrics::Get().spawned[static_cast<int>(static_cast<NPCreature*>(creature.get())->GetType())]->add();
+        }
+    } else {
+        level->populationReset(); // nothing staged (single level), regular Repopulate fills it in
+    }
+    m_gridDirty = true;
+    m_gridIdsValid = false;
+    m_fadeStartTime = m_clock;
+}
+
+
+void Aquarium::writeCreatures(SnapshotWriter& out, const std::vector<std::shared_ptr<Creature>>& creatures) const {
+    out.write(static_cast<uint32_t>(creatures.size()));
+    for (const auto& creature : creatures) {
+        out.write(static_cast<uint8_t>(static_cast<const NPCreature*>(creature.get())->GetType()));
+        creature->writeState(out);
+    }
+}
+
+bool Aquarium::readCreatures(SnapshotReader& in, std::vector<std::shared_ptr<Creature>>& creatures) {
+    // the smallest record is the type byte and Creature::writeState, a count that
+    // can't fit in what is left is a corrupt file and must not size the reserve
+    const size_t minRecord = sizeof(uint8_t) + 7 * sizeof(float) + 2 * sizeof(int);
+    uint32_t count = in.read<uint32_t>();
+    if (!in.ok() || count > in.remaining() / minRecord) {
+        in.fail();
+        return false;
+    }
+    creatures.reserve(count);
+    for (uint32_t i = 0; i < count && in.ok(); ++i) {
+        uint8_t type = in.read<uint8_t>();
+        if (type >= AQUARIUM_CREATURE_TYPE_COUNT) {
+            in.fail();
             break;
+        }
+        std::shared_ptr<Creature> creature = this->CreateCreature(static_cast<AquariumCreatureType>(type));
+        creature->readState(in);
+        creatures.push_back(creature);
     }
+    return in.ok();
+}
 
+void Aquarium::writeState(SnapshotWriter& out) const {
+    out.write(static_cast<int32_t>(currentLevel));
+    out.write(static_cast<int32_t>(m_stagedLevel));
+    out.write(static_cast<uint32_t>(m_aquariumlevels.size()));
+    for (const auto& level : m_aquariumlevels) {
+        level->writeState(out);
+    }
+    writeCreatures(out, m_creatures);
+    writeCreatures(out, m_next_creatures);
+}
+
+bool Aquarium::readState(SnapshotReader& in) {
+    int level = in.read<int32_t>();
+    int stagedLevel = in.read<int32_t>();
+    uint32_t levelCount = in.read<uint32_t>();
+    if (!in.ok() || levelCount != m_aquariumlevels.size()) {
+        ofLogError() << "Snapshot was taken with " << levelCount << " levels, this aquarium has " << m_aquariumlevels.size() << std::endl;
+        return false;
+    }
+    // levels wrap with %, a negative one would index before the vector
+    if (level < 0 || stagedLevel < -1) {
+        ofLogError() << "Snapshot has level " << level << " staging " << stagedLevel << std::endl;
+        return false;
+    }
+    // levels are only touched once the creatures parsed fine, so keep their bytes aside
+    SnapshotReader levelsReader = in;
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        AquariumLevel scratch(0, 0);
+        scratch.readState(in);
+    }
+    std::vector<std::shared_ptr<Creature>> creatures;
+    std::vector<std::shared_ptr<Creature>> staged;
+    if (!readCreatures(in, creatures) || !readCreatures(in, staged)) {
+        return false;
+    }
+
+    for (auto& lvl : m_aquariumlevels) {
+        lvl->readState(levelsReader);
+    }
+    currentLevel = level;
+    m_stagedLevel = stagedLevel;
+    m_creatures.swap(creatures);
+    m_next_creatures.swap(staged);
+    m_gridDirty = true;
+    m_gridIdsValid = false;
+    m_retiredCreatures.clear();
+    m_predationPositions.clear();
+    m_fadeStartTime = -1.0f;
+    return true;
 }
 
 
@@ -420,28 +949,31 @@ void Aquarium::SpawnCreature(AquariumCreatureType type) {
 // once lvl criteria met, we move to new lvl through inner signal asking for new lvl
 // which will mean incrementing the buffer and pointing to a new lvl index
 void Aquarium::Repopulate() {
-    ofLogVerbose("entering phase repopulation");
     // lets make the levels circular
     int selectedLevelIdx = this->currentLevel % this->m_aquariumlevels.size();
-    ofLogVerbose() << "the current index: " << selectedLevelIdx << endl;
     std::shared_ptr<AquariumLevel> level = this->m_aquariumlevels.at(selectedLevelIdx);
 
 
     if(level->isCompleted()){
+        uint64_t transitionStart = ofGetElapsedTimeMicros();
         level->levelReset();
         this->currentLevel += 1;
         selectedLevelIdx = this->currentLevel % this->m_aquariumlevels.size();
-        ofLogNotice()<<"new level reached : " << selectedLevelIdx << std::endl;
         level = this->m_aquariumlevels.at(selectedLevelIdx);
-        this->clearCreatures();
+        this->SwapInLevel(level);
+        m_lastTransitionMicros = ofGetElapsedTimeMicros() - transitionStart;
+        AquariumMetrics::Get().levelTransitions->add();
+        AquariumMetrics::Get().transitionSeconds->observe(m_lastTransitionMicros * 1e-6);
+        ofLogNotice()<<"new level reached : " << selectedLevelIdx << " (transition took " << m_lastTransitionMicros << " us)" << std::endl;
     }
 
-    
-    // now lets find how many to respawn if needed 
-    std::vector<AquariumCreatureType> toRespawn = level->Repopulate();
-    ofLogVerbose() << "amount to repopulate : " << toRespawn.size() << endl;
-    if(toRespawn.size() <= 0 ){return;} // there is nothing for me to do here
-    for(AquariumCreatureType newCreatureType : toRespawn){
+    if(!level->NeedsRepopulation()){return;} // steady state, nothing was eaten since last time
+
+    // now lets find how many to respawn, bounded so a new level fills in over a few ticks
+    m_spawnQueue.clear();
+    int spawnCount = level->Repopulate(m_spawnQueue, m_spawnBudget);
+    ofLogVerbose() << "amount to repopulate : " << spawnCount << endl;
+    for(AquariumCreatureType newCreatureType : m_spawnQueue){
         this->SpawnCreature(newCreatureType);
     }
 }
@@ -450,106 +982,221 @@ void Aquarium::Repopulate() {
 // Aquarium collision detection
 std::shared_ptr<GameEvent> DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player) {
     if (!aquarium || !player) return nullptr;
+    ALLOC_SCOPE(AllocTag::EVENTS);
     
     for (int i = 0; i < aquarium->getCreatureCount(); ++i) {
         std::shared_ptr<Creature> npc = aquarium->getCreatureAt(i);
-        if (npc && checkCollision(player, npc)) {
+        if (npc && checkSweptCollision(*player, *npc)) {
+            AquariumMetrics::Get().collisions->add();
             return std::make_shared<GameEvent>(GameEventType::COLLISION, player, npc);
         }
     }
     return nullptr;
 };
 
+PlayerContact ResolvePlayerContact(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player) {
+    std::shared_ptr<GameEvent> event = DetectAquariumCollisions(aquarium, player);
+    // the player moves every frame, its next sweep covers everything until the next check
+    player->beginSweep();
+    if (event == nullptr || !event->isCollisionEvent()) return PlayerContact::NONE;
+    ofLogVerbose() << "Collision detected between player and NPC!" << std::endl;
+    if (event->creatureB == nullptr) {
+        ofLogError() << "Error: creatureB is null in collision event." << std::endl;
+        return PlayerContact::NONE;
+    }
+    event->print();
+
+    // the level's food web says what the player can eat, touching anything else hurts
+    auto npcCreature = std::static_pointer_cast<NPCreature>(event->creatureB);
+    if (!aquarium->getFoodWeb().playerCanEat(npcCreature->GetType(), player->getPower())) {
+        ofLogNotice() << "Player is too weak to eat the creature!" << std::endl;
+        int livesBefore = player->getLives();
+        player->loseLife(3*60); // 3 frames debounce, 3 seconds at 60fps
+        AquariumMetrics::Get().livesLost->add(livesBefore - player->getLives());
+        return player->getLives() <= 0 ? PlayerContact::DIED : PlayerContact::HURT;
+    }
+    AquariumMetrics::Get().eatenByPlayer[static_cast<int>(npcCreature->GetType())]->add();
+    if (SpatialTelemetry* telemetry = aquarium->getTelemetry()) {
+        telemetry->add(TelemetryLayer::EATEN_BY_PLAYER, npcCreature->getX(), npcCreature->getY());
+    }
+    aquarium->removeCreature(event->creatureB);
+    player->addToScore(1, event->creatureB->getValue());
+    if (player->getScore() % 25 == 0) {
+        player->increasePower(1);
+        ofLogNotice() << "Player power increased to " << player->getPower() << "!" << std::endl;
+    }
+    return PlayerContact::ATE;
+}
+
 //  Imlementation of the AquariumScene
 
 void AquariumGameScene::Update(){
-    std::shared_ptr<GameEvent> event;
+    this->m_lastTickMicros = -1;
+    this->m_aquarium->advanceClock(1.0f / 60.0f);
 
     this->m_player->update();
+    this->m_camera.follow(this->m_player->getX(), this->m_player->getY());
 
     if (this->updateControl.tick()) {
-        event = DetectAquariumCollisions(this->m_aquarium, this->m_player);
-        if (event != nullptr && event->isCollisionEvent()) {
-            ofLogVerbose() << "Collision detected between player and NPC!" << std::endl;
-            if(event->creatureB != nullptr){
-                event->print();
-                
-                // Check if it's a ColorfulFish - always edible, no damage
-                auto npcCreature = std::static_pointer_cast<NPCreature>(event->creatureB);
-                bool isColorfulFish = (npcCreature->GetType() == AquariumCreatureType::ColorfulFish);
-                
-                // ColorfulFish are always safe to eat, others require power check
-                if(!isColorfulFish && this->m_player->getPower() < event->creatureB->getValue()){
-                    ofLogNotice() << "Player is too weak to eat the creature!" << std::endl;
-                    this->m_player->loseLife(3*60); // 3 frames debounce, 3 seconds at 60fps
-                    if(this->m_player->getLives() <= 0){
-                        this->m_lastEvent = std::make_shared<GameEvent>(GameEventType::GAME_OVER, this->m_player, nullptr);
-                        return;
-                    }
-                }
-                else{
-                    this->m_aquarium->removeCreature(event->creatureB);
-                    this->m_player->addToScore(1, event->creatureB->getValue());
-                    if (this->m_player->getScore() % 25 == 0){
-                        this->m_player->increasePower(1);
-                        ofLogNotice() << "Player power increased to " << this->m_player->getPower() << "!" << std::endl;
-                    }
-                    
-                }
-                
-                
-
-            } else {
-                ofLogError() << "Error: creatureB is null in collision event." << std::endl;
-            }
+        if (ResolvePlayerContact(this->m_aquarium, this->m_player) == PlayerContact::DIED) {
+            ALLOC_SCOPE(AllocTag::EVENTS);
+            this->m_lastEvent = std::make_shared<GameEvent>(GameEventType::GAME_OVER, this->m_player, nullptr);
+            return;
         }
         // Update player position so FastFish can also target the player
         this->m_aquarium->SetPlayerTarget(this->m_player->getX(), this->m_player->getY());
+        if (SpatialTelemetry* telemetry = this->m_aquarium->getTelemetry()) {
+            telemetry->add(TelemetryLayer::PLAYER, this->m_player->getX(), this->m_player->getY());
+        }
+        uint64_t tickStart = ofGetElapsedTimeMicros();
         this->m_aquarium->update();
+        this->m_lastTickMicros = static_cast<int64_t>(ofGetElapsedTimeMicros() - tickStart);
+        AquariumMetrics& metrics = AquariumMetrics::Get();
+        metrics.tickSeconds->observe(this->m_lastTickMicros * 1e-6);
+        metrics.creatures->set(this->m_aquarium->getCreatureCount());
+        metrics.level->set(this->m_aquarium->getCurrentLevel());
     }
 
 }
 
+void AquariumGameScene::Restart(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium){
+    this->m_player = std::move(player);
+    this->m_aquarium = std::move(aquarium);
+    this->m_lastEvent = nullptr;
+    this->m_lastTickMicros = -1;
+    this->m_camera.snapTo(this->m_player->getX(), this->m_player->getY());
+    this->m_hud.invalidate();
+}
+
 void AquariumGameScene::Draw() {
+    this->m_camera.begin();
+    // tank walls, only visible when the camera reaches an edge
+    ofNoFill();
+    ofSetColor(100, 200, 255, 120);
+    ofDrawRectangle(0, 0, this->m_aquarium->getWidth(), this->m_aquarium->getHeight());
+    ofFill();
+    ofSetColor(ofColor::white);
+    SpriteBatch::Get().begin();
     this->m_player->draw();
-    this->m_aquarium->draw();
+    this->m_aquarium->draw(this->m_camera.getView());
+    SpriteBatch::Get().end();
+    this->m_camera.end();
     this->paintAquariumHUD();
 
 }
 
 
 void AquariumGameScene::paintAquariumHUD(){
-    float panelWidth = ofGetWindowWidth() - 150;
-    ofDrawBitmapString("Score: " + std::to_string(this->m_player->getScore()), panelWidth, 20);
-    ofDrawBitmapString("Power: " + std::to_string(this->m_player->getPower()), panelWidth, 30);
-    ofDrawBitmapString("Lives: " + std::to_string(this->m_player->getLives()), panelWidth, 40);
-    for (int i = 0; i < this->m_player->getLives(); ++i) {
-        ofSetColor(ofColor::red);
-        ofDrawCircle(panelWidth + i * 20, 50, 5);
+    // room for the text and one circle per life at 20px steps
+    const int hudWidth = std::max(160, 20 + PlayerCreature::MAX_LIVES * 20);
+    if (!this->m_hud.isAllocated()) {
+        this->m_hud.allocate(hudWidth, 60);
     }
+    int score = this->m_player->getScore();
+    int power = this->m_player->getPower();
+    int lives = this->m_player->getLives();
+    // the panel starts 10px left of the text so the first life circle fits
+    float panelX = ofGetWindowWidth() - hudWidth;
+    ofSetColor(ofColor::white);
+    this->m_hud.draw(panelX, 0, HudWidget::Key({score, power, lives}), [&]() {
+        ofSetColor(ofColor::white);
+        ofDrawBitmapString("Score: " + std::to_string(score), 10, 20);
+        ofDrawBitmapString("Power: " + std::to_string(power), 10, 30);
+        ofDrawBitmapString("Lives: " + std::to_string(lives), 10, 40);
+        ofSetColor(ofColor::red);
+        for (int i = 0; i < lives; ++i) {
+            ofDrawCircle(10 + i * 20, 50, 5);
+        }
+    });
     ofSetColor(ofColor::white); // Reset color to white for other drawings
 }
 
+// AquariumFoodWeb
+bool AquariumFoodWeb::isPredator(int predator) const {
+    for (int prey = 0; prey < AQUARIUM_CREATURE_TYPE_COUNT; ++prey) {
+        if (m_rules[predator][prey] != FoodWebRule::NEVER) return true;
+    }
+    return false;
+}
+
+bool AquariumFoodWeb::canEat(const Creature& predator, int predatorRow, const Creature& prey, int preyColumn) const {
+    switch (m_rules[predatorRow][preyColumn]) {
+        case FoodWebRule::ALWAYS: return true;
+        case FoodWebRule::IF_STRONGER: return predator.getValue() > prey.getValue();
+        default: return false;
+    }
+}
+
+bool AquariumFoodWeb::playerCanEat(AquariumCreatureType prey, int power) const {
+    switch (m_rules[PLAYER][static_cast<int>(prey)]) {
+        case FoodWebRule::ALWAYS: return true;
+        case FoodWebRule::IF_STRONGER: return power >= GetCreatureTraits(prey).value;
+        default: return false;
+    }
+}
+
+AquariumFoodWeb AquariumFoodWeb::Classic() {
+    AquariumFoodWeb web;
+    web.set(AquariumCreatureType::FastFish, AquariumCreatureType::NPCreature, FoodWebRule::ALWAYS);
+    web.set(AquariumCreatureType::FastFish, AquariumCreatureType::BiggerFish, FoodWebRule::ALWAYS);
+    web.set(AquariumCreatureType::FastFish, AquariumCreatureType::ColorfulFish, FoodWebRule::ALWAYS);
+    web.set(PLAYER, static_cast<int>(AquariumCreatureType::NPCreature), FoodWebRule::IF_STRONGER);
+    web.set(PLAYER, static_cast<int>(AquariumCreatureType::BiggerFish), FoodWebRule::IF_STRONGER);
+    web.set(PLAYER, static_cast<int>(AquariumCreatureType::FastFish), FoodWebRule::IF_STRONGER);
+    web.set(PLAYER, static_cast<int>(AquariumCreatureType::ColorfulFish), FoodWebRule::ALWAYS);
+    return web;
+}
+
+
 void AquariumLevel::populationReset(){
-    for(auto node: this->m_levelPopulation){
-        node->currentPopulation = 0; // need to reset the population to ensure they are made a new in the next level
+    for(auto& node: this->m_levelPopulation){
+        node.currentPopulation = 0; // need to reset the population to ensure they are made a new in the next level
     }
+    m_populationDirty = true;
 }
 
-void AquariumLevel::ConsumePopulation(AquariumCreatureType creatureType, int power){
-    for(std::shared_ptr<AquariumLevelPopulationNode> node: this->m_levelPopulation){
-        ofLogVerbose() << "consuming from this level creatures" << endl;
-        if(node->creatureType == creatureType){
-            ofLogVerbose() << "-cosuming from type: " << AquariumCreatureTypeToString(node->creatureType) <<" , currPop: " << node->currentPopulation << endl;
-            if(node->currentPopulation == 0){
-                return;
-            } 
-            node->currentPopulation -= 1;
-            ofLogVerbose() << "+cosuming from type: " << AquariumCreatureTypeToString(node->creatureType) <<" , currPop: " << node->currentPopulation << endl;
-            this->m_level_score += power;
-            return;
+void AquariumLevel::ScalePopulation(float factor){
+    for(auto& node: this->m_levelPopulation){
+        if(node.population > 0){
+            node.population = std::max(1, static_cast<int>(std::round(node.population * factor)));
         }
     }
+    m_populationDirty = true;
+}
+
+void AquariumLevel::ConsumePopulation(AquariumCreatureType creatureType, int power){
+    AquariumLevelPopulationNode& node = this->m_levelPopulation[static_cast<int>(creatureType)];
+    if(node.currentPopulation == 0){
+        return;
+    }
+    node.currentPopulation -= 1;
+    ofLogVerbose() << "consumed type: " << AquariumCreatureTypeToString(creatureType) <<" , currPop: " << node.currentPopulation << endl;
+    this->m_level_score += power;
+    m_populationDirty = true;
+}
+
+void AquariumLevel::writeState(SnapshotWriter& out) const {
+    out.write(m_level_score);
+    out.write(m_populationDirty);
+    for (const auto& node : m_levelPopulation) {
+        out.write(node.population);
+        out.write(node.currentPopulation);
+    }
+}
+
+bool AquariumLevel::readState(SnapshotReader& in) {
+    int score = in.read<int>();
+    bool dirty = in.read<bool>();
+    std::array<AquariumLevelPopulationNode, AQUARIUM_CREATURE_TYPE_COUNT> population;
+    for (auto& node : population) {
+        node.population = in.read<int>();
+        node.currentPopulation = in.read<int>();
+    }
+    if (!in.ok()) return false;
+    m_level_score = score;
+    m_populationDirty = dirty;
+    m_levelPopulation = population;
+    return true;
 }
 
 bool AquariumLevel::isCompleted(){
@@ -557,18 +1204,24 @@ bool AquariumLevel::isCompleted(){
 }
 
 // Refactored Repopulate - single implementation for all levels
-std::vector<AquariumCreatureType> AquariumLevel::Repopulate() {
-    std::vector<AquariumCreatureType> toRepopulate;
-    for(std::shared_ptr<AquariumLevelPopulationNode> node : this->m_levelPopulation){
-        int delta = node->population - node->currentPopulation;
-        if(delta > 0){
-            ofLogVerbose() << "Repopulating " << delta << " creatures of type " 
-                          << AquariumCreatureTypeToString(node->creatureType) << endl;
-            for(int i = 0; i < delta; i++){
-                toRepopulate.push_back(node->creatureType);
-            }
-            node->currentPopulation += delta;
+int AquariumLevel::Repopulate(std::vector<AquariumCreatureType>& toRepopulate, int spawnBudget) {
+    if(!m_populationDirty){return 0;}
+
+    int added = 0;
+    bool deficitLeft = false;
+    for(int t = 0; t < AQUARIUM_CREATURE_TYPE_COUNT; ++t){
+        AquariumLevelPopulationNode& node = this->m_levelPopulation[t];
+        int delta = node.population - node.currentPopulation;
+        if(delta <= 0){continue;}
+        int take = std::min(delta, spawnBudget - added);
+        for(int i = 0; i < take; i++){
+            toRepopulate.push_back(static_cast<AquariumCreatureType>(t));
         }
+        node.currentPopulation += take;
+        added += take;
+        if(take < delta){deficitLeft = true;}
     }
-    return toRepopulate;
+    // stay dirty until every deficit has been queued, the rest goes out on the next ticks
+    m_populationDirty = deficitLeft;
+    return added;
 }
@@ -1,10 +1,16 @@
+#pragma once
 #define NOMINMAX // To avoid min/max macro conflict on Windows
 
 #include <vector>
+#include <array>
 #include <memory>
 #include <iostream>
 #include <algorithm>
 #include "Core.h"
+#include "SpatialGrid.h"
+#include "Camera.h"
+#include "HudWidget.h"
+#include "AiScheduler.h"
 
 
 enum class AquariumCreatureType {
@@ -14,19 +20,95 @@ enum class AquariumCreatureType {
     FastFish
 };
 
+const int AQUARIUM_CREATURE_TYPE_COUNT = 4; // keep in sync with AquariumCreatureType
+
 string AquariumCreatureTypeToString(AquariumCreatureType t);
 
+// What every creature of a type shares, known at compile time. The constructors and
+// move() read it from here instead of each class setting its own numbers.
+struct AquariumCreatureTraits {
+    AquariumCreatureType type;
+    float collisionRadius;
+    int value;         // points for eating one
+    float speedFactor; // of the speed it was spawned with
+};
+
+constexpr std::array<AquariumCreatureTraits, AQUARIUM_CREATURE_TYPE_COUNT> AQUARIUM_CREATURE_TRAITS = {{
+    {AquariumCreatureType::NPCreature,   30.0f,  1, 1.0f},
+    {AquariumCreatureType::BiggerFish,   60.0f,  5, 0.5f},  // big and slow
+    {AquariumCreatureType::ColorfulFish, 70.0f,  3, 1.0f},  // matches the 140x140 sprite
+    {AquariumCreatureType::FastFish,     30.0f, 10, 0.95f}, // boss fish, still slower than the player
+}};
+
+constexpr const AquariumCreatureTraits& GetCreatureTraits(AquariumCreatureType t) {
+    return AQUARIUM_CREATURE_TRAITS[static_cast<int>(t)];
+}
+
+constexpr bool creatureTraitsInEnumOrder() {
+    for (int i = 0; i < AQUARIUM_CREATURE_TYPE_COUNT; ++i) {
+        if (static_cast<int>(AQUARIUM_CREATURE_TRAITS[i].type) != i) return false;
+    }
+    return true;
+}
+static_assert(creatureTraitsInEnumOrder(), "AQUARIUM_CREATURE_TRAITS must follow AquariumCreatureType");
+
+// Boids style weights for a creature type, all zero means the type does not school.
+// Levels hand these to the aquarium so each level can tune how fish group up.
+struct AquariumSchoolingWeights {
+    AquariumSchoolingWeights() = default;
+    AquariumSchoolingWeights(float separation, float alignment, float cohesion, float flee)
+    : separation(separation), alignment(alignment), cohesion(cohesion), flee(flee) {}
+
+    float separation = 0.0f;        // push away from crowded neighbors
+    float alignment = 0.0f;         // match the heading of same type neighbors
+    float cohesion = 0.0f;          // drift towards the center of same type neighbors
+    float flee = 0.0f;              // run away from nearby FastFish
+    float perceptionRadius = 90.0f; // how far a fish looks for schoolmates
+    float separationRadius = 45.0f;
+    float fleeRadius = 160.0f;
+    float turnRate = 0.15f;         // how much of the steering is applied per tick
+    int maxNeighbors = 7;           // boids walk stops here, predators are found apart
+
+    bool isEnabled() const { return separation > 0 || alignment > 0 || cohesion > 0 || flee > 0; }
+};
+
+// Who eats whom. Rows are predators and columns prey, indexed by AquariumCreatureType
+// with the player as one more entry after the creature types. Every level carries its
+// own web; Classic() is the game's original rules.
+enum class FoodWebRule : uint8_t {
+    NEVER,
+    ALWAYS,
+    IF_STRONGER // the player needs power >= the prey's value, a creature a higher value than the prey
+};
+
+class AquariumFoodWeb {
+public:
+    static const int PLAYER = AQUARIUM_CREATURE_TYPE_COUNT;
+    static const int SIZE = AQUARIUM_CREATURE_TYPE_COUNT + 1;
+
+    void set(int predator, int prey, FoodWebRule rule) { m_rules[predator][prey] = rule; }
+    void set(AquariumCreatureType predator, AquariumCreatureType prey, FoodWebRule rule) {
+        this->set(static_cast<int>(predator), static_cast<int>(prey), rule);
+    }
+    FoodWebRule get(int predator, int prey) const { return m_rules[predator][prey]; }
+    // eats at least one kind of creature
+    bool isPredator(int predator) const;
+    bool canEat(const Creature& predator, int predatorRow, const Creature& prey, int preyColumn) const;
+    bool playerCanEat(AquariumCreatureType prey, int power) const;
+
+    // FastFish eat every other fish, the player always eats ColorfulFish and the rest when strong enough
+    static AquariumFoodWeb Classic();
+
+private:
+    std::array<std::array<FoodWebRule, SIZE>, SIZE> m_rules{}; // all NEVER
+};
+
 class AquariumLevelPopulationNode{
     public:
         AquariumLevelPopulationNode() = default;
-        AquariumLevelPopulationNode(AquariumCreatureType creature_type, int population) {
-            this->creatureType = creature_type;
-            this->population = population;
-            this->currentPopulation = 0;
-        };
-        AquariumCreatureType creatureType;
-        int population;
-        int currentPopulation;
+        AquariumLevelPopulationNode(int population) : population(population), currentPopulation(0) {};
+        int population = 0;        // how many the level wants alive
+        int currentPopulation = 0; // how many are alive (or already queued to spawn)
 };
 
 class AquariumLevel : public GameLevel {
@@ -37,9 +119,29 @@ class AquariumLevel : public GameLevel {
         bool isCompleted() override;
         void populationReset();
         void levelReset(){m_level_score=0;this->populationReset();}
-        std::vector<AquariumCreatureType> Repopulate(); // No longer virtual - common implementation
+        // Appends at most spawnBudget missing creatures to toRepopulate and returns how many were added.
+        // Does nothing while no creature has been consumed since the last full repopulation.
+        int Repopulate(std::vector<AquariumCreatureType>& toRepopulate, int spawnBudget);
+        bool NeedsRepopulation() const { return m_populationDirty; }
+        const AquariumLevelPopulationNode& GetPopulation(AquariumCreatureType t) const { return m_levelPopulation[static_cast<int>(t)]; }
+        void writeState(SnapshotWriter& out) const;
+        bool readState(SnapshotReader& in);
+        void SetSchoolingWeights(AquariumCreatureType t, const AquariumSchoolingWeights& weights){ m_schooling[static_cast<int>(t)] = weights; }
+        // multiplies every population, used to keep the density when the tank grows
+        void ScalePopulation(float factor);
+        const AquariumSchoolingWeights& GetSchoolingWeights(AquariumCreatureType t) const { return m_schooling[static_cast<int>(t)]; }
+        const AquariumFoodWeb& GetFoodWeb() const { return m_foodWeb; }
+        void SetFoodWeb(const AquariumFoodWeb& web) { m_foodWeb = web; }
     protected:
-        std::vector<std::shared_ptr<AquariumLevelPopulationNode>> m_levelPopulation;
+        void SetPopulation(AquariumCreatureType t, int population){
+            m_levelPopulation[static_cast<int>(t)] = AquariumLevelPopulationNode(population);
+            m_populationDirty = true;
+        }
+        // indexed by AquariumCreatureType, types a level does not use stay at 0
+        std::array<AquariumLevelPopulationNode, AQUARIUM_CREATURE_TYPE_COUNT> m_levelPopulation;
+        bool m_populationDirty = true;
+        std::array<AquariumSchoolingWeights, AQUARIUM_CREATURE_TYPE_COUNT> m_schooling;
+        AquariumFoodWeb m_foodWeb = AquariumFoodWeb::Classic();
         int m_level_score;
         int m_targetScore;
 
@@ -48,80 +150,139 @@ class AquariumLevel : public GameLevel {
 
 class PlayerCreature : public Creature {
 public:
+    static constexpr int MAX_LIVES = 3; // lives only go down, so the start is also the most
 
     PlayerCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
-    ofColor currentColor = ofColor::white; 
+    // rainbow tint for the power-up, hue in 0..1 and negative for none
+    void setHueCycle(float hue) { m_hueCycle = hue; }
     void move();
     void draw() const;
     void update();
     void changeSpeed(int speed);
-    void setLives(int lives) { m_lives = lives; }
+    void setLives(int lives) { m_lives = std::min(lives, MAX_LIVES); }
     void setDirection(float dx, float dy);
     float isXDirectionActive() { return m_dx != 0; }
     float isYDirectionActive() {return m_dy != 0; }
-    float getDx() { return m_dx; }
-    float getDy() { return m_dy; }
 
     int getScore()const { return m_score; }
     int getLives() const { return m_lives; }
     int getPower() const { return m_power; }
+    bool isHurt() const { return m_damage_debounce > 0; }
     
     void addToScore(int amount, int weight=1) { m_score += amount * weight; }
     void loseLife(int debounce);
     void increasePower(int value) { m_power += value; }
     void reduceDamageDebounce();
+    void writeState(SnapshotWriter& out) const override;
+    void readState(SnapshotReader& in) override;
     
 private:
     int m_score = 0;
-    int m_lives = 3;
+    int m_lives = MAX_LIVES;
     int m_power = 1; // mark current power lvl
     int m_damage_debounce = 0; // frames to wait after eating
+    float m_hueCycle = -1.0f;
 };
 
 class NPCreature : public Creature {
 public:
+    static constexpr AquariumCreatureType TYPE = AquariumCreatureType::NPCreature;
     NPCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
-    AquariumCreatureType GetType() {return this->m_creatureType;}
+    AquariumCreatureType GetType() const {return this->m_creatureType;}
+    // blend the current heading with a steering vector, used by schooling
+    void steer(float ax, float ay, float amount);
+    // steering decided by the creature's behavior, applied every tick until the next decision
+    void setSteering(const ofVec2f& steering, float turnRate) { m_steering = steering; m_turnRate = turnRate; }
+    void applySteering();
+    AiBrain& getBrain() { return m_brain; }
     void move() override;
     void draw() const override;
 protected:
-    AquariumCreatureType m_creatureType;
+    // for the subclasses, takes the radius and value from the type's traits
+    NPCreature(float x, float y, int speed, std::shared_ptr<GameSprite> sprite, AquariumCreatureType type);
+    AquariumCreatureType m_creatureType; // per creature still, update() groups by it and VisitAquariumCreature switches on it
+    AiBrain m_brain; // started by the aquarium the first tick the creature is in the tank
+    ofVec2f m_steering{0.0f, 0.0f};
+    float m_turnRate = 0.0f;
 
 };
 
-class BiggerFish : public NPCreature {
+class BiggerFish final : public NPCreature {
 public:
+    static constexpr AquariumCreatureType TYPE = AquariumCreatureType::BiggerFish;
     BiggerFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
     void move() override;
     void draw() const override;
 };
 
-class ColorfulFish : public NPCreature {
+class ColorfulFish final : public NPCreature {
 public:
+    static constexpr AquariumCreatureType TYPE = AquariumCreatureType::ColorfulFish;
     ColorfulFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
+    // works out the bend for the next few ticks, move() only applies it
+    void rethinkWobble();
     void move() override;
     void draw() const override;
+    void writeState(SnapshotWriter& out) const override;
+    void readState(SnapshotReader& in) override;
 private:
     // Parameters for non-straight curvy movement
     float m_wobblePhase = 0.0f;
     float m_wobbleSpeed = 1.0f;
     float m_wobbleAngleAmp = 0.12f; // radians to bend direction (~7 deg)
+    float m_bendCos = 1.0f; // rotation per tick, from the last rethinkWobble
+    float m_bendSin = 0.0f;
 };
 
-class FastFish : public NPCreature {
+class FastFish final : public NPCreature {
 public:
+    static constexpr AquariumCreatureType TYPE = AquariumCreatureType::FastFish;
     FastFish(float x, float y, int speed, std::shared_ptr<GameSprite> sprite);
     // Allow steering towards a target point (prey or player)
     void setTarget(float tx, float ty) { m_targetX = tx; m_targetY = ty; m_hasTarget = true; }
+    // prey followed every tick until the next hunting decision, empty means the player
+    void setPrey(std::weak_ptr<Creature> prey, bool huntsPlayer) { m_prey = std::move(prey); m_huntsPlayer = huntsPlayer; }
+    bool isHuntingPlayer() const { return m_huntsPlayer; }
+    // moves the target to where the prey is now, false when it is gone
+    bool trackPrey();
     void move() override;
     void draw() const override;
+    void writeState(SnapshotWriter& out) const override;
+    void readState(SnapshotReader& in) override;
 private:
     float m_targetX = 0.0f;
     float m_targetY = 0.0f;
     bool m_hasTarget = false;
+    std::weak_ptr<Creature> m_prey;
+    bool m_huntsPlayer = false;
 };
 
 
+// Calls visit with the creature as its concrete class, like std::visit on a variant.
+// The lambda is instantiated once per type, so calls inside it on a final class (and
+// qualified ones like fish.Fish::move()) are direct and can be inlined, with the
+// type's traits as constants. Only the switch is left at run time.
+template<class Visitor>
+decltype(auto) VisitAquariumCreature(NPCreature& creature, Visitor&& visit) {
+    switch (creature.GetType()) {
+        case AquariumCreatureType::BiggerFish: return visit(static_cast<BiggerFish&>(creature));
+        case AquariumCreatureType::ColorfulFish: return visit(static_cast<ColorfulFish&>(creature));
+        case AquariumCreatureType::FastFish: return visit(static_cast<FastFish&>(creature));
+        default: return visit(creature);
+    }
+}
+
+template<class Visitor>
+decltype(auto) VisitAquariumCreature(const NPCreature& creature, Visitor&& visit) {
+    switch (creature.GetType()) {
+        case AquariumCreatureType::BiggerFish: return visit(static_cast<const BiggerFish&>(creature));
+        case AquariumCreatureType::ColorfulFish: return visit(static_cast<const ColorfulFish&>(creature));
+        case AquariumCreatureType::FastFish: return visit(static_cast<const FastFish&>(creature));
+        default: return visit(creature);
+    }
+}
+
+
 class AquariumSpriteManager {
     public:
         AquariumSpriteManager();
@@ -135,6 +296,8 @@ class AquariumSpriteManager {
 };
 
 
+class SpatialTelemetry;
+
 class Aquarium{
 public:
     Aquarium(int width, int height, std::shared_ptr<AquariumSpriteManager> spriteManager);
@@ -144,39 +307,133 @@ public:
     void clearCreatures();
     void update();
     void draw() const;
-    void setBounds(int w, int h) { m_width = w; m_height = h; }
+    // draws only the creatures whose position falls inside view (world space)
+    void draw(const ofRectangle& view) const;
+    void setBounds(int w, int h) { m_width = w; m_height = h; m_gridDirty = true; }
     void setMaxPopulation(int n) { m_maxPopulation = n; }
+    // cap on creatures spawned per Repopulate call, big deficits are spread over several ticks
+    void setSpawnBudget(int n) { m_spawnBudget = std::max(1, n); }
+    int getSpawnBudget() const { return m_spawnBudget; }
     void Repopulate();
     void SpawnCreature(AquariumCreatureType type);
-    void HandleFastFishEating();
-    std::vector<ofVec2f> GetAndClearFastFishEatPositions();
+    std::shared_ptr<Creature> CreateCreature(AquariumCreatureType type);
+    // creatures of the next level built per tick ahead of the transition
+    void setPrewarmBudget(int n) { m_prewarmBudget = std::max(1, n); }
+    // seconds the new level takes to fade in after a transition, 0 turns the fade off
+    void setTransitionFade(float seconds) { m_transitionFadeSeconds = seconds; }
+    // the fade's clock, advanced once per drawn frame by the scene (1/60 s) instead of the
+    // wall clock so offscreen renders running faster than real time fade the same
+    void advanceClock(float seconds) { m_clock += seconds; }
+    uint64_t getLastTransitionMicros() const { return m_lastTransitionMicros; }
+    int getStagedCreatureCount() const { return m_next_creatures.size(); }
+    int getRetiredCreatureCount() const { return m_retiredCreatures.size(); }
+    int getLevelCount() const { return m_aquariumlevels.size(); }
+    // eats not yet picked up by GetAndClearPredationPositions, at most MAX_PREDATION_POSITIONS
+    int getPendingPredationCount() const { return m_predationPositions.size(); }
+    static const int MAX_PREDATION_POSITIONS = 256;
+    // every creature eating every other one the level's food web allows, in one pass
+    // over the spatial grid. Prey reached by several predators goes to the closest one
+    void ResolvePredation();
+    // where creatures were eaten by other creatures since the last call, for the effects
+    std::vector<ofVec2f> GetAndClearPredationPositions();
+    const AquariumFoodWeb& getFoodWeb() const;
     // Provide player position so FastFish can consider it as a target
     void SetPlayerTarget(float x, float y) { m_playerTarget.set(x, y); m_hasPlayerTarget = true; }
+    // decisions and microseconds the behaviors may use per tick, see AiScheduler
+    void setAiBudget(int maxDecisions, double maxMicros) { m_ai.setBudget(maxDecisions, maxMicros); }
+    const AiScheduler& getAiScheduler() const { return m_ai; }
+    // density and eat counts go here every tick when set (not owned), see Telemetry.h
+    void setTelemetry(SpatialTelemetry* telemetry) { m_telemetry = telemetry; }
+    SpatialTelemetry* getTelemetry() const { return m_telemetry; }
     
     std::shared_ptr<Creature> getCreatureAt(int index);
     int getCreatureCount() const { return m_creatures.size(); }
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
+    const SpatialGrid& getSpatialGrid() const { return m_grid; }
+    // true when creatures were added or removed since the grid was built (its ids are stale)
+    bool isSpatialGridDirty() const { return m_gridDirty; }
+    int getCurrentLevel() const { return currentLevel; }
+
+    // creatures, staged creatures, level counters and the level index, see AquariumSnapshot
+    void writeState(SnapshotWriter& out) const;
+    bool readState(SnapshotReader& in);
 
 
 private:
+    void rebuildSpatialGrid();
+    // records that the creature at index leaves the tank, call before erasing it
+    void noteRemovedFromGrid(int index);
+    void PrewarmNextLevel();
+    void ReleaseRetiredCreatures();
+    void SwapInLevel(std::shared_ptr<AquariumLevel> level);
+    const AquariumSchoolingWeights& currentSchoolingWeights(AquariumCreatureType type) const;
+    // schooling and flee steering for one fish from its neighbors, true when a FastFish is close
+    bool rethinkSchooling(NPCreature& fish);
+    void rethinkHunt(FastFish& fish);
+    // creature behaviors, see AiScheduler.h
+    AiTask StartBehavior(NPCreature& creature);
+    AiTask Hunt(FastFish& fish);
+    AiTask School(NPCreature& fish);
+    AiTask Wander(ColorfulFish& fish);
+    void writeCreatures(SnapshotWriter& out, const std::vector<std::shared_ptr<Creature>>& creatures) const;
+    bool readCreatures(SnapshotReader& in, std::vector<std::shared_ptr<Creature>>& creatures);
+
     int m_maxPopulation = 0;
     int m_width;
     int m_height;
     int currentLevel = 0;
+    int m_spawnBudget = 16;
+    std::vector<AquariumCreatureType> m_spawnQueue; // scratch for Repopulate, reused every tick
     std::vector<std::shared_ptr<Creature>> m_creatures;
-    std::vector<std::shared_ptr<Creature>> m_next_creatures;
-    std::vector<ofVec2f> m_fastFishEatPositions; // Store positions where FastFish ate other fish
+    std::vector<std::shared_ptr<Creature>> m_next_creatures; // staged population of the next level
+    std::vector<std::shared_ptr<Creature>> m_retiredCreatures; // previous level, released over a few ticks
+    int m_stagedLevel = -1; // level number m_next_creatures belongs to
+    int m_prewarmBudget = 4;
+    int m_retireBudget = 8;
+    float m_transitionFadeSeconds = 0.75f;
+    float m_fadeStartTime = -1.0f;
+    float m_clock = 0.0f;
+    uint64_t m_lastTransitionMicros = 0;
+    std::vector<ofVec2f> m_predationPositions; // where creatures ate other creatures
+    struct PredationHit {
+        int prey;
+        int predator;
+        float distSq;
+    };
+    std::vector<PredationHit> m_predationHits; // scratch, reused every tick
+    std::vector<char> m_eaten;                 // scratch, per creature index
+    // scratch, creature indices grouped by type so update() moves each type in its own loop
+    std::array<std::vector<int>, AQUARIUM_CREATURE_TYPE_COUNT> m_creaturesByType;
+    template<class Fish> void stepCreatures(const std::vector<int>& ids, int& untilSample);
     std::vector<std::shared_ptr<AquariumLevel>> m_aquariumlevels;
     std::shared_ptr<AquariumSpriteManager> m_sprite_manager;
     // Cached player target for homing behavior
     ofVec2f m_playerTarget{0.0f, 0.0f};
     bool m_hasPlayerTarget = false;
+    // neighbor queries for schooling and draw culling. Rebuilt at the end of every
+    // update; adding or removing creatures in between marks it dirty (ids are indices)
+    SpatialGrid m_grid{90.0f};
+    // until the next rebuild, draw maps grid ids around the removed ones instead of
+    // scanning every creature: removals keep the order, spawns go after the grid's
+    std::vector<int> m_gridRemoved; // grid ids of creatures gone since the build, sorted
+    int m_gridCreatures = 0;        // creatures in the tank when the grid was built
+    bool m_gridIdsValid = false;    // false after the list was replaced (level swap, clear, load)
+    SpatialGrid m_predatorGrid{160.0f}; // just the FastFish, schooling fish flee from these
+    bool m_gridDirty = true;
+    mutable std::vector<int> m_visible; // draw scratch, reused every frame
+    AiScheduler m_ai;
+    SpatialTelemetry* m_telemetry = nullptr;
 };
 
 
 std::shared_ptr<GameEvent> DetectAquariumCollisions(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player);
 
+enum class PlayerContact { NONE, ATE, HURT, DIED };
+// Eats or gets hurt by the first creature the player swept through since the last
+// check, shared by the single player scene and the multiplayer server.
+PlayerContact ResolvePlayerContact(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<PlayerCreature> player);
+
 
 class AquariumGameScene : public GameScene {
     public:
@@ -184,44 +441,59 @@ class AquariumGameScene : public GameScene {
         : m_player(std::move(player)) , m_aquarium(std::move(aquarium)), m_name(name){}
         std::shared_ptr<GameEvent> GetLastEvent(){return m_lastEvent;}
         void SetLastEvent(std::shared_ptr<GameEvent> event){this->m_lastEvent = event;}
+        // a new game: fresh player and tank, the camera jumps to the player
+        void Restart(std::shared_ptr<PlayerCreature> player, std::shared_ptr<Aquarium> aquarium);
         std::shared_ptr<PlayerCreature> GetPlayer(){return this->m_player;}
         std::shared_ptr<Aquarium> GetAquarium(){return this->m_aquarium;}
         string GetName()override {return this->m_name;}
         void Update() override;
         void Draw() override;
+        // how long Aquarium::update took during the last Update(), -1 if it didn't tick
+        int64_t GetLastTickMicros() const {return this->m_lastTickMicros;}
+        // follows the player around the tank, set up by ofApp
+        AquariumCamera& GetCamera(){return this->m_camera;}
     private:
         void paintAquariumHUD();
+        HudWidget m_hud; // score, power and lives, repainted when one of them changes
         std::shared_ptr<PlayerCreature> m_player;
         std::shared_ptr<Aquarium> m_aquarium;
         std::shared_ptr<GameEvent> m_lastEvent;
         string m_name;
         AwaitFrames updateControl{5};
+        int64_t m_lastTickMicros = -1;
+        AquariumCamera m_camera;
 };
 
 
 class Level_0 : public AquariumLevel  {
     public:
         Level_0(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 10));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::ColorfulFish, 3));
+            this->SetPopulation(AquariumCreatureType::NPCreature, 10);
+            this->SetPopulation(AquariumCreatureType::ColorfulFish, 3);
+            this->SetSchoolingWeights(AquariumCreatureType::NPCreature, AquariumSchoolingWeights(1.5f, 1.0f, 0.6f, 0.0f));
         };
 };
 
 class Level_1 : public AquariumLevel  {
     public:
         Level_1(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 20));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::ColorfulFish, 5));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::FastFish, 1));
+            this->SetPopulation(AquariumCreatureType::NPCreature, 20);
+            this->SetPopulation(AquariumCreatureType::ColorfulFish, 5);
+            this->SetPopulation(AquariumCreatureType::FastFish, 1);
+            this->SetSchoolingWeights(AquariumCreatureType::NPCreature, AquariumSchoolingWeights(1.5f, 1.0f, 0.8f, 2.0f));
+            this->SetSchoolingWeights(AquariumCreatureType::ColorfulFish, AquariumSchoolingWeights(1.2f, 0.4f, 0.3f, 1.5f));
         };
 };
 
 class Level_2 : public AquariumLevel  {
     public:
         Level_2(int levelNumber, int targetScore): AquariumLevel(levelNumber, targetScore){
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::NPCreature, 30));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::BiggerFish, 5));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::ColorfulFish, 8));
-            this->m_levelPopulation.push_back(std::make_shared<AquariumLevelPopulationNode>(AquariumCreatureType::FastFish, 1));
+            this->SetPopulation(AquariumCreatureType::NPCreature, 30);
+            this->SetPopulation(AquariumCreatureType::BiggerFish, 5);
+            this->SetPopulation(AquariumCreatureType::ColorfulFish, 8);
+            this->SetPopulation(AquariumCreatureType::FastFish, 1);
+            this->SetSchoolingWeights(AquariumCreatureType::NPCreature, AquariumSchoolingWeights(1.5f, 1.2f, 1.0f, 2.5f));
+            this->SetSchoolingWeights(AquariumCreatureType::BiggerFish, AquariumSchoolingWeights(2.0f, 0.6f, 0.4f, 1.0f));
+            this->SetSchoolingWeights(AquariumCreatureType::ColorfulFish, AquariumSchoolingWeights(1.2f, 0.4f, 0.3f, 1.5f));
         };
 };
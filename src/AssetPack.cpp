@@ -0,0 +1,278 @@
+#include "AssetPack.h"
+#include "FreeImage.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char MAGIC[4] = {'A', 'Q', 'P', 'K'};
+const size_t HEADER_SIZE = 16;
+const size_t ALIGNMENT = 16;
+const size_t ENTRY_SIZE = 36; // index entry without its name
+
+// startup load order: ofApp::setup, then AquariumSpriteManager
+const char* STARTUP_ORDER[] = {
+    "background.png",
+    "title.png",
+    "base-fish.png",
+    "bigger-fish.png",
+    "sprites/colorfulFish.png",
+    "sprites/fastFish.png",
+    "game-over.png",
+};
+
+template <typename T>
+T readValue(const uint8_t* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// size and modification time of a loose file, false when there is none
+bool sourceStamp(const std::string& path, uint64_t& size, int64_t& mtime) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    size = static_cast<uint64_t>(info.st_size);
+    mtime = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+template <typename T>
+void writeValue(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+}
+
+
+AssetPack& AssetPack::Get() {
+    static AssetPack pack;
+    return pack;
+}
+
+AssetPack::~AssetPack() {
+    this->close();
+}
+
+bool AssetPack::open(const std::string& path) {
+    this->close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!base) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_base = static_cast<const uint8_t*>(base);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (base == MAP_FAILED) return false;
+    // ask for the whole pack now, front to back, while setup does other work
+    madvise(base, info.st_size, MADV_SEQUENTIAL);
+    madvise(base, info.st_size, MADV_WILLNEED);
+    m_base = static_cast<const uint8_t*>(base);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+    if (!this->readIndex()) {
+        ofLogError() << "Asset pack " << path << " is damaged or from another version, using loose files" << std::endl;
+        this->close();
+        return false;
+    }
+    ofLogNotice() << "Asset pack " << path << ": " << m_index.size() << " files, " << m_size / 1024 << " KB" << std::endl;
+    return true;
+}
+
+void AssetPack::close() {
+    m_index.clear();
+    if (!m_base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_base), m_size);
+#endif
+    m_base = nullptr;
+    m_size = 0;
+}
+
+bool AssetPack::readIndex() {
+    if (m_size < HEADER_SIZE || memcmp(m_base, MAGIC, 4) != 0) return false;
+    if (readValue<uint32_t>(m_base + 4) != VERSION) return false;
+    uint32_t count = readValue<uint32_t>(m_base + 8);
+    size_t dataStart = readValue<uint32_t>(m_base + 12);
+    if (dataStart > m_size) return false;
+
+    size_t pos = HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        if (pos + ENTRY_SIZE > dataStart) return false;
+        uint64_t offset = readValue<uint64_t>(m_base + pos);
+        uint64_t size = readValue<uint64_t>(m_base + pos + 8);
+        Entry entry;
+        entry.sourceSize = readValue<uint64_t>(m_base + pos + 16);
+        entry.sourceMtime = readValue<int64_t>(m_base + pos + 24);
+        uint32_t nameLength = readValue<uint32_t>(m_base + pos + 32);
+        pos += ENTRY_SIZE;
+        if (pos + nameLength > dataStart) return false;
+        if (offset < dataStart || offset > m_size || size > m_size - offset) return false;
+        std::string name(reinterpret_cast<const char*>(m_base + pos), nameLength);
+        pos += nameLength;
+        entry.view = AssetView{m_base + offset, static_cast<size_t>(size)};
+        m_index[name] = entry;
+    }
+    return true;
+}
+
+bool AssetPack::find(const std::string& name, AssetView& view) const {
+    auto it = m_index.find(name);
+    if (it == m_index.end()) return false;
+    view = it->second.view;
+    return true;
+}
+
+bool AssetPack::loadImage(const std::string& name, ofImage& image) const {
+    auto it = m_index.find(name);
+    if (it == m_index.end()) {
+        return image.load(name);
+    }
+    // one stat per image, only asked for while the art is being worked on: an edited
+    // loose file wins over a pack nobody rebuilt
+    uint64_t size;
+    int64_t mtime;
+    if (m_checkSources && sourceStamp(ofToDataPath(name, true), size, mtime) &&
+        (size != it->second.sourceSize || mtime != it->second.sourceMtime)) {
+        ofLogWarning() << name << " changed since the asset pack was built, loading the loose file. Run --pack_assets to update it" << std::endl;
+        return image.load(name);
+    }
+    const AssetView& view = it->second.view;
+    // FreeImage reads the compressed bytes in place, the decoded pixels are the only copy
+    FIMEMORY* memory = FreeImage_OpenMemory(const_cast<BYTE*>(view.data), static_cast<DWORD>(view.size));
+    FREE_IMAGE_FORMAT format = FreeImage_GetFileTypeFromMemory(memory, 0);
+    FIBITMAP* bitmap = format != FIF_UNKNOWN ? FreeImage_LoadFromMemory(format, memory, 0) : nullptr;
+    FreeImage_CloseMemory(memory);
+    if (!bitmap) {
+        ofLogError() << "Could not decode " << name << " from the asset pack" << std::endl;
+        return false;
+    }
+    FIBITMAP* rgba = FreeImage_ConvertTo32Bits(bitmap);
+    FreeImage_Unload(bitmap);
+    if (!rgba) return false;
+
+    unsigned width = FreeImage_GetWidth(rgba);
+    unsigned height = FreeImage_GetHeight(rgba);
+    ofPixels pixels;
+    pixels.allocate(width, height, OF_IMAGE_COLOR_ALPHA);
+    FreeImage_ConvertToRawBits(pixels.getData(), rgba, width * 4, 32,
+                               FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, true);
+    FreeImage_Unload(rgba);
+#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
+    pixels.swapRgb();
+#endif
+    image.setFromPixels(pixels);
+    return true;
+}
+
+std::vector<std::string> AssetPack::StartupAssets(const std::string& dataDir) {
+    std::vector<std::string> names;
+    for (const char* name : STARTUP_ORDER) {
+        if (ofFile::doesFileExist(ofFilePath::join(dataDir, name), false)) names.push_back(name);
+    }
+    // anything else, so a new sprite isn't silently left out
+    std::vector<std::string> extra;
+    ofDirectory dir(dataDir);
+    dir.allowExt("png");
+    dir.listDir();
+    for (size_t i = 0; i < dir.size(); i++) extra.push_back(dir.getName(i));
+    ofDirectory sprites(ofFilePath::join(dataDir, "sprites"));
+    if (sprites.exists()) {
+        sprites.allowExt("png");
+        sprites.listDir();
+        for (size_t i = 0; i < sprites.size(); i++) extra.push_back("sprites/" + sprites.getName(i));
+    }
+    std::sort(extra.begin(), extra.end());
+    for (const std::string& name : extra) {
+        if (std::find(names.begin(), names.end(), name) == names.end()) names.push_back(name);
+    }
+    return names;
+}
+
+bool AssetPack::Write(const std::string& dataDir, const std::vector<std::string>& names, const std::string& outPath) {
+    std::vector<ofBuffer> contents;
+    std::vector<uint64_t> sourceSizes;
+    std::vector<int64_t> sourceMtimes;
+    for (const std::string& name : names) {
+        std::string path = ofFilePath::join(dataDir, name);
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        ofBuffer buffer = ofBufferFromFile(path, true);
+        if (buffer.size() == 0 || !sourceStamp(path, size, mtime)) {
+            ofLogError() << "Could not read " << name << " for the asset pack" << std::endl;
+            return false;
+        }
+        contents.push_back(std::move(buffer));
+        sourceSizes.push_back(size);
+        sourceMtimes.push_back(mtime);
+    }
+
+    size_t indexSize = 0;
+    for (const std::string& name : names) indexSize += ENTRY_SIZE + name.size();
+    auto align = [](size_t v) { return (v + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; };
+    size_t dataStart = align(HEADER_SIZE + indexSize);
+
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(MAGIC, 4);
+    writeValue<uint32_t>(out, VERSION);
+    writeValue<uint32_t>(out, static_cast<uint32_t>(names.size()));
+    writeValue<uint32_t>(out, static_cast<uint32_t>(dataStart));
+    size_t offset = dataStart;
+    for (size_t i = 0; i < names.size(); i++) {
+        writeValue<uint64_t>(out, offset);
+        writeValue<uint64_t>(out, contents[i].size());
+        writeValue<uint64_t>(out, sourceSizes[i]);
+        writeValue<int64_t>(out, sourceMtimes[i]);
+        writeValue<uint32_t>(out, static_cast<uint32_t>(names[i].size()));
+        out.write(names[i].data(), names[i].size());
+        offset = align(offset + contents[i].size());
+    }
+    const char padding[ALIGNMENT] = {};
+    size_t written = HEADER_SIZE + indexSize;
+    for (const ofBuffer& buffer : contents) {
+        out.write(padding, align(written) - written);
+        written = align(written);
+        out.write(buffer.getData(), buffer.size());
+        written += buffer.size();
+    }
+    ofLogNotice() << "Packed " << names.size() << " files into " << outPath << " (" << written / 1024 << " KB)" << std::endl;
+    return static_cast<bool>(out);
+}
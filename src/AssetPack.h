@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ofMain.h"
+
+// Bytes of one packed file, pointing straight into the mapped pack
+struct AssetView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// All the startup images in one file (bin/data/assets.aqpack), so a cold start opens
+// one file and reads it front to back instead of seeking to a dozen small ones.
+// The pack is memory mapped and decoders get views into the mapping, nothing is
+// copied before decoding. Build it with --pack_assets after changing an image; when
+// there is no pack the loose files are used as before. While working on the art,
+// --check_pack also uses any loose file whose size or modification time no longer
+// matches what was packed; kiosks skip that, it is a stat() per image.
+//
+// Layout, little endian:
+//   "AQPK" u32 version u32 count u32 dataStart
+//   count x { u64 offset, u64 size, u64 sourceSize, i64 sourceMtime, u32 nameLength, name bytes }
+//   file data from dataStart, in the order the game loads it, 16 byte aligned
+class AssetPack {
+public:
+    static constexpr uint32_t VERSION = 2; // 2: source size and mtime per file
+
+    static AssetPack& Get();
+    ~AssetPack();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return m_base != nullptr; }
+    void setCheckSources(bool check) { m_checkSources = check; }
+
+    // name is relative to bin/data with forward slashes, e.g. "sprites/fastFish.png"
+    bool find(const std::string& name, AssetView& view) const;
+    // decodes straight from the pack, falls back to ofImage::load for loose files and,
+    // with setCheckSources, for files changed since they were packed
+    bool loadImage(const std::string& name, ofImage& image) const;
+
+    // writes names (relative to dataDir) into a new pack at outPath, in that order
+    static bool Write(const std::string& dataDir, const std::vector<std::string>& names, const std::string& outPath);
+    // the images the game loads at startup, in load order, then any other image in bin/data
+    static std::vector<std::string> StartupAssets(const std::string& dataDir);
+
+private:
+    struct Entry {
+        AssetView view;
+        uint64_t sourceSize = 0;
+        int64_t sourceMtime = 0; // seconds, as stat() gives it
+    };
+
+    AssetPack() = default;
+    bool readIndex();
+
+    const uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+    std::unordered_map<std::string, Entry> m_index;
+    bool m_checkSources = false;
+};
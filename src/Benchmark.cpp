@@ -0,0 +1,466 @@
+#include "Benchmark.h"
+#include "Aquarium.h"
+#include "AllocTracker.h"
+#include "Telemetry.h"
+#include "WaterBackground.h"
+#include <ctime>
+#include <fstream>
+#include <regex>
+#include <thread>
+#include <climits>
+
+
+// BenchmarkState
+bool BenchmarkState::keepRunning() {
+    if (!m_started) {
+        m_started = true;
+        resumeTiming();
+    }
+    if (m_done < m_iterations) {
+        ++m_done;
+        return true;
+    }
+    pauseTiming();
+    return false;
+}
+
+void BenchmarkState::pauseTiming() {
+    if (!m_running) return;
+    m_elapsed += std::chrono::steady_clock::now() - m_start;
+    m_cpuSeconds += double(std::clock()) / CLOCKS_PER_SEC - m_cpuStart;
+    m_running = false;
+}
+
+void BenchmarkState::resumeTiming() {
+    if (m_running) return;
+    m_start = std::chrono::steady_clock::now();
+    m_cpuStart = double(std::clock()) / CLOCKS_PER_SEC;
+    m_running = true;
+}
+
+
+// BenchmarkRunner
+void BenchmarkRunner::add(const std::string& name, Fn fn, std::vector<std::vector<int64_t>> argSets,
+                          std::vector<std::string> argNames) {
+    for (auto& args : argSets) {
+        std::string fullName = name;
+        for (size_t i = 0; i < args.size(); ++i) {
+            // named args read better in reports, e.g. BM_AquariumUpdate/n:1000/mix:1
+            fullName += "/" + (i < argNames.size() && !argNames[i].empty() ? argNames[i] + ":" : std::string()) + ofToString(args[i]);
+        }
+        m_cases.push_back(Case{fullName, fn, args});
+    }
+}
+
+namespace {
+
+int64_t totalAllocs() {
+    int64_t n = 0;
+    for (int t = 0; t < static_cast<int>(AllocTag::COUNT); ++t) n += AllocTracker::GetStats(static_cast<AllocTag>(t)).totalAllocs;
+    return n;
+}
+
+int64_t totalAllocBytes() {
+    int64_t n = 0;
+    for (int t = 0; t < static_cast<int>(AllocTag::COUNT); ++t) n += AllocTracker::GetStats(static_cast<AllocTag>(t)).totalBytes;
+    return n;
+}
+
+} // namespace
+
+bool BenchmarkRunner::run(const std::string& outPath, const std::string& filter, double minSeconds) {
+    std::regex pattern(filter.empty() ? ".*" : filter);
+    std::ostringstream json;
+    json << "{\n  \"context\": {\n"
+         << "    \"date\": \"" << ofGetTimestampString("%Y-%m-%dT%H:%M:%S") << "\",\n"
+         << "    \"executable\": \"aquarium\",\n"
+         << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+         << "    \"library_build_type\": \"release\",\n"
+#else
+         << "    \"library_build_type\": \"debug\",\n"
+#endif
+         << "    \"alloc_tracking\": " << (AllocTracker::ENABLED ? "true" : "false") << "\n"
+         << "  },\n  \"benchmarks\": [";
+
+    bool first = true;
+    for (const Case& c : m_cases) {
+        if (!std::regex_search(c.name, pattern)) continue;
+
+        // grow the iteration count until one run takes at least minSeconds, like Google Benchmark
+        int64_t iterations = 1;
+        double seconds = 0.0;
+        double cpuSeconds = 0.0;
+        int64_t items = 0;
+        int64_t allocs = 0;
+        int64_t allocBytes = 0;
+        while (true) {
+            BenchmarkState state(iterations, c.args);
+            int64_t allocsBefore = totalAllocs();
+            int64_t bytesBefore = totalAllocBytes();
+            c.fn(state);
+            allocs = totalAllocs() - allocsBefore;
+            allocBytes = totalAllocBytes() - bytesBefore;
+            seconds = state.elapsedSeconds();
+            cpuSeconds = state.cpuSeconds();
+            items = state.itemsProcessed();
+            if (seconds >= minSeconds || iterations >= 1000000000) break;
+            double multiplier = seconds / minSeconds > 0.1 ? minSeconds * 1.4 / std::max(seconds, 1e-9) : 10.0;
+            iterations = std::min<int64_t>(1000000000, std::max<int64_t>(iterations + 1, int64_t(iterations * multiplier)));
+        }
+
+        double realNs = seconds * 1e9 / iterations;
+        double cpuNs = cpuSeconds * 1e9 / iterations;
+        ofLogNotice() << c.name << "  " << realNs << " ns  (" << iterations << " iterations)" << std::endl;
+
+        json << (first ? "\n" : ",\n") << "    {\n"
+             << "      \"name\": \"" << c.name << "\",\n"
+             << "      \"run_name\": \"" << c.name << "\",\n"
+             << "      \"run_type\": \"iteration\",\n"
+             << "      \"repetitions\": 1,\n"
+             << "      \"repetition_index\": 0,\n"
+             << "      \"threads\": 1,\n"
+             << "      \"iterations\": " << iterations << ",\n"
+             << "      \"real_time\": " << realNs << ",\n"
+             << "      \"cpu_time\": " << cpuNs << ",\n"
+             << "      \"time_unit\": \"ns\"";
+        if (items > 0 && seconds > 0) {
+            json << ",\n      \"items_per_second\": " << items / seconds;
+        }
+        if (AllocTracker::ENABLED) {
+            // includes the untimed setup, divided over the run like the timings
+            json << ",\n      \"allocs_per_iteration\": " << double(allocs) / iterations
+                 << ",\n      \"bytes_per_iteration\": " << double(allocBytes) / iterations
+                 << ",\n      \"texture_bytes\": " << AllocTracker::GetTextureBytes();
+        }
+        json << "\n    }";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    std::ofstream file(outPath, std::ios::trunc);
+    if (!file) {
+        ofLogError() << "Could not write benchmark results to " << outPath << std::endl;
+        return false;
+    }
+    file << json.str();
+    ofLogNotice() << "Benchmark results written to " << outPath << std::endl;
+    return true;
+}
+
+
+// Aquarium benchmarks
+namespace {
+
+// Population mixes: plain schooling fish, the Level_2 ratios, a predator heavy tank, and
+// an ecosystem where three species hunt (bigger fish eat the small ones too)
+enum BenchMix { MIX_SCHOOL = 0, MIX_LEVEL = 1, MIX_PREDATORS = 2, MIX_ECOSYSTEM = 3 };
+
+const std::vector<int64_t> SIZES = {10, 100, 1000, 10000, 100000};
+
+std::shared_ptr<AquariumSpriteManager> sharedSprites() {
+    static std::shared_ptr<AquariumSpriteManager> sprites;
+    if (!sprites) {
+        sprites = std::make_shared<AquariumSpriteManager>();
+    }
+    return sprites;
+}
+
+// Keeps creature density at Level_2's (44 fish in 1024x768) however big the population
+void worldSize(int64_t n, int& w, int& h) {
+    float scale = std::max(1.0f, std::sqrt(n / 44.0f));
+    w = static_cast<int>(1024 * scale);
+    h = static_cast<int>(768 * scale);
+}
+
+class BenchmarkLevel : public AquariumLevel {
+public:
+    BenchmarkLevel(int64_t n, int mix) : AquariumLevel(0, INT_MAX) {
+        int total = static_cast<int>(n);
+        switch (mix) {
+            case MIX_SCHOOL:
+                SetPopulation(AquariumCreatureType::NPCreature, total);
+                SetSchoolingWeights(AquariumCreatureType::NPCreature, AquariumSchoolingWeights(1.5f, 1.2f, 1.0f, 0.0f));
+                break;
+            case MIX_LEVEL: {
+                int fast = std::max(1, total / 44);
+                int big = total * 5 / 44;
+                int colorful = total * 8 / 44;
+                SetPopulation(AquariumCreatureType::FastFish, fast);
+                SetPopulation(AquariumCreatureType::BiggerFish, big);
+                SetPopulation(AquariumCreatureType::ColorfulFish, colorful);
+                SetPopulation(AquariumCreatureType::NPCreature, std::max(0, total - fast - big - colorful));
+                SetSchoolingWeights(AquariumCreatureType::NPCreature, AquariumSchoolingWeights(1.5f, 1.2f, 1.0f, 2.5f));
+                SetSchoolingWeights(AquariumCreatureType::ColorfulFish, AquariumSchoolingWeights(1.2f, 0.4f, 0.3f, 1.5f));
+                break;
+            }
+            case MIX_PREDATORS: {
+                int fast = std::max(1, total / 5);
+                SetPopulation(AquariumCreatureType::FastFish, fast);
+                SetPopulation(AquariumCreatureType::BiggerFish, total / 10);
+                SetPopulation(AquariumCreatureType::NPCreature, std::max(0, total - fast - total / 10));
+                SetSchoolingWeights(AquariumCreatureType::NPCreature, AquariumSchoolingWeights(1.5f, 1.2f, 1.0f, 2.5f));
+                break;
+            }
+            case MIX_ECOSYSTEM: {
+                int fast = std::max(1, total / 20);
+                int big = total / 5;
+                int colorful = total / 5;
+                SetPopulation(AquariumCreatureType::FastFish, fast);
+                SetPopulation(AquariumCreatureType::BiggerFish, big);
+                SetPopulation(AquariumCreatureType::ColorfulFish, colorful);
+                SetPopulation(AquariumCreatureType::NPCreature, std::max(0, total - fast - big - colorful));
+                AquariumFoodWeb web = AquariumFoodWeb::Classic();
+                web.set(AquariumCreatureType::BiggerFish, AquariumCreatureType::NPCreature, FoodWebRule::ALWAYS);
+                web.set(AquariumCreatureType::ColorfulFish, AquariumCreatureType::NPCreature, FoodWebRule::IF_STRONGER);
+                SetFoodWeb(web);
+                SetSchoolingWeights(AquariumCreatureType::NPCreature, AquariumSchoolingWeights(1.5f, 1.2f, 1.0f, 2.5f));
+                break;
+            }
+        }
+    }
+    void SetSinglePopulation(AquariumCreatureType t, int n) { SetPopulation(t, n); }
+};
+
+std::shared_ptr<Aquarium> makeAquarium(int64_t n, int mix) {
+    int w, h;
+    worldSize(n, w, h);
+    auto aquarium = std::make_shared<Aquarium>(w, h, sharedSprites());
+    aquarium->addAquariumLevel(std::make_shared<BenchmarkLevel>(n, mix));
+    aquarium->setSpawnBudget(static_cast<int>(n)); // fill in one go, afterwards the usual budget applies
+    aquarium->Repopulate();
+    aquarium->setSpawnBudget(16);
+    return aquarium;
+}
+
+// Creatures of a single type, outside any aquarium
+std::vector<std::shared_ptr<Creature>> makeCreatures(int64_t n, AquariumCreatureType type) {
+    auto level = std::make_shared<BenchmarkLevel>(0, MIX_SCHOOL);
+    level->SetSinglePopulation(type, static_cast<int>(n));
+    int w, h;
+    worldSize(n, w, h);
+    Aquarium aquarium(w, h, sharedSprites());
+    aquarium.addAquariumLevel(level);
+    aquarium.setSpawnBudget(static_cast<int>(n));
+    aquarium.Repopulate();
+    std::vector<std::shared_ptr<Creature>> creatures;
+    for (int i = 0; i < aquarium.getCreatureCount(); ++i) creatures.push_back(aquarium.getCreatureAt(i));
+    return creatures;
+}
+
+std::shared_ptr<PlayerCreature> makePlayer(float x, float y) {
+    auto player = std::make_shared<PlayerCreature>(x, y, 5, sharedSprites()->GetSprite(AquariumCreatureType::NPCreature));
+    player->setDirection(0, 0);
+    return player;
+}
+
+volatile int64_t g_sink = 0; // keeps results alive so the loops aren't optimized away
+
+std::vector<std::vector<int64_t>> sizesTimesMixes(int64_t maxPredatorSize) {
+    std::vector<std::vector<int64_t>> sets;
+    for (int mix = MIX_SCHOOL; mix <= MIX_ECOSYSTEM; ++mix) {
+        for (int64_t n : SIZES) {
+            // lets a benchmark skip the predator heavy tanks where it is known to be slow
+            if ((mix == MIX_PREDATORS || mix == MIX_ECOSYSTEM) && n > maxPredatorSize) continue;
+            sets.push_back({n, mix});
+        }
+    }
+    return sets;
+}
+
+std::vector<std::vector<int64_t>> sizesOnly() {
+    std::vector<std::vector<int64_t>> sets;
+    for (int64_t n : SIZES) sets.push_back({n});
+    return sets;
+}
+
+} // namespace
+
+void RegisterAquariumBenchmarks(BenchmarkRunner& runner) {
+    runner.add("BM_checkCollision", [](BenchmarkState& state) {
+        auto creatures = makeCreatures(state.range(0), AquariumCreatureType::NPCreature);
+        size_t n = creatures.size();
+        int64_t hits = 0;
+        while (state.keepRunning()) {
+            for (size_t i = 0; i < n; ++i) {
+                hits += checkCollision(creatures[i], creatures[(i + 1) % n]);
+            }
+        }
+        g_sink = hits;
+        state.setItemsProcessed(state.iterations() * n);
+    }, sizesOnly(), {"n"});
+
+    runner.add("BM_checkSweptCollision", [](BenchmarkState& state) {
+        auto creatures = makeCreatures(state.range(0), AquariumCreatureType::NPCreature);
+        size_t n = creatures.size();
+        int64_t hits = 0;
+        while (state.keepRunning()) {
+            for (size_t i = 0; i < n; ++i) {
+                hits += checkSweptCollision(*creatures[i], *creatures[(i + 1) % n]);
+            }
+        }
+        g_sink = hits;
+        state.setItemsProcessed(state.iterations() * n);
+    }, sizesOnly(), {"n"});
+
+    runner.add("BM_normalize", [](BenchmarkState& state) {
+        auto creatures = makeCreatures(state.range(0), AquariumCreatureType::NPCreature);
+        while (state.keepRunning()) {
+            for (auto& c : creatures) c->normalize();
+        }
+        state.setItemsProcessed(state.iterations() * creatures.size());
+    }, sizesOnly(), {"n"});
+
+    runner.add("BM_bounce", [](BenchmarkState& state) {
+        auto creatures = makeCreatures(state.range(0), AquariumCreatureType::NPCreature);
+        while (state.keepRunning()) {
+            for (auto& c : creatures) c->bounce();
+        }
+        state.setItemsProcessed(state.iterations() * creatures.size());
+    }, sizesOnly(), {"n"});
+
+    for (int t = 0; t < AQUARIUM_CREATURE_TYPE_COUNT; ++t) {
+        AquariumCreatureType type = static_cast<AquariumCreatureType>(t);
+        runner.add("BM_move_" + AquariumCreatureTypeToString(type), [type](BenchmarkState& state) {
+            auto creatures = makeCreatures(state.range(0), type);
+            while (state.keepRunning()) {
+                for (auto& c : creatures) c->move();
+            }
+            state.setItemsProcessed(state.iterations() * creatures.size());
+        }, sizesOnly(), {"n"});
+    }
+
+    runner.add("BM_AquariumLevel_ConsumeRepopulate", [](BenchmarkState& state) {
+        BenchmarkLevel level(state.range(0), static_cast<int>(state.range(1)));
+        std::vector<AquariumCreatureType> queue;
+        level.Repopulate(queue, INT_MAX);
+        std::vector<AquariumCreatureType> refill;
+        refill.reserve(queue.size());
+        while (state.keepRunning()) {
+            // eat everything, then ask for all of it back
+            for (AquariumCreatureType t : queue) level.ConsumePopulation(t, 0);
+            refill.clear();
+            level.Repopulate(refill, INT_MAX);
+        }
+        state.setItemsProcessed(state.iterations() * queue.size() * 2);
+    }, sizesTimesMixes(100000), {"n", "mix"});
+
+    runner.add("BM_AquariumLevel_RepopulateSteady", [](BenchmarkState& state) {
+        BenchmarkLevel level(state.range(0), MIX_LEVEL);
+        std::vector<AquariumCreatureType> queue;
+        level.Repopulate(queue, INT_MAX);
+        int64_t spawned = 0;
+        while (state.keepRunning()) {
+            queue.clear();
+            spawned += level.Repopulate(queue, 16);
+        }
+        g_sink = spawned;
+    }, sizesOnly(), {"n"});
+
+    runner.add("BM_DetectAquariumCollisions", [](BenchmarkState& state) {
+        auto aquarium = makeAquarium(state.range(0), static_cast<int>(state.range(1)));
+        // far outside the tank so every creature is checked, the worst case
+        auto player = makePlayer(-100000.0f, -100000.0f);
+        int64_t found = 0;
+        while (state.keepRunning()) {
+            found += DetectAquariumCollisions(aquarium, player) != nullptr;
+        }
+        g_sink = found;
+        state.setItemsProcessed(state.iterations() * aquarium->getCreatureCount());
+    }, sizesTimesMixes(100000), {"n", "mix"});
+
+    // every pass gets a fresh tank, otherwise the prey is gone after the first one and
+    // the rest time an empty web. The timed part includes the grid build, as in update()
+    runner.add("BM_ResolvePredation", [](BenchmarkState& state) {
+        int64_t n = state.range(0);
+        int mix = static_cast<int>(state.range(1));
+        int creatures = makeAquarium(n, mix)->getCreatureCount();
+        std::shared_ptr<Aquarium> aquarium;
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            aquarium = makeAquarium(n, mix); // the last one is freed here too, off the clock
+            state.resumeTiming();
+            aquarium->ResolvePredation();
+        }
+        state.setItemsProcessed(state.iterations() * creatures);
+    }, sizesTimesMixes(100000), {"n", "mix"});
+
+    runner.add("BM_AquariumUpdate", [](BenchmarkState& state) {
+        auto aquarium = makeAquarium(state.range(0), static_cast<int>(state.range(1)));
+        aquarium->SetPlayerTarget(aquarium->getWidth() / 2.0f, aquarium->getHeight() / 2.0f);
+        while (state.keepRunning()) {
+            aquarium->update();
+            state.pauseTiming();
+            aquarium->GetAndClearPredationPositions();
+            state.resumeTiming();
+        }
+        state.setItemsProcessed(state.iterations() * aquarium->getCreatureCount());
+    }, sizesTimesMixes(10000), {"n", "mix"});
+
+    // the same tick with the telemetry grids counting, compare with BM_AquariumUpdate
+    runner.add("BM_AquariumUpdate_Telemetry", [](BenchmarkState& state) {
+        auto aquarium = makeAquarium(state.range(0), static_cast<int>(state.range(1)));
+        aquarium->SetPlayerTarget(aquarium->getWidth() / 2.0f, aquarium->getHeight() / 2.0f);
+        SpatialTelemetry telemetry;
+        telemetry.setup(aquarium->getWidth(), aquarium->getHeight());
+        aquarium->setTelemetry(&telemetry);
+        while (state.keepRunning()) {
+            aquarium->update();
+            state.pauseTiming();
+            aquarium->GetAndClearPredationPositions();
+            state.resumeTiming();
+        }
+        g_sink = telemetry.getTicks();
+        state.setItemsProcessed(state.iterations() * aquarium->getCreatureCount());
+    }, sizesTimesMixes(10000), {"n", "mix"});
+
+    // just the telemetry's share of a tick: the sampled creature counts and endTick.
+    // The two benchmarks above differ by less than their run to run noise, this one
+    // is the number to hold against BM_AquariumUpdate for the 1% budget
+    runner.add("BM_SpatialTelemetry_Sample", [](BenchmarkState& state) {
+        auto aquarium = makeAquarium(state.range(0), static_cast<int>(state.range(1)));
+        SpatialTelemetry telemetry;
+        telemetry.setup(aquarium->getWidth(), aquarium->getHeight());
+        std::vector<std::pair<int, ofVec2f>> fish;
+        for (int i = 0; i < aquarium->getCreatureCount(); ++i) {
+            auto creature = aquarium->getCreatureAt(i);
+            fish.push_back({TelemetryLayer::Creature(static_cast<NPCreature&>(*creature).GetType()), ofVec2f(creature->getX(), creature->getY())});
+        }
+        while (state.keepRunning()) {
+            // the move loop walks every creature anyway, what telemetry adds there are the sampled counts
+            for (size_t i = telemetry.getCreatureOffset(); i < fish.size(); i += SpatialTelemetry::CREATURE_STRIDE) {
+                telemetry.add(fish[i].first, fish[i].second.x, fish[i].second.y, SpatialTelemetry::CREATURE_STRIDE);
+            }
+            telemetry.endTick();
+        }
+        g_sink = telemetry.getTicks();
+        state.setItemsProcessed(state.iterations() * fish.size() / SpatialTelemetry::CREATURE_STRIDE);
+    }, sizesTimesMixes(10000), {"n", "mix"});
+
+    // Fill rate of the aquarium background into an offscreen target: the one shader
+    // pass against the old image, bubble circles and tint overlay (shader 0). Items
+    // are pixels, so items_per_second is the fill rate; glFinish makes the GPU's time
+    // count. Needs a real GL context, on CI the same xvfb-run as --render
+    runner.add("BM_WaterBackground", [](BenchmarkState& state) {
+        int width = static_cast<int>(state.range(0));
+        int height = static_cast<int>(state.range(1));
+        ofFbo target;
+        target.allocate(width, height, GL_RGB);
+        ofTexture background;
+        background.allocate(width, height, GL_RGB);
+        WaterBackground water;
+        water.setup(20, width, height);
+        water.setUseShader(state.range(2) != 0);
+        ofFloatColor tint(0.0f, 100 / 255.0f, 150 / 255.0f, 12 / 255.0f);
+        double frames = 0;
+        while (state.keepRunning()) {
+            target.begin();
+            water.draw(background, width, height, frames, tint, ofVec2f(2, -1));
+            target.end();
+            glFinish();
+            frames += 1.0;
+        }
+        state.setItemsProcessed(state.iterations() * int64_t(width) * height);
+    }, {{1024, 768, 0}, {1024, 768, 1}, {1920, 1080, 0}, {1920, 1080, 1}, {3840, 2160, 0}, {3840, 2160, 1}},
+       {"width", "height", "shader"});
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+// A small stand in for Google Benchmark: same loop shape, same JSON schema (so
+// compare.py from that project can diff two result files), but built from the game
+// sources inside the app because sprites need the app's GL context.
+
+class BenchmarkState {
+public:
+    BenchmarkState(int64_t iterations, std::vector<int64_t> args)
+    : m_iterations(iterations), m_args(std::move(args)) {}
+
+    // timing starts on the first call, the loop body runs iterations times
+    bool keepRunning();
+    void pauseTiming();
+    void resumeTiming();
+
+    int64_t range(size_t i) const { return i < m_args.size() ? m_args[i] : 0; }
+    void setItemsProcessed(int64_t items) { m_items = items; }
+    int64_t iterations() const { return m_iterations; }
+
+    double elapsedSeconds() const { return m_elapsed.count(); }
+    double cpuSeconds() const { return m_cpuSeconds; }
+    int64_t itemsProcessed() const { return m_items; }
+
+private:
+    int64_t m_iterations;
+    int64_t m_done = 0;
+    bool m_started = false;
+    bool m_running = false;
+    std::vector<int64_t> m_args;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::duration<double> m_elapsed{0.0};
+    double m_cpuStart = 0.0;
+    double m_cpuSeconds = 0.0;
+    int64_t m_items = 0;
+};
+
+class BenchmarkRunner {
+public:
+    using Fn = std::function<void(BenchmarkState&)>;
+
+    // one run per entry in argSets, named <name>/<arg0>/<arg1>...
+    void add(const std::string& name, Fn fn, std::vector<std::vector<int64_t>> argSets,
+             std::vector<std::string> argNames = {});
+    // runs everything whose name matches filter (regex, empty runs all) and writes JSON
+    bool run(const std::string& outPath, const std::string& filter, double minSeconds);
+
+private:
+    struct Case {
+        std::string name;
+        Fn fn;
+        std::vector<int64_t> args;
+    };
+    std::vector<Case> m_cases;
+};
+
+// Registers the Core and Aquarium benchmarks, see Benchmark.cpp
+void RegisterAquariumBenchmarks(BenchmarkRunner& runner);
@@ -0,0 +1,53 @@
+#include "Camera.h"
+
+
+void AquariumCamera::setViewport(float width, float height) {
+    m_viewWidth = width;
+    m_viewHeight = height;
+    this->clampToWorld();
+}
+
+void AquariumCamera::setWorld(float width, float height) {
+    m_worldWidth = width;
+    m_worldHeight = height;
+    this->clampToWorld();
+}
+
+void AquariumCamera::follow(float x, float y, float smoothing) {
+    m_x += (x - m_viewWidth / 2 - m_x) * smoothing;
+    m_y += (y - m_viewHeight / 2 - m_y) * smoothing;
+    this->clampToWorld();
+}
+
+void AquariumCamera::snapTo(float x, float y) {
+    m_x = x - m_viewWidth / 2;
+    m_y = y - m_viewHeight / 2;
+    this->clampToWorld();
+}
+
+void AquariumCamera::clampToWorld() {
+    // a world smaller than the window is centered instead
+    if (m_worldWidth <= m_viewWidth) m_x = (m_worldWidth - m_viewWidth) / 2;
+    else m_x = ofClamp(m_x, 0.0f, m_worldWidth - m_viewWidth);
+    if (m_worldHeight <= m_viewHeight) m_y = (m_worldHeight - m_viewHeight) / 2;
+    else m_y = ofClamp(m_y, 0.0f, m_worldHeight - m_viewHeight);
+}
+
+void AquariumCamera::begin() const {
+    ofPushMatrix();
+    // whole pixels, otherwise sprites shimmer while the camera eases
+    ofTranslate(-std::round(m_x), -std::round(m_y));
+}
+
+void AquariumCamera::end() const {
+    ofPopMatrix();
+}
+
+ofRectangle AquariumCamera::getView(float margin) const {
+    return ofRectangle(m_x - margin, m_y - margin, m_viewWidth + 2 * margin, m_viewHeight + 2 * margin);
+}
+
+bool AquariumCamera::isVisible(float x, float y, float margin) const {
+    return x >= m_x - margin && x <= m_x + m_viewWidth + margin
+        && y >= m_y - margin && y <= m_y + m_viewHeight + margin;
+}
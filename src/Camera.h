@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+
+// 2D camera over a world bigger than the window. It eases towards a target, never
+// shows anything outside the world and tells the draw code which part is visible.
+class AquariumCamera {
+public:
+    void setViewport(float width, float height);
+    void setWorld(float width, float height);
+    // moves a fraction of the way towards centering (x, y), call once per frame
+    void follow(float x, float y, float smoothing = 0.15f);
+    // jumps straight to (x, y), e.g. after loading a snapshot
+    void snapTo(float x, float y);
+
+    // world space drawing between these two
+    void begin() const;
+    void end() const;
+
+    // visible world rectangle, grown by margin on every side so sprites that are
+    // only partly on screen still count
+    ofRectangle getView(float margin = 0.0f) const;
+    bool isVisible(float x, float y, float margin = 0.0f) const;
+    float getX() const { return m_x; }
+    float getY() const { return m_y; }
+
+private:
+    void clampToWorld();
+    float m_x = 0.0f; // top left corner of the view, world space
+    float m_y = 0.0f;
+    float m_viewWidth = 0.0f;
+    float m_viewHeight = 0.0f;
+    float m_worldWidth = 0.0f;
+    float m_worldHeight = 0.0f;
+};
@@ -1,4 +1,5 @@
 #include "Core.h"
+#include "Snapshot.h"
 
 
 // Creature Inherited Base Behavior
@@ -11,6 +12,42 @@ void Creature::normalize() {
     }
 }
 
+void Creature::writeState(SnapshotWriter& out) const {
+    out.write(m_x);
+    out.write(m_y);
+    out.write(m_dx);
+    out.write(m_dy);
+    out.write(m_speed);
+    out.write(m_collisionRadius);
+    out.write(m_value);
+    out.write(m_sweepX);
+    out.write(m_sweepY);
+}
+
+void Creature::readState(SnapshotReader& in) {
+    m_x = in.read<float>();
+    m_y = in.read<float>();
+    m_dx = in.read<float>();
+    m_dy = in.read<float>();
+    m_speed = in.read<int>();
+    m_collisionRadius = in.read<float>();
+    m_value = in.read<int>();
+    m_sweepX = in.read<float>();
+    m_sweepY = in.read<float>();
+    setFlipped(m_dx < 0);
+}
+
+uint32_t Creature::NextId() {
+    static uint32_t nextId = 0;
+    return ++nextId; // 0 is never a creature
+}
+
+void Creature::drawSprite(SpriteInstance instance) const {
+    if (!m_sprite) return;
+    instance.flipped = m_flipped;
+    SpriteBatch::Get().add(*m_sprite, m_x, m_y, instance);
+}
+
 void Creature::bounce() {
     // Prevent creatures from leaving the aquarium bounds and make them bounce off the walls.
     // Use collision radius as a margin so sprites don't get stuck halfway off-screen.
@@ -104,6 +141,26 @@ bool checkCollision(std::shared_ptr<Creature> a, std::shared_ptr<Creature> b) {
     return distSq <= (radiusSum * radiusSum);
 };
 
+bool checkSweptCollision(const Creature& a, const Creature& b) {
+    // Work in b's frame: a moves from p0 to p0 + v while b stays put, then find the
+    // closest point of that segment to the origin.
+    float p0x = a.getSweepX() - b.getSweepX();
+    float p0y = a.getSweepY() - b.getSweepY();
+    float vx = (a.getX() - a.getSweepX()) - (b.getX() - b.getSweepX());
+    float vy = (a.getY() - a.getSweepY()) - (b.getY() - b.getSweepY());
+
+    float t = 0.0f;
+    float vv = vx * vx + vy * vy;
+    if (vv > 0.0f) {
+        t = -(p0x * vx + p0y * vy) / vv;
+        t = std::min(1.0f, std::max(0.0f, t));
+    }
+    float cx = p0x + vx * t;
+    float cy = p0y + vy * t;
+    float radiusSum = a.getCollisionRadius() + b.getCollisionRadius();
+    return cx * cx + cy * cy <= radiusSum * radiusSum;
+}
+
 
 string GameSceneKindToString(GameSceneKind t){
     switch(t)
@@ -111,6 +168,7 @@ string GameSceneKindToString(GameSceneKind t){
         case GameSceneKind::GAME_INTRO: return "GAME_INTRO";
         case GameSceneKind::AQUARIUM_GAME: return "AQUARIUM_GAME";
         case GameSceneKind::GAME_OVER: return "GAME_OVER";
+        case GameSceneKind::NETWORK_GAME: return "NETWORK_GAME";
     };
     return "UNKNOWN"; // Default case
 };
@@ -174,8 +232,11 @@ void GameIntroScene::Draw(){
     this->m_banner->draw(0,0);
     
     // Add helpful text overlay on intro screen
-    ofTrueTypeFont font;
-    font.load("Verdana.ttf", 18, true, true);
+    if(!this->m_font.isLoaded()){
+        this->m_font.load("Verdana.ttf", 18, true, true);
+        this->m_smallFont.load("Verdana.ttf", 14, true, true);
+    }
+    ofTrueTypeFont& font = this->m_font;
     
     // Draw "Press SPACE to start" text with glow effect
     ofSetColor(0, 0, 0, 180);
@@ -192,8 +253,7 @@ void GameIntroScene::Draw(){
     font.drawString(startMsg, msgX, msgY);
     
     // Add controls hint
-    ofTrueTypeFont smallFont;
-    smallFont.load("Verdana.ttf", 14, true, true);
+    ofTrueTypeFont& smallFont = this->m_smallFont;
     ofSetColor(200, 200, 200);
     string controlsHint = "Press C anytime to view controls";
     float hintWidth = smallFont.stringWidth(controlsHint);
@@ -1,10 +1,16 @@
+#pragma once
 #include <iostream>
 #include <memory>
 #include <utility>
 #include <cmath>
 #include <algorithm>
 #include "ofMain.h"
+#include "AllocTracker.h"
+#include "SpriteBatch.h"
+#include "AssetPack.h"
 
+class SnapshotWriter;
+class SnapshotReader;
 
 class AwaitFrames {
 public:
@@ -25,28 +31,42 @@ private:
 class GameSprite {
 public:
     GameSprite(const std::string& imagePath, int width, int height) {
-        if (!m_image.load(imagePath)) {
+        m_image.setUseTexture(s_useTextures);
+        if (!AssetPack::Get().loadImage(imagePath, m_image)) {
             std::cerr << "Failed to load image: " << imagePath << std::endl;
         }
         m_image.resize(width, height);
-        m_flippedImage = m_image;
-        m_flippedImage.mirror(false, true); // Mirror horizontally
+#ifdef AQUARIUM_ALLOC_TRACKING
+        m_textureBytes.set(int64_t(width) * height * std::max<size_t>(1, m_image.getPixels().getNumChannels()));
+#endif
     }
 
+    // plain draw for full screen images; creatures go through SpriteBatch so
+    // flipping and tinting happen in the sprite shader instead
     void draw(float x, float y) const {
-        if (m_flipped) {
-            m_flippedImage.draw(x, y);
-        } else {
-            m_image.draw(x, y);
-        }
+        m_image.draw(x, y);
     }
 
-    void setFlipped(bool flipped) { m_flipped = flipped; }
+    const ofTexture& getTexture() const { return m_image.getTexture(); }
+    // the multiplayer server has no GL context, its sprites stay in memory only
+    static void SetUseTextures(bool useTextures) { s_useTextures = useTextures; }
+    float getWidth() const { return m_image.getWidth(); }
+    float getHeight() const { return m_image.getHeight(); }
 
 private:
     ofImage m_image;
-    ofImage m_flippedImage;
-    bool m_flipped = false;
+    static inline bool s_useTextures = true;
+#ifdef AQUARIUM_ALLOC_TRACKING
+    // keeps AllocTracker's texture byte count in step with sprite copies
+    struct TrackedTextureBytes {
+        int64_t bytes = 0;
+        TrackedTextureBytes() = default;
+        TrackedTextureBytes(const TrackedTextureBytes& other) : bytes(other.bytes) { AllocTracker::AddTextureBytes(bytes); }
+        TrackedTextureBytes& operator=(const TrackedTextureBytes& other) { set(other.bytes); return *this; }
+        ~TrackedTextureBytes() { AllocTracker::AddTextureBytes(-bytes); }
+        void set(int64_t b) { AllocTracker::AddTextureBytes(b - bytes); bytes = b; }
+    } m_textureBytes;
+#endif
 };
 
 
@@ -64,7 +84,10 @@ protected:
     , m_height(0)
     , m_collisionRadius(collisionRadius)
     , m_value(value)
-    , m_sprite(std::move(sprite)) {}
+    , m_sprite(std::move(sprite))
+    , m_sweepX(x)
+    , m_sweepY(y)
+    , m_id(NextId()) {}
 
     float m_x = 0.0f;
     float m_y = 0.0f;
@@ -76,30 +99,54 @@ protected:
     float m_collisionRadius = 0.0f;
     int m_value = 0;
     std::shared_ptr<GameSprite> m_sprite;
+    bool m_flipped = false;
+    // position when the current collision sweep started, see checkSweptCollision
+    float m_sweepX = 0.0f;
+    float m_sweepY = 0.0f;
+    uint32_t m_id; // unique for the process lifetime, network snapshots refer to creatures by it
 
 public:
     virtual ~Creature() = default;
     virtual void move() = 0;
     virtual void draw() const = 0;
 
-    virtual float getCollisionRadius() const { return m_collisionRadius; }
-    virtual void setCollisionRadius(float radius) { m_collisionRadius = radius; }
+    // not virtual, the collision checks call it for every pair they test
+    float getCollisionRadius() const { return m_collisionRadius; }
+    void setCollisionRadius(float radius) { m_collisionRadius = radius; }
 
     float getX() const { return m_x; }
     float getY() const { return m_y; }
+    void setPosition(float x, float y) { m_x = x; m_y = y; }
+    uint32_t getId() const { return m_id; }
+    float getDx() const { return m_dx; }
+    float getDy() const { return m_dy; }
     int getSpeed() const { return m_speed; }
     void setSpeed(int speed) { m_speed = speed; }
-    void setFlipped(bool flipped) {
-        if (m_sprite) {
-            m_sprite->setFlipped(flipped);
-        }
-    }
+    // facing is per creature, the sprite itself is shared by every creature of a type
+    void setFlipped(bool flipped) { m_flipped = flipped; }
+    bool isFlipped() const { return m_flipped; }
     void setSprite(std::shared_ptr<GameSprite> sprite) { m_sprite = std::move(sprite); }
     int getValue() const { return m_value; }
 
+    // start a new motion segment for swept collision checks at the current position
+    void beginSweep() { m_sweepX = m_x; m_sweepY = m_y; }
+    float getSweepX() const { return m_sweepX; }
+    float getSweepY() const { return m_sweepY; }
+
+    // snapshot support, subclasses with extra state append it after the base fields
+    virtual void writeState(SnapshotWriter& out) const;
+    virtual void readState(SnapshotReader& in);
+
     void setBounds(int w, int h);
     void normalize();
     void bounce();
+
+protected:
+    // queues the sprite at the creature's position, facing the way it swims
+    void drawSprite(SpriteInstance instance = SpriteInstance()) const;
+
+private:
+    static uint32_t NextId();
 };
 
 // GameEvents
@@ -141,6 +188,9 @@ class GameEvent {
 
 
 bool checkCollision(std::shared_ptr<Creature> a, std::shared_ptr<Creature> b);
+// Like checkCollision but over the whole motion of both creatures since their last
+// beginSweep(), so fast movers can't skip through each other between checks.
+bool checkSweptCollision(const Creature& a, const Creature& b);
 
 
 class GameLevel {
@@ -170,7 +220,8 @@ class GameScene {
 enum class GameSceneKind {
     GAME_INTRO,
     AQUARIUM_GAME,
-    GAME_OVER
+    GAME_OVER,
+    NETWORK_GAME
 };
 
 string GameSceneKindToString(GameSceneKind t);
@@ -185,6 +236,8 @@ class GameIntroScene : public GameScene {
     private:
         string m_name;
         std::shared_ptr<GameSprite> m_banner;
+        ofTrueTypeFont m_font; // loaded on the first Draw
+        ofTrueTypeFont m_smallFont;
 };
 
 class GameOverScene : public GameScene {
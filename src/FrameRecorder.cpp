@@ -0,0 +1,140 @@
+#include "FrameRecorder.h"
+#include <cstdlib>
+#include <fstream>
+
+static std::string frameName(int frame, const char* extension) {
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%06d.%s", frame, extension);
+    return name;
+}
+
+FrameRecorder::~FrameRecorder() {
+    this->stop();
+}
+
+bool FrameRecorder::start(const std::string& outDir, FrameFormat format, const FrameCompareSettings& compare) {
+    m_outDir = outDir;
+    m_format = format;
+    m_compare = compare;
+    m_wroteSize = false;
+    m_result = FrameCompareResult();
+    if (!ofDirectory::createDirectory(m_outDir, false, true)) {
+        ofLogError() << "Could not create " << m_outDir << std::endl;
+        return false;
+    }
+    if (m_compare.updateGolden && !ofDirectory::createDirectory(m_compare.goldenDir, false, true)) {
+        ofLogError() << "Could not create " << m_compare.goldenDir << std::endl;
+        return false;
+    }
+    startThread();
+    return true;
+}
+
+void FrameRecorder::enqueue(int frame, ofPixels pixels) {
+    {
+        std::unique_lock<std::mutex> guard(mutex);
+        m_room.wait(guard, [this] { return m_jobs.size() < MAX_QUEUED || !isThreadRunning(); });
+        m_jobs.push_back(Job{frame, std::move(pixels)});
+    }
+    m_wake.notify_one();
+}
+
+void FrameRecorder::stop() {
+    if (!isThreadRunning()) return;
+    {
+        // under the lock so the worker can't miss the wakeup between its check and its wait
+        std::lock_guard<std::mutex> guard(mutex);
+        stopThread();
+    }
+    m_wake.notify_one();
+    waitForThread(false); // the thread drains the queue before it exits
+}
+
+FrameCompareResult FrameRecorder::getResult() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return m_result;
+}
+
+void FrameRecorder::threadedFunction() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> guard(mutex);
+            m_wake.wait(guard, [this] { return !m_jobs.empty() || !isThreadRunning(); });
+            if (m_jobs.empty()) return; // asked to stop and nothing left to write
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        m_room.notify_one();
+        this->write(job);
+        if (!m_compare.goldenDir.empty()) {
+            this->compare(job);
+        }
+    }
+}
+
+void FrameRecorder::write(const Job& job) {
+    bool written = false;
+    if (m_format == FrameFormat::PNG) {
+        written = ofSaveImage(job.pixels, ofFilePath::join(m_outDir, frameName(job.frame, "png")));
+    } else {
+        if (!m_wroteSize) {
+            std::ofstream size(ofFilePath::join(m_outDir, "frames.txt"), std::ios::trunc);
+            size << job.pixels.getWidth() << " " << job.pixels.getHeight() << " " << job.pixels.getNumChannels() << "\n";
+            m_wroteSize = true;
+        }
+        std::ofstream file(ofFilePath::join(m_outDir, frameName(job.frame, "raw")), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(job.pixels.getData()), job.pixels.getTotalBytes());
+        written = static_cast<bool>(file);
+    }
+    if (!written) {
+        ofLogError() << "Could not write frame " << job.frame << " to " << m_outDir << std::endl;
+    }
+    std::lock_guard<std::mutex> guard(mutex);
+    m_result.frames += written ? 1 : 0;
+}
+
+void FrameRecorder::compare(const Job& job) {
+    std::string goldenPath = ofFilePath::join(m_compare.goldenDir, frameName(job.frame, "png"));
+    if (m_compare.updateGolden) {
+        if (!ofSaveImage(job.pixels, goldenPath)) {
+            ofLogError() << "Could not write golden image " << goldenPath << std::endl;
+        }
+        return;
+    }
+
+    ofPixels golden;
+    bool missing = !ofFile::doesFileExist(goldenPath, false) || !ofLoadImage(golden, goldenPath);
+    double bad = missing ? 1.0 : BadPixelShare(job.pixels, golden, m_compare.channelTolerance);
+    bool failed = !missing && bad > m_compare.maxBadPixels;
+    if (missing) {
+        ofLogWarning() << "No golden image for frame " << job.frame << " (" << goldenPath << ")" << std::endl;
+    } else if (failed) {
+        ofLogError() << "Frame " << job.frame << ": " << ofToString(bad * 100.0, 3) << "% of the pixels differ from "
+                     << goldenPath << ", allowed " << ofToString(m_compare.maxBadPixels * 100.0, 3) << "%" << std::endl;
+    }
+    std::lock_guard<std::mutex> guard(mutex);
+    m_result.compared++;
+    m_result.missing += missing ? 1 : 0;
+    m_result.failed += failed ? 1 : 0;
+}
+
+double FrameRecorder::BadPixelShare(const ofPixels& a, const ofPixels& b, int tolerance) {
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight() || a.getWidth() == 0 || a.getHeight() == 0) {
+        return 1.0;
+    }
+    // goldens are PNGs and may have come back with an alpha channel, only RGB counts
+    size_t channelsA = a.getNumChannels();
+    size_t channelsB = b.getNumChannels();
+    if (channelsA < 3 || channelsB < 3) return 1.0;
+    const unsigned char* pa = a.getData();
+    const unsigned char* pb = b.getData();
+    size_t pixels = a.getWidth() * a.getHeight();
+    size_t bad = 0;
+    for (size_t i = 0; i < pixels; i++, pa += channelsA, pb += channelsB) {
+        if (std::abs(pa[0] - pb[0]) > tolerance || std::abs(pa[1] - pb[1]) > tolerance || std::abs(pa[2] - pb[2]) > tolerance) {
+            bad++;
+        }
+    }
+    return static_cast<double>(bad) / pixels;
+}
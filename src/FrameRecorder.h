@@ -0,0 +1,69 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <condition_variable>
+#include "ofMain.h"
+
+// Writes rendered frames to disk on its own thread so the render loop never waits for
+// PNG compression. Frames are frame_<n>.png, or frame_<n>.raw with just the RGB bytes
+// (top row first, size in frames.txt) which is faster to write and easy to diff.
+//
+// With a golden directory every frame is also compared to golden/frame_<n>.png. A
+// channel can be off by channelTolerance and still match (different GL drivers round
+// blending a little differently), a frame fails when more than maxBadPixels of its
+// pixels are off by more than that.
+enum class FrameFormat {
+    PNG,
+    RAW
+};
+
+struct FrameCompareSettings {
+    std::string goldenDir;        // empty, nothing is compared
+    int channelTolerance = 8;     // 0..255
+    double maxBadPixels = 0.001;  // share of the frame, 0.001 = 0.1%
+    bool updateGolden = false;    // write the frames as the new golden images instead
+};
+
+struct FrameCompareResult {
+    int frames = 0;   // frames written
+    int compared = 0;
+    int missing = 0;  // no golden image for the frame
+    int failed = 0;
+};
+
+class FrameRecorder : public ofThread {
+public:
+    // frames waiting to be written, enqueue() blocks past this so a slow disk can't use all the memory
+    static const size_t MAX_QUEUED = 16;
+
+    ~FrameRecorder();
+    bool start(const std::string& outDir, FrameFormat format, const FrameCompareSettings& compare);
+    void enqueue(int frame, ofPixels pixels);
+    // writes whatever is still queued and waits for the thread
+    void stop();
+    FrameCompareResult getResult();
+
+    // fraction of pixels where a channel differs by more than tolerance, 1 when the sizes differ
+    static double BadPixelShare(const ofPixels& a, const ofPixels& b, int tolerance);
+
+protected:
+    void threadedFunction() override;
+
+private:
+    struct Job {
+        int frame = 0;
+        ofPixels pixels;
+    };
+    void write(const Job& job);
+    void compare(const Job& job);
+
+    std::string m_outDir;
+    FrameFormat m_format = FrameFormat::PNG;
+    FrameCompareSettings m_compare;
+    bool m_wroteSize = false;
+    std::deque<Job> m_jobs;
+    std::condition_variable m_wake;
+    std::condition_variable m_room;
+    FrameCompareResult m_result;
+};
@@ -0,0 +1,52 @@
+#include "HudWidget.h"
+
+namespace {
+int g_repaints = 0;
+}
+
+
+void HudWidget::allocate(int width, int height) {
+    m_fbo.allocate(width, height, GL_RGBA);
+    m_valid = false;
+}
+
+void HudWidget::beginPaint() {
+    ++g_repaints;
+    m_fbo.begin();
+    ofClear(0, 0, 0, 0);
+    ofPushStyle();
+    // straight alpha into a transparent target: without this a half transparent
+    // panel ends up with its alpha multiplied in twice
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void HudWidget::endPaint() {
+    ofPopStyle();
+    m_fbo.end();
+    ofEnableAlphaBlending();
+}
+
+void HudWidget::composite(float x, float y) {
+    // the FBO holds premultiplied color, blending it as straight alpha again
+    // darkens the anti-aliased edges
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    m_fbo.draw(x, y);
+    ofEnableAlphaBlending();
+}
+
+uint64_t HudWidget::Key(std::initializer_list<int64_t> values) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    for (int64_t v : values) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (static_cast<uint64_t>(v) >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+int HudWidget::TakeRepaintCount() {
+    int count = g_repaints;
+    g_repaints = 0;
+    return count;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include "ofMain.h"
+
+// A piece of HUD that keeps its pixels in an FBO. draw() is given a key built from
+// everything the widget shows (score, lives, ...); the paint function only runs when
+// the key changes, every other frame is one textured quad.
+class HudWidget {
+public:
+    // size of the cached area, paint() draws in 0..width, 0..height
+    void allocate(int width, int height);
+    bool isAllocated() const { return m_fbo.isAllocated(); }
+
+    template <typename Paint>
+    void draw(float x, float y, uint64_t key, Paint paint) {
+        if (!m_valid || key != m_key) {
+            this->beginPaint();
+            paint();
+            this->endPaint();
+            m_key = key;
+            m_valid = true;
+        }
+        this->composite(x, y);
+    }
+    // forces a repaint next draw, for things outside the key (fonts, window size)
+    void invalidate() { m_valid = false; }
+
+    // mixes values into a widget key
+    static uint64_t Key(std::initializer_list<int64_t> values);
+    // repaints across all widgets since the last call, for the profiler overlay
+    static int TakeRepaintCount();
+
+private:
+    void beginPaint();
+    void endPaint();
+    void composite(float x, float y);
+
+    ofFbo m_fbo;
+    uint64_t m_key = 0;
+    bool m_valid = false;
+};
@@ -0,0 +1,59 @@
+#include "InputBuffer.h"
+#include "Metrics.h"
+#include <algorithm>
+
+
+void InputBuffer::keyPressed(int key, uint64_t micros) {
+    if (!valid(key)) return;
+    if (m_live[key]) {
+        ++m_repeats; // OS key repeat, the key is already down
+        return;
+    }
+    m_live[key] = true;
+    m_pressedSince[key] = true;
+    if (m_waitingTickCount < MAX_PENDING) {
+        m_waitingTick[m_waitingTickCount++] = micros;
+    }
+}
+
+void InputBuffer::keyReleased(int key) {
+    if (!valid(key)) return;
+    m_live[key] = false;
+    m_releasedSince[key] = true;
+}
+
+void InputBuffer::sample(uint64_t micros) {
+    m_down = m_live;
+    m_pressed = m_pressedSince;
+    m_released = m_releasedSince;
+    m_pressedSince.reset();
+    m_releasedSince.reset();
+
+    AquariumMetrics& metrics = AquariumMetrics::Get();
+    for (int i = 0; i < m_waitingTickCount; ++i) {
+        double latency = static_cast<double>(micros - m_waitingTick[i]);
+        record(m_toTick, latency);
+        metrics.inputToTickSeconds->observe(latency * 1e-6);
+        if (m_waitingFrameCount < MAX_PENDING) {
+            m_waitingFrame[m_waitingFrameCount++] = m_waitingTick[i];
+        }
+    }
+    m_waitingTickCount = 0;
+}
+
+void InputBuffer::frameDrawn(uint64_t micros) {
+    AquariumMetrics& metrics = AquariumMetrics::Get();
+    for (int i = 0; i < m_waitingFrameCount; ++i) {
+        double latency = static_cast<double>(micros - m_waitingFrame[i]);
+        record(m_toFrame, latency);
+        metrics.inputToFrameSeconds->observe(latency * 1e-6);
+    }
+    m_waitingFrameCount = 0;
+}
+
+void InputBuffer::record(LatencyStats& stats, double micros) {
+    stats.lastMicros = micros;
+    stats.averageMicros = stats.samples == 0 ? micros : stats.averageMicros * 0.9 + micros * 0.1;
+    stats.maxMicros = std::max(stats.maxMicros, micros);
+    ++stats.samples;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+// Keyboard state for the simulation. Key events only write into the buffer; each
+// simulation tick calls sample() once and then reads a stable picture of that tick:
+// isDown() is the level (held right now), wasPressed()/wasReleased() are the edges
+// since the previous tick. OS key repeats are counted and otherwise ignored, so
+// holding a key moves the player the same however fast the keyboard repeats.
+//
+// It also times every press from the event arriving to the tick that sampled it
+// and to the end of the frame that drew the result.
+class InputBuffer {
+public:
+    static const int MAX_KEYS = 1024; // covers the openFrameworks key codes we use
+
+    void keyPressed(int key, uint64_t micros);
+    void keyReleased(int key); // releases aren't timed, only presses are
+
+    // latch everything since the last tick, call at the start of each tick
+    void sample(uint64_t micros);
+    // call when a frame is done drawing, closes the input to frame measurements
+    void frameDrawn(uint64_t micros);
+
+    bool isDown(int key) const { return valid(key) && m_down[key]; }
+    bool wasPressed(int key) const { return valid(key) && m_pressed[key]; }
+    bool wasReleased(int key) const { return valid(key) && m_released[key]; }
+    // held now or tapped and let go within the tick, what movement wants
+    bool isActive(int key) const { return isDown(key) || wasPressed(key); }
+
+    struct LatencyStats {
+        uint64_t samples = 0;
+        double lastMicros = 0;
+        double averageMicros = 0; // exponential moving average
+        double maxMicros = 0;
+    };
+    const LatencyStats& getInputToTick() const { return m_toTick; }
+    const LatencyStats& getInputToFrame() const { return m_toFrame; }
+    uint64_t getIgnoredRepeats() const { return m_repeats; }
+
+private:
+    static bool valid(int key) { return key >= 0 && key < MAX_KEYS; }
+    static void record(LatencyStats& stats, double micros);
+
+    std::bitset<MAX_KEYS> m_live;     // as the OS reports it
+    std::bitset<MAX_KEYS> m_pressedSince;
+    std::bitset<MAX_KEYS> m_releasedSince;
+    std::bitset<MAX_KEYS> m_down;     // latched by sample()
+    std::bitset<MAX_KEYS> m_pressed;
+    std::bitset<MAX_KEYS> m_released;
+    uint64_t m_repeats = 0;
+
+    // presses waiting for a tick, then for a frame; fixed size, extra presses
+    // inside one frame just go unmeasured
+    static const int MAX_PENDING = 16;
+    std::array<uint64_t, MAX_PENDING> m_waitingTick{};
+    int m_waitingTickCount = 0;
+    std::array<uint64_t, MAX_PENDING> m_waitingFrame{};
+    int m_waitingFrameCount = 0;
+    LatencyStats m_toTick;
+    LatencyStats m_toFrame;
+};
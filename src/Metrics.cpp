@@ -0,0 +1,281 @@
+#include "Metrics.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define closeSocket closesocket
+#define INVALID_SOCK INVALID_SOCKET
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define closeSocket close
+#define INVALID_SOCK -1
+#endif
+
+// a scraper that hangs up mid-response must not SIGPIPE the whole game
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0 // macOS sets SO_NOSIGPIPE on the socket instead, Windows has no SIGPIPE
+#endif
+
+
+// MetricHistogram
+MetricHistogram::MetricHistogram(std::vector<double> bounds) : m_bounds(std::move(bounds)) {
+    if (m_bounds.size() > MAX_BUCKETS) {
+        m_bounds.resize(MAX_BUCKETS);
+    }
+}
+
+void MetricHistogram::observe(double v) {
+    size_t i = 0;
+    while (i < m_bounds.size() && v > m_bounds[i]) ++i;
+    m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    double sum = m_sum.load(std::memory_order_relaxed);
+    while (!m_sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {}
+}
+
+
+// MetricsRegistry
+MetricsRegistry& MetricsRegistry::Get() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Entry* MetricsRegistry::find(const std::string& name) {
+    for (auto& entry : m_entries) {
+        if (entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (Entry* e = find(name)) return *e->counter;
+    m_entries.push_back(Entry{Kind::COUNTER, name, help, std::make_unique<MetricCounter>(), nullptr, nullptr});
+    return *m_entries.back().counter;
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (Entry* e = find(name)) return *e->gauge;
+    m_entries.push_back(Entry{Kind::GAUGE, name, help, nullptr, std::make_unique<MetricGauge>(), nullptr});
+    return *m_entries.back().gauge;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, std::vector<double> bounds) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (Entry* e = find(name)) return *e->histogram;
+    m_entries.push_back(Entry{Kind::HISTOGRAM, name, help, nullptr, nullptr, std::make_unique<MetricHistogram>(std::move(bounds))});
+    return *m_entries.back().histogram;
+}
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    std::ostringstream out;
+    std::string lastFamily;
+    for (const auto& e : m_entries) {
+        size_t brace = e.name.find('{');
+        std::string family = e.name.substr(0, brace);
+        std::string labels = brace == std::string::npos ? "" : e.name.substr(brace + 1, e.name.size() - brace - 2);
+        if (family != lastFamily) {
+            const char* type = e.kind == Kind::COUNTER ? "counter" : e.kind == Kind::GAUGE ? "gauge" : "histogram";
+            out << "# HELP " << family << " " << e.help << "\n";
+            out << "# TYPE " << family << " " << type << "\n";
+            lastFamily = family;
+        }
+        switch (e.kind) {
+            case Kind::COUNTER:
+                out << e.name << " " << e.counter->value() << "\n";
+                break;
+            case Kind::GAUGE:
+                out << e.name << " " << e.gauge->value() << "\n";
+                break;
+            case Kind::HISTOGRAM: {
+                const MetricHistogram& h = *e.histogram;
+                std::string sep = labels.empty() ? "" : ",";
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i <= h.bounds().size(); ++i) {
+                    cumulative += h.bucketCount(i);
+                    std::string le = i < h.bounds().size() ? ofToString(h.bounds()[i]) : "+Inf";
+                    out << family << "_bucket{" << labels << sep << "le=\"" << le << "\"} " << cumulative << "\n";
+                }
+                std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+                out << family << "_sum" << suffix << " " << h.sum() << "\n";
+                out << family << "_count" << suffix << " " << h.count() << "\n";
+                break;
+            }
+        }
+    }
+    return out.str();
+}
+
+
+// AquariumMetrics
+AquariumMetrics& AquariumMetrics::Get() {
+    static AquariumMetrics metrics;
+    return metrics;
+}
+
+AquariumMetrics::AquariumMetrics() {
+    MetricsRegistry& r = MetricsRegistry::Get();
+    for (int t = 0; t < AQUARIUM_CREATURE_TYPE_COUNT; ++t) {
+        std::string label = "{type=\"" + AquariumCreatureTypeToString(static_cast<AquariumCreatureType>(t)) + "\"}";
+        spawned[t] = &r.counter("aquarium_creatures_spawned_total" + label, "Creatures that entered the tank, spawned or swapped in with a new level");
+    }
+    for (int t = 0; t < AQUARIUM_CREATURE_TYPE_COUNT; ++t) {
+        std::string label = "{type=\"" + AquariumCreatureTypeToString(static_cast<AquariumCreatureType>(t)) + "\"}";
+        eatenByPlayer[t] = &r.counter("aquarium_eaten_by_player_total" + label, "Creatures eaten by the player");
+    }
+    for (int predator = 0; predator < AQUARIUM_CREATURE_TYPE_COUNT; ++predator) {
+        for (int t = 0; t < AQUARIUM_CREATURE_TYPE_COUNT; ++t) {
+            std::string label = "{predator=\"" + AquariumCreatureTypeToString(static_cast<AquariumCreatureType>(predator))
+                              + "\",type=\"" + AquariumCreatureTypeToString(static_cast<AquariumCreatureType>(t)) + "\"}";
+            eatenByCreature[predator][t] = &r.counter("aquarium_eaten_by_creature_total" + label, "Creatures eaten by other creatures");
+        }
+    }
+    collisions = &r.counter("aquarium_player_collisions_total", "Player collisions found by DetectAquariumCollisions");
+    livesLost = &r.counter("aquarium_player_lives_lost_total", "Lives lost by the player");
+    levelTransitions = &r.counter("aquarium_level_transitions_total", "Completed levels");
+    aiDecisions = &r.counter("aquarium_ai_decisions_total", "Creature behavior decisions made by the AI scheduler");
+    creatures = &r.gauge("aquarium_creatures", "Creatures currently in the tank");
+    particles = &r.gauge("aquarium_particles", "Live effect particles");
+    ripples = &r.gauge("aquarium_ripples", "Live ripples");
+    level = &r.gauge("aquarium_level", "Current level number");
+    effectsQuality = &r.gauge("aquarium_effects_quality_tier", "Effects quality tier, 0 is full quality");
+    aiDeferred = &r.gauge("aquarium_ai_deferred", "Behaviors that were due last tick but left for later by the AI budget");
+    frameSeconds = &r.histogram("aquarium_frame_seconds", "Time between frames",
+                                {0.004, 0.008, 0.012, 0.0167, 0.020, 0.025, 0.033, 0.050, 0.100, 0.250});
+    tickSeconds = &r.histogram("aquarium_tick_seconds", "Time spent in one simulation tick",
+                               {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.002, 0.004, 0.008, 0.016});
+    transitionSeconds = &r.histogram("aquarium_level_transition_seconds", "Time spent swapping in a new level",
+                                     {0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.016});
+    inputToTickSeconds = &r.histogram("aquarium_input_to_tick_seconds", "Time from a key press to the simulation tick that saw it",
+                                      {0.001, 0.002, 0.004, 0.008, 0.012, 0.0167, 0.025, 0.033, 0.050, 0.100});
+    inputToFrameSeconds = &r.histogram("aquarium_input_to_frame_seconds", "Time from a key press to the end of the frame that drew it",
+                                       {0.004, 0.008, 0.0167, 0.025, 0.033, 0.050, 0.067, 0.100, 0.250});
+}
+
+
+// MetricsExporter
+MetricsExporter::~MetricsExporter() {
+    this->stop();
+}
+
+void MetricsExporter::start(int httpPort, const std::string& filePath, float flushSeconds) {
+    if (isThreadRunning()) return;
+    if (httpPort <= 0 && filePath.empty()) return; // nothing to export to
+    m_port = httpPort;
+    m_filePath = filePath;
+    m_flushSeconds = std::max(0.5f, flushSeconds);
+    startThread();
+}
+
+void MetricsExporter::stop() {
+    if (!isThreadRunning()) return;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopThread();
+    }
+    m_wake.notify_one();
+    waitForThread(false);
+}
+
+bool MetricsExporter::openListener() {
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    auto sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCK) return false;
+    int yes = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(m_port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // kiosk only, never exposed to the network
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(sock, 4) != 0) {
+        closeSocket(sock);
+        return false;
+    }
+    m_listener = static_cast<intptr_t>(sock);
+    ofLogNotice() << "Metrics available on http://127.0.0.1:" << m_port << "/metrics" << std::endl;
+    return true;
+}
+
+// Answers every scrape waiting on the listener, waits at most 200ms when there is none
+void MetricsExporter::serveClients() {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(m_listener, &readable);
+    timeval timeout{0, 200000};
+    if (select(static_cast<int>(m_listener + 1), &readable, nullptr, nullptr, &timeout) <= 0) return;
+
+    auto client = accept(m_listener, nullptr, nullptr);
+    if (client == INVALID_SOCK) return;
+#ifdef SO_NOSIGPIPE
+    int noSigPipe = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+    // a client that connects and never sends would block the flushes and stop() on recv
+    fd_set request;
+    FD_ZERO(&request);
+    FD_SET(client, &request);
+    timeval requestTimeout{0, 100000};
+    if (select(static_cast<int>(client + 1), &request, nullptr, nullptr, &requestTimeout) <= 0) {
+        closeSocket(client);
+        return;
+    }
+    char buffer[1024];
+    recv(client, buffer, sizeof(buffer), 0); // any request gets the metrics, only the path matters to scrapers
+    std::string body = MetricsRegistry::Get().render();
+    std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                         + ofToString(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    send(client, response.data(), static_cast<int>(response.size()), SEND_FLAGS);
+    closeSocket(client);
+}
+
+void MetricsExporter::flushFile() {
+    // write next to the target and rename so readers never see half a file
+    std::string tmp = m_filePath + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::trunc);
+        if (!file) return;
+        file << MetricsRegistry::Get().render();
+    }
+    std::remove(m_filePath.c_str());
+    std::rename(tmp.c_str(), m_filePath.c_str());
+}
+
+void MetricsExporter::threadedFunction() {
+    if (m_port > 0 && !openListener()) {
+        ofLogError() << "Could not listen for metrics on 127.0.0.1:" << m_port << std::endl;
+    }
+    auto nextFlush = std::chrono::steady_clock::now();
+    while (isThreadRunning()) {
+        if (!m_filePath.empty() && std::chrono::steady_clock::now() >= nextFlush) {
+            flushFile();
+            nextFlush += std::chrono::milliseconds(static_cast<int>(m_flushSeconds * 1000));
+        }
+        if (m_listener >= 0) {
+            serveClients();
+        } else {
+            std::unique_lock<std::mutex> guard(mutex);
+            m_wake.wait_until(guard, nextFlush, [this] { return !isThreadRunning(); });
+        }
+    }
+    if (!m_filePath.empty()) flushFile(); // last numbers before shutting down
+    if (m_listener >= 0) {
+        closeSocket(m_listener);
+        m_listener = -1;
+    }
+}
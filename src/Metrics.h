@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <condition_variable>
+#include "ofMain.h"
+#include "Aquarium.h"
+
+// Metric updates are a relaxed atomic add or store so they can sit in the
+// simulation loop; only registration and exporting take the registry lock.
+
+class MetricCounter {
+public:
+    void add(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+class MetricGauge {
+public:
+    void set(double v) { m_value.store(v, std::memory_order_relaxed); }
+    double value() const { return m_value.load(std::memory_order_relaxed); }
+private:
+    std::atomic<double> m_value{0.0};
+};
+
+class MetricHistogram {
+public:
+    static const int MAX_BUCKETS = 16;
+    // upper bounds in ascending order, anything above the last one lands in +Inf
+    explicit MetricHistogram(std::vector<double> bounds);
+    void observe(double v);
+    const std::vector<double>& bounds() const { return m_bounds; }
+    uint64_t bucketCount(int i) const { return m_buckets[i].load(std::memory_order_relaxed); }
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    double sum() const { return m_sum.load(std::memory_order_relaxed); }
+private:
+    std::vector<double> m_bounds;
+    std::array<std::atomic<uint64_t>, MAX_BUCKETS + 1> m_buckets{}; // last one is +Inf
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<double> m_sum{0.0};
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& Get();
+
+    // name may carry Prometheus labels, e.g. aquarium_eaten_total{type="FastFish"};
+    // metrics sharing the part before '{' are reported as one family
+    MetricCounter& counter(const std::string& name, const std::string& help);
+    MetricGauge& gauge(const std::string& name, const std::string& help);
+    MetricHistogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds);
+
+    // Prometheus text exposition format
+    std::string render() const;
+
+private:
+    enum class Kind { COUNTER, GAUGE, HISTOGRAM };
+    struct Entry {
+        Kind kind;
+        std::string name;
+        std::string help;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+    };
+    Entry* find(const std::string& name);
+    mutable std::mutex m_mutex;
+    std::deque<Entry> m_entries; // deque so references handed out stay valid
+};
+
+// Everything the game reports, registered once so hot paths only touch atomics
+struct AquariumMetrics {
+    static AquariumMetrics& Get();
+
+    std::array<MetricCounter*, AQUARIUM_CREATURE_TYPE_COUNT> spawned;
+    std::array<MetricCounter*, AQUARIUM_CREATURE_TYPE_COUNT> eatenByPlayer;
+    // [predator][prey]
+    std::array<std::array<MetricCounter*, AQUARIUM_CREATURE_TYPE_COUNT>, AQUARIUM_CREATURE_TYPE_COUNT> eatenByCreature;
+    MetricCounter* collisions;
+    MetricCounter* levelTransitions;
+    MetricCounter* aiDecisions;
+    MetricCounter* livesLost;
+    MetricGauge* creatures;
+    MetricGauge* particles;
+    MetricGauge* ripples;
+    MetricGauge* level;
+    MetricGauge* effectsQuality;
+    MetricGauge* aiDeferred;
+    MetricHistogram* frameSeconds;
+    MetricHistogram* tickSeconds;
+    MetricHistogram* transitionSeconds;
+    MetricHistogram* inputToTickSeconds;
+    MetricHistogram* inputToFrameSeconds;
+
+private:
+    AquariumMetrics();
+};
+
+// Serves the registry on http://127.0.0.1:<port>/metrics and/or rewrites a file every
+// few seconds, all from its own thread. Port 0 and an empty path turn the parts off.
+class MetricsExporter : public ofThread {
+public:
+    ~MetricsExporter();
+    void start(int httpPort, const std::string& filePath, float flushSeconds);
+    void stop();
+protected:
+    void threadedFunction() override;
+private:
+    bool openListener();
+    void serveClients();
+    void flushFile();
+    int m_port = 0;
+    std::string m_filePath;
+    float m_flushSeconds = 10.0f;
+    intptr_t m_listener = -1; // socket handle, -1 when closed
+    std::condition_variable m_wake;
+};
@@ -0,0 +1,722 @@
+#include "Multiplayer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace NetProtocol;
+
+namespace {
+const uint32_t TIMEOUT_TICKS = 5 * 60;
+
+void writeHeader(SnapshotWriter& out, PacketType type) {
+    out.data().clear();
+    out.write(MAGIC);
+    out.write(static_cast<uint8_t>(type));
+}
+
+void writePlayer(SnapshotWriter& out, const NetPlayerState& p) {
+    out.write(p.id);
+    out.write(p.x);
+    out.write(p.y);
+    out.write(p.flags);
+    out.write(p.lives);
+    out.write(p.power);
+    out.write(p.charge);
+    out.write(p.score);
+}
+
+NetPlayerState readPlayer(SnapshotReader& in) {
+    NetPlayerState p;
+    p.id = in.read<uint16_t>();
+    p.x = in.read<uint16_t>();
+    p.y = in.read<uint16_t>();
+    p.flags = in.read<uint8_t>();
+    p.lives = in.read<uint8_t>();
+    p.power = in.read<uint8_t>();
+    p.charge = in.read<uint8_t>();
+    p.score = in.read<int32_t>();
+    return p;
+}
+
+// field mask of one entity entry in a snapshot
+const uint8_t FIELD_X = 1;
+const uint8_t FIELD_Y = 2;
+const uint8_t FIELD_LOOK = 4; // type and flags
+const uint8_t FIELD_ALL = FIELD_X | FIELD_Y | FIELD_LOOK;
+const uint8_t REMOVED = 0xff; // type marker while applying a snapshot
+
+size_t entrySize(uint8_t mask) {
+    return sizeof(uint32_t) + 1 + ((mask & FIELD_X) ? 2 : 0) + ((mask & FIELD_Y) ? 2 : 0) + ((mask & FIELD_LOOK) ? 2 : 0);
+}
+
+bool byId(const NetEntityState& a, const NetEntityState& b) { return a.id < b.id; }
+
+std::vector<NetEntityState>::const_iterator findById(const std::vector<NetEntityState>& v, uint32_t id) {
+    NetEntityState key;
+    key.id = id;
+    auto it = std::lower_bound(v.begin(), v.end(), key, byId);
+    return (it != v.end() && it->id == id) ? it : v.end();
+}
+
+void patchCount(SnapshotWriter& out, size_t at, uint16_t count) {
+    std::memcpy(out.data().data() + at, &count, sizeof(count));
+}
+}
+
+
+void NetBoost::apply(PlayerCreature& player, const NetInput& input) {
+    player.setDirection(input.dx, input.dy);
+    if (input.boost && !active && charge > 0.0f) active = true;
+    if (!input.boost) active = false;
+    if (active) {
+        charge -= DEPLETION_PER_TICK;
+        if (charge <= 0.0f) {
+            charge = 0.0f;
+            active = false;
+        }
+    } else {
+        charge = std::min(MAX, charge + RECHARGE_PER_TICK);
+    }
+    player.setSpeed(active ? BOOSTED_SPEED : NORMAL_SPEED);
+}
+
+
+// AquariumServer
+AquariumServer::AquariumServer(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<AquariumSpriteManager> sprites)
+: m_aquarium(std::move(aquarium)), m_sprites(std::move(sprites)) {
+    m_quant.width = m_aquarium->getWidth();
+    m_quant.height = m_aquarium->getHeight();
+}
+
+bool AquariumServer::start(uint16_t port) {
+    if (!m_socket.open(port, false)) {
+        ofLogError() << "Could not open UDP port " << port << " for the server" << std::endl;
+        return false;
+    }
+    ofLogNotice() << "Aquarium server listening on UDP port " << port << ", " << m_aquarium->getCreatureCount()
+                  << " creatures in a " << m_aquarium->getWidth() << "x" << m_aquarium->getHeight() << " tank" << std::endl;
+    return true;
+}
+
+int AquariumServer::getClientCount() const {
+    int count = 0;
+    for (const Client& c : m_clients) count += c.connected ? 1 : 0;
+    return count;
+}
+
+void AquariumServer::update() {
+    m_tick++;
+    this->receive();
+
+    for (Client& client : m_clients) {
+        if (!client.connected) continue;
+        if (m_tick - client.lastHeardTick > TIMEOUT_TICKS) {
+            ofLogNotice() << "Player " << client.playerId << " timed out" << std::endl;
+            client.connected = false;
+            continue;
+        }
+        // one input per tick, like the client predicted it; hold the last one if none arrived
+        if (!client.inputs.empty()) {
+            client.lastInput = client.inputs.front();
+            client.inputs.pop_front();
+            client.lastInputSeq = client.lastInput.seq;
+        }
+        client.boost.apply(*client.player, client.lastInput);
+        client.player->update();
+    }
+
+    if (m_aquariumUpdate.tick()) {
+        Client* target = nullptr;
+        for (Client& client : m_clients) {
+            if (!client.connected) continue;
+            if (ResolvePlayerContact(m_aquarium, client.player) == PlayerContact::DIED) {
+                ofLogNotice() << "Player " << client.playerId << " was eaten with " << client.player->getScore() << " points" << std::endl;
+                this->spawnPlayer(client);
+            }
+            if (!target) target = &client;
+        }
+        // FastFish hunt a single target, the longest connected player
+        if (target) m_aquarium->SetPlayerTarget(target->player->getX(), target->player->getY());
+        m_aquarium->update();
+        m_aquarium->GetAndClearPredationPositions(); // nothing to show them on
+    }
+
+    if (m_tick % SNAPSHOT_INTERVAL == 0) {
+        for (Client& client : m_clients) {
+            if (client.connected) this->sendSnapshot(client);
+        }
+    }
+
+    m_reportTimer += 1.0f / 60.0f;
+    if (m_reportTimer >= 5.0f) {
+        this->reportBandwidth();
+    }
+}
+
+void AquariumServer::receive() {
+    std::array<uint8_t, 2048> buffer;
+    NetAddress from;
+    while (size_t size = m_socket.receive(buffer.data(), buffer.size(), from)) {
+        this->handlePacket(from, buffer.data(), size);
+    }
+}
+
+AquariumServer::Client* AquariumServer::findClient(const NetAddress& address) {
+    for (Client& c : m_clients) {
+        if (c.connected && c.address == address) return &c;
+    }
+    return nullptr;
+}
+
+void AquariumServer::handlePacket(const NetAddress& from, const uint8_t* data, size_t size) {
+    SnapshotReader in(data, size);
+    if (in.read<uint32_t>() != MAGIC) return;
+    PacketType type = static_cast<PacketType>(in.read<uint8_t>());
+    Client* client = this->findClient(from);
+
+    switch (type) {
+        case PacketType::HELLO: {
+            if (in.read<uint8_t>() != VERSION || !in.ok()) {
+                ofLogWarning() << "Client " << from.toString() << " speaks another protocol version" << std::endl;
+                return;
+            }
+            if (!client) {
+                for (Client& c : m_clients) {
+                    if (!c.connected) {
+                        client = &c;
+                        break;
+                    }
+                }
+                if (!client) {
+                    ofLogWarning() << "Server full, ignoring " << from.toString() << std::endl;
+                    return;
+                }
+                *client = Client();
+                client->connected = true;
+                client->address = from;
+                client->playerId = m_nextPlayerId++;
+                this->spawnPlayer(*client);
+                ofLogNotice() << "Player " << client->playerId << " joined from " << from.toString() << std::endl;
+            }
+            client->lastHeardTick = m_tick;
+            this->sendWelcome(*client); // again if the first welcome got lost
+            break;
+        }
+        case PacketType::INPUT: {
+            if (!client) return;
+            uint32_t ack = in.read<uint32_t>();
+            uint8_t count = in.read<uint8_t>();
+            uint32_t newest = client->inputs.empty() ? client->lastInputSeq : client->inputs.back().seq;
+            for (int i = 0; i < count && in.ok(); i++) {
+                NetInput input;
+                input.seq = in.read<uint32_t>();
+                input.dx = in.read<int8_t>();
+                input.dy = in.read<int8_t>();
+                input.boost = in.read<uint8_t>();
+                if (in.ok() && input.seq > newest) {
+                    client->inputs.push_back(input);
+                    newest = input.seq;
+                }
+            }
+            if (!in.ok()) return;
+            // a client running ahead of us would only build up delay, keep a few ticks
+            while (client->inputs.size() > 8) client->inputs.pop_front();
+            client->lastHeardTick = m_tick;
+            if (ack > client->ackedTick && ack <= m_tick) client->ackedTick = ack;
+            break;
+        }
+        case PacketType::BYE:
+            if (client) {
+                ofLogNotice() << "Player " << client->playerId << " left" << std::endl;
+                client->connected = false;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void AquariumServer::spawnPlayer(Client& client) {
+    float x = m_aquarium->getWidth() / 2 - 50 + (client.playerId % 4) * 80.0f - 120.0f;
+    float y = m_aquarium->getHeight() / 2 - 50;
+    client.player = std::make_shared<PlayerCreature>(x, y, NetBoost::NORMAL_SPEED, m_sprites->GetSprite(AquariumCreatureType::NPCreature));
+    client.player->setDirection(0, 0);
+    client.player->setBounds(m_aquarium->getWidth() - 20, m_aquarium->getHeight() - 20);
+    client.boost = NetBoost();
+}
+
+void AquariumServer::sendWelcome(const Client& client) {
+    writeHeader(m_packet, PacketType::WELCOME);
+    m_packet.write(client.playerId);
+    m_packet.write<int32_t>(m_aquarium->getWidth());
+    m_packet.write<int32_t>(m_aquarium->getHeight());
+    m_packet.write(m_tick);
+    m_socket.sendTo(client.address, m_packet.data().data(), m_packet.data().size());
+}
+
+void AquariumServer::sendSnapshot(Client& client) {
+    const PlayerCreature& self = *client.player;
+    float px = self.getX();
+    float py = self.getY();
+
+    // everything around the player
+    m_interest.clear();
+    auto addCreature = [&](const std::shared_ptr<Creature>& creature) {
+        if (!creature) return;
+        NetEntityState e;
+        e.id = creature->getId();
+        e.x = m_quant.qx(creature->getX());
+        e.y = m_quant.qy(creature->getY());
+        e.type = static_cast<uint8_t>(std::static_pointer_cast<NPCreature>(creature)->GetType());
+        e.flags = creature->isFlipped() ? NetEntityState::FLIPPED : 0;
+        m_interest.push_back(e);
+    };
+    float minX = px - INTEREST_HALF_WIDTH, maxX = px + INTEREST_HALF_WIDTH;
+    float minY = py - INTEREST_HALF_HEIGHT, maxY = py + INTEREST_HALF_HEIGHT;
+    if (!m_aquarium->isSpatialGridDirty()) {
+        m_aquarium->getSpatialGrid().forEachInRect(minX, minY, maxX, maxY, [&](int index) {
+            addCreature(m_aquarium->getCreatureAt(index));
+            return true;
+        });
+    } else {
+        for (int i = 0; i < m_aquarium->getCreatureCount(); i++) {
+            std::shared_ptr<Creature> c = m_aquarium->getCreatureAt(i);
+            if (c && c->getX() >= minX && c->getX() <= maxX && c->getY() >= minY && c->getY() <= maxY) addCreature(c);
+        }
+    }
+    // nearest first, whatever doesn't fit in the packet is the least interesting
+    float qpx = m_quant.qx(px), qpy = m_quant.qy(py);
+    auto distSq = [&](const NetEntityState& e) {
+        float dx = (e.x - qpx) * m_quant.width, dy = (e.y - qpy) * m_quant.height;
+        return dx * dx + dy * dy;
+    };
+    std::sort(m_interest.begin(), m_interest.end(), [&](const NetEntityState& a, const NetEntityState& b) {
+        return distSq(a) < distSq(b);
+    });
+    m_interestIds.clear();
+    for (const NetEntityState& e : m_interest) m_interestIds.push_back(e.id);
+    std::sort(m_interestIds.begin(), m_interestIds.end());
+
+    const SentSnapshot* base = nullptr;
+    if (client.ackedTick != 0) {
+        for (const SentSnapshot& s : client.history) {
+            if (s.tick == client.ackedTick) base = &s;
+        }
+    }
+
+    writeHeader(m_packet, PacketType::SNAPSHOT);
+    m_packet.write(m_tick);
+    m_packet.write<uint32_t>(base ? base->tick : 0);
+    m_packet.write(client.lastInputSeq);
+
+    m_packet.write(static_cast<uint8_t>(this->getClientCount()));
+    for (const Client& c : m_clients) {
+        if (!c.connected) continue;
+        NetPlayerState p;
+        p.id = c.playerId;
+        p.x = m_quant.qx(c.player->getX());
+        p.y = m_quant.qy(c.player->getY());
+        p.flags = (c.player->isFlipped() ? NetPlayerState::FLIPPED : 0) | (c.boost.active ? NetPlayerState::BOOST : 0)
+                | (c.player->isHurt() ? NetPlayerState::HURT : 0);
+        p.lives = static_cast<uint8_t>(std::max(0, c.player->getLives()));
+        p.power = static_cast<uint8_t>(std::min(255, c.player->getPower()));
+        p.charge = static_cast<uint8_t>(c.boost.charge / NetBoost::MAX * 255.0f);
+        p.score = c.player->getScore();
+        writePlayer(m_packet, p);
+    }
+
+    // creatures the client knows that are gone or out of range
+    m_known.clear();
+    size_t removalsAt = m_packet.data().size();
+    m_packet.write<uint16_t>(0);
+    uint16_t removals = 0;
+    if (base) {
+        for (const NetEntityState& b : base->known) {
+            if (std::binary_search(m_interestIds.begin(), m_interestIds.end(), b.id)) continue;
+            if (m_packet.data().size() + sizeof(uint32_t) + sizeof(uint16_t) > MAX_PACKET) {
+                m_known.push_back(b); // next time
+                continue;
+            }
+            m_packet.write(b.id);
+            removals++;
+        }
+    }
+    patchCount(m_packet, removalsAt, removals);
+
+    // changed and new creatures, only the fields that differ from the baseline
+    size_t entitiesAt = m_packet.data().size();
+    m_packet.write<uint16_t>(0);
+    uint16_t entries = 0;
+    client.entitiesDeferred = 0;
+    for (const NetEntityState& e : m_interest) {
+        auto b = base ? findById(base->known, e.id) : std::vector<NetEntityState>::const_iterator();
+        bool known = base && b != base->known.end();
+        if (known && *b == e) {
+            m_known.push_back(e);
+            continue;
+        }
+        uint8_t mask = FIELD_ALL;
+        if (known) {
+            mask = (e.x != b->x ? FIELD_X : 0) | (e.y != b->y ? FIELD_Y : 0)
+                 | (e.type != b->type || e.flags != b->flags ? FIELD_LOOK : 0);
+        }
+        if (m_packet.data().size() + entrySize(mask) > MAX_PACKET) {
+            client.entitiesDeferred++;
+            if (known) m_known.push_back(*b); // the client keeps what it had
+            continue;
+        }
+        m_packet.write(e.id);
+        m_packet.write(mask);
+        if (mask & FIELD_X) m_packet.write(e.x);
+        if (mask & FIELD_Y) m_packet.write(e.y);
+        if (mask & FIELD_LOOK) {
+            m_packet.write(e.type);
+            m_packet.write(e.flags);
+        }
+        m_known.push_back(e);
+        entries++;
+    }
+    patchCount(m_packet, entitiesAt, entries);
+    client.entitiesInView = m_interest.size();
+
+    std::sort(m_known.begin(), m_known.end(), byId);
+    SentSnapshot& slot = client.history[(m_tick / SNAPSHOT_INTERVAL) % HISTORY];
+    slot.tick = m_tick;
+    slot.known = m_known; // copy into the slot's own storage, reuses its capacity
+
+    m_socket.sendTo(client.address, m_packet.data().data(), m_packet.data().size());
+    client.bytesSent += m_packet.data().size();
+}
+
+void AquariumServer::reportBandwidth() {
+    for (Client& c : m_clients) {
+        if (!c.connected) continue;
+        ofLogNotice() << "Player " << c.playerId << ": " << ofToString(c.bytesSent / m_reportTimer / 1024.0f, 1) << " KB/s, "
+                      << c.entitiesInView << " creatures in view, " << c.entitiesDeferred << " deferred by the packet cap" << std::endl;
+        c.bytesSent = 0;
+    }
+    m_reportTimer = 0.0f;
+}
+
+
+// NetworkGameScene
+NetworkGameScene::NetworkGameScene(string name, const NetAddress& server, std::shared_ptr<AquariumSpriteManager> sprites)
+: m_name(std::move(name)), m_server(server), m_sprites(std::move(sprites)) {
+    if (!m_socket.open(0, false)) {
+        ofLogError() << "Could not open a UDP socket to reach " << server.toString() << std::endl;
+    }
+}
+
+NetworkGameScene::~NetworkGameScene() {
+    this->Disconnect();
+}
+
+void NetworkGameScene::Disconnect() {
+    if (!m_connected) return;
+    writeHeader(m_packet, PacketType::BYE);
+    this->send(m_packet);
+    m_connected = false;
+}
+
+void NetworkGameScene::send(SnapshotWriter& packet) {
+    m_socket.sendTo(m_server, packet.data().data(), packet.data().size());
+}
+
+void NetworkGameScene::Update() {
+    m_localTicks++;
+    this->receive();
+
+    if (m_localTicks - m_bandwidthStartTick >= 60) {
+        m_bytesPerSecond = m_bytesReceived * 60.0f / (m_localTicks - m_bandwidthStartTick);
+        m_bytesReceived = 0;
+        m_bandwidthStartTick = m_localTicks;
+    }
+
+    if (!m_connected) {
+        // knock every half second until the server answers
+        if (m_lastHelloTick == 0 || m_localTicks - m_lastHelloTick >= 30) {
+            writeHeader(m_packet, PacketType::HELLO);
+            m_packet.write(VERSION);
+            this->send(m_packet);
+            m_lastHelloTick = m_localTicks;
+        }
+        return;
+    }
+    if (m_localTicks - m_lastSnapshotTick > TIMEOUT_TICKS) {
+        ofLogWarning() << "Lost the server at " << m_server.toString() << ", reconnecting" << std::endl;
+        m_connected = false;
+        m_lastHelloTick = 0;
+        return;
+    }
+
+    NetInput input = m_input;
+    input.seq = ++m_inputSeq;
+    m_pendingInputs.push_back(input);
+    while (m_pendingInputs.size() > 120) m_pendingInputs.pop_front();
+
+    writeHeader(m_packet, PacketType::INPUT);
+    // not m_latestTick: after a welcome that is the server's tick, acking it would have
+    // the server send deltas against a snapshot we never got
+    m_packet.write(m_appliedTick);
+    uint8_t count = static_cast<uint8_t>(std::min<size_t>(INPUT_REDUNDANCY, m_pendingInputs.size()));
+    m_packet.write(count);
+    for (size_t i = m_pendingInputs.size() - count; i < m_pendingInputs.size(); i++) {
+        const NetInput& in = m_pendingInputs[i];
+        m_packet.write(in.seq);
+        m_packet.write(in.dx);
+        m_packet.write(in.dy);
+        m_packet.write(in.boost);
+    }
+    this->send(m_packet);
+
+    // predict our own fish right away instead of waiting a round trip
+    m_boost.apply(*m_player, input);
+    m_player->update();
+    m_camera.follow(m_player->getX(), m_player->getY());
+
+    // the render clock runs at our tick rate, pulled gently towards the snapshots
+    float target = static_cast<float>(m_latestTick) - INTERPOLATION_TICKS;
+    m_renderTick += 1.0f;
+    if (std::abs(target - m_renderTick) > 30.0f) m_renderTick = target;
+    else m_renderTick += (target - m_renderTick) * 0.1f;
+}
+
+void NetworkGameScene::receive() {
+    std::array<uint8_t, 2048> buffer;
+    NetAddress from;
+    while (size_t size = m_socket.receive(buffer.data(), buffer.size(), from)) {
+        if (from != m_server) continue;
+        m_bytesReceived += size;
+        SnapshotReader in(buffer.data(), size);
+        if (in.read<uint32_t>() != MAGIC) continue;
+        PacketType type = static_cast<PacketType>(in.read<uint8_t>());
+        if (type == PacketType::WELCOME) this->handleWelcome(in);
+        else if (type == PacketType::SNAPSHOT && m_connected) this->handleSnapshot(in);
+    }
+}
+
+void NetworkGameScene::handleWelcome(SnapshotReader& in) {
+    uint16_t playerId = in.read<uint16_t>();
+    int32_t width = in.read<int32_t>();
+    int32_t height = in.read<int32_t>();
+    uint32_t serverTick = in.read<uint32_t>();
+    if (!in.ok() || m_connected || width <= 0 || height <= 0) return;
+
+    m_playerId = playerId;
+    m_quant.width = width;
+    m_quant.height = height;
+    m_player = std::make_shared<PlayerCreature>(width / 2 - 50, height / 2 - 50, NetBoost::NORMAL_SPEED,
+                                                m_sprites->GetSprite(AquariumCreatureType::NPCreature));
+    m_player->setDirection(0, 0);
+    m_player->setBounds(width - 20, height - 20);
+    m_boost = NetBoost();
+    m_pendingInputs.clear();
+    for (ReceivedSnapshot& s : m_snapshots) s.tick = 0;
+    m_latestTick = serverTick;
+    m_appliedTick = 0;
+    m_renderTick = static_cast<float>(serverTick) - INTERPOLATION_TICKS;
+    m_lastSnapshotTick = m_localTicks;
+    m_camera.setWorld(width, height);
+    m_camera.setViewport(ofGetWidth(), ofGetHeight());
+    m_camera.snapTo(m_player->getX(), m_player->getY());
+    m_connected = true;
+    ofLogNotice() << "Joined " << m_server.toString() << " as player " << playerId << std::endl;
+}
+
+const NetworkGameScene::ReceivedSnapshot* NetworkGameScene::findSnapshot(uint32_t tick) const {
+    for (const ReceivedSnapshot& s : m_snapshots) {
+        if (s.tick == tick && tick != 0) return &s;
+    }
+    return nullptr;
+}
+
+void NetworkGameScene::handleSnapshot(SnapshotReader& in) {
+    uint32_t tick = in.read<uint32_t>();
+    uint32_t baseTick = in.read<uint32_t>();
+    uint32_t lastInputSeq = in.read<uint32_t>();
+    // late (a newer one is already applied) or a duplicate
+    if (!in.ok() || tick < m_latestTick || (tick == m_latestTick && this->findSnapshot(tick))) return;
+
+    const ReceivedSnapshot* base = nullptr;
+    if (baseTick != 0) {
+        base = this->findSnapshot(baseTick);
+        if (!base) return; // we no longer have what it is relative to, the next one will be
+    }
+
+    m_scratchPlayers.clear();
+    uint8_t playerCount = in.read<uint8_t>();
+    for (int i = 0; i < playerCount && in.ok(); i++) m_scratchPlayers.push_back(readPlayer(in));
+
+    if (base) m_scratch = base->entities;
+    else m_scratch.clear();
+    size_t baseCount = m_scratch.size(); // entries past this were added by this snapshot
+    auto findBase = [&](uint32_t id) -> NetEntityState* {
+        NetEntityState key;
+        key.id = id;
+        auto it = std::lower_bound(m_scratch.begin(), m_scratch.begin() + baseCount, key, byId);
+        return (it != m_scratch.begin() + baseCount && it->id == id) ? &*it : nullptr;
+    };
+
+    uint16_t removals = in.read<uint16_t>();
+    for (int i = 0; i < removals && in.ok(); i++) {
+        if (NetEntityState* e = findBase(in.read<uint32_t>())) e->type = REMOVED;
+    }
+    uint16_t entries = in.read<uint16_t>();
+    for (int i = 0; i < entries && in.ok(); i++) {
+        uint32_t id = in.read<uint32_t>();
+        uint8_t mask = in.read<uint8_t>();
+        NetEntityState fresh;
+        fresh.id = id;
+        NetEntityState* e = findBase(id);
+        if (!e) {
+            if (mask != FIELD_ALL) {
+                in.fail(); // a change to a creature we never heard of
+                break;
+            }
+            e = &fresh;
+        }
+        if (mask & FIELD_X) e->x = in.read<uint16_t>();
+        if (mask & FIELD_Y) e->y = in.read<uint16_t>();
+        if (mask & FIELD_LOOK) {
+            e->type = in.read<uint8_t>();
+            e->flags = in.read<uint8_t>();
+        }
+        if (e == &fresh) m_scratch.push_back(fresh);
+    }
+    if (!in.ok()) {
+        ofLogVerbose() << "Dropped a damaged snapshot" << std::endl;
+        return;
+    }
+    m_scratch.erase(std::remove_if(m_scratch.begin(), m_scratch.end(),
+                                   [](const NetEntityState& e) { return e.type == REMOVED || e.type >= AQUARIUM_CREATURE_TYPE_COUNT; }),
+                    m_scratch.end());
+    std::sort(m_scratch.begin(), m_scratch.end(), byId);
+
+    ReceivedSnapshot& slot = m_snapshots[(tick / SNAPSHOT_INTERVAL) % HISTORY];
+    slot.tick = tick;
+    slot.entities.swap(m_scratch);
+    slot.players = m_scratchPlayers;
+    m_latestTick = tick;
+    m_appliedTick = tick;
+    m_lastSnapshotTick = m_localTicks;
+
+    for (const NetPlayerState& p : slot.players) {
+        if (p.id == m_playerId) this->reconcile(p, lastInputSeq);
+    }
+}
+
+// Puts our fish where the server has it and replays the inputs it hasn't seen yet
+void NetworkGameScene::reconcile(const NetPlayerState& self, uint32_t lastInputSeq) {
+    m_self = self;
+    while (!m_pendingInputs.empty() && m_pendingInputs.front().seq <= lastInputSeq) {
+        m_pendingInputs.pop_front();
+    }
+    m_player->setPosition(m_quant.x(self.x), m_quant.y(self.y));
+    m_boost.charge = self.charge / 255.0f * NetBoost::MAX;
+    m_boost.active = (self.flags & NetPlayerState::BOOST) != 0;
+    for (const NetInput& input : m_pendingInputs) {
+        m_boost.apply(*m_player, input);
+        m_player->move();
+    }
+}
+
+void NetworkGameScene::drawEntities(float renderTick) {
+    // the two snapshots around the render time
+    const ReceivedSnapshot* from = nullptr;
+    const ReceivedSnapshot* to = nullptr;
+    for (const ReceivedSnapshot& s : m_snapshots) {
+        if (s.tick == 0) continue;
+        if (s.tick <= renderTick && (!from || s.tick > from->tick)) from = &s;
+        if (s.tick > renderTick && (!to || s.tick < to->tick)) to = &s;
+    }
+    if (!to) {
+        to = from; // ran out of snapshots, hold the newest
+    }
+    if (!to) return;
+    float t = (from && from != to) ? ofClamp((renderTick - from->tick) / float(to->tick - from->tick), 0.0f, 1.0f) : 1.0f;
+
+    auto position = [&](uint16_t x1, uint16_t y1, uint16_t x0, uint16_t y0, bool hasFrom) {
+        float x = m_quant.x(x1), y = m_quant.y(y1);
+        if (hasFrom) {
+            x = ofLerp(m_quant.x(x0), x, t);
+            y = ofLerp(m_quant.y(y0), y, t);
+        }
+        return ofVec2f(x, y);
+    };
+
+    ofRectangle view = m_camera.getView(140.0f);
+    // one pass per type keeps the sprite batch at one draw call per texture
+    for (int type = 0; type < AQUARIUM_CREATURE_TYPE_COUNT; type++) {
+        std::shared_ptr<GameSprite> sprite = m_sprites->GetSprite(static_cast<AquariumCreatureType>(type));
+        for (const NetEntityState& e : to->entities) {
+            if (e.type != type) continue;
+            auto f = (from && from != to) ? findById(from->entities, e.id) : to->entities.end();
+            bool hasFrom = from && from != to && f != from->entities.end();
+            ofVec2f p = position(e.x, e.y, hasFrom ? f->x : 0, hasFrom ? f->y : 0, hasFrom);
+            if (!view.inside(p.x, p.y)) continue;
+            SpriteInstance instance;
+            instance.flipped = e.flags & NetEntityState::FLIPPED;
+            SpriteBatch::Get().add(*sprite, p.x, p.y, instance);
+        }
+    }
+
+    // the other players, blinking red while hurt like our own
+    std::shared_ptr<GameSprite> playerSprite = m_sprites->GetSprite(AquariumCreatureType::NPCreature);
+    for (const NetPlayerState& p : to->players) {
+        if (p.id == m_playerId) continue;
+        const NetPlayerState* f = nullptr;
+        if (from && from != to) {
+            for (const NetPlayerState& q : from->players) {
+                if (q.id == p.id) f = &q;
+            }
+        }
+        ofVec2f pos = position(p.x, p.y, f ? f->x : 0, f ? f->y : 0, f != nullptr);
+        SpriteInstance instance;
+        instance.flipped = p.flags & NetPlayerState::FLIPPED;
+        instance.flash = (p.flags & NetPlayerState::HURT) && (m_localTicks / 10) % 2 == 0 ? 1.0f : 0.0f;
+        instance.hue = (p.flags & NetPlayerState::BOOST) ? fmodf(m_localTicks / 150.0f, 1.0f) : -1.0f;
+        SpriteBatch::Get().add(*playerSprite, pos.x, pos.y, instance);
+    }
+}
+
+void NetworkGameScene::Draw() {
+    if (!m_connected) {
+        ofSetColor(ofColor::white);
+        ofDrawBitmapStringHighlight("Connecting to " + m_server.toString() + " ...", ofGetWidth() / 2 - 120, ofGetHeight() / 2);
+        return;
+    }
+    m_camera.begin();
+    ofNoFill();
+    ofSetColor(100, 200, 255, 120);
+    ofDrawRectangle(0, 0, m_quant.width, m_quant.height);
+    ofFill();
+    ofSetColor(ofColor::white);
+    SpriteBatch::Get().begin();
+    this->drawEntities(m_renderTick);
+    m_player->setHueCycle(m_boost.active ? fmodf(m_localTicks / 150.0f, 1.0f) : -1.0f);
+    m_player->draw();
+    SpriteBatch::Get().end();
+    m_camera.end();
+    this->paintHUD();
+}
+
+void NetworkGameScene::paintHUD() {
+    if (!m_hud.isAllocated()) {
+        m_hud.allocate(200, 80);
+    }
+    int kbps = static_cast<int>(m_bytesPerSecond / 1024.0f * 10.0f); // tenths of KB/s
+    int players = 0;
+    if (const ReceivedSnapshot* latest = this->findSnapshot(m_latestTick)) players = latest->players.size();
+    ofSetColor(ofColor::white);
+    m_hud.draw(ofGetWindowWidth() - 200, 0, HudWidget::Key({m_self.score, m_self.power, m_self.lives, players, kbps}), [&]() {
+        ofSetColor(ofColor::white);
+        ofDrawBitmapString("Score: " + std::to_string(m_self.score), 10, 20);
+        ofDrawBitmapString("Power: " + std::to_string(m_self.power), 10, 30);
+        ofDrawBitmapString("Lives: " + std::to_string(m_self.lives), 10, 40);
+        ofDrawBitmapString("Players: " + std::to_string(players) + "  " + ofToString(kbps / 10.0f, 1) + " KB/s", 10, 50);
+        ofSetColor(ofColor::red);
+        for (int i = 0; i < m_self.lives; ++i) {
+            ofDrawCircle(10 + i * 20, 62, 5);
+        }
+    });
+    ofSetColor(ofColor::white);
+}
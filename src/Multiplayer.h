@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "Aquarium.h"
+#include "Snapshot.h"
+#include "Net.h"
+
+// Several players in one aquarium. A headless server process (--server) owns the
+// Aquarium and every PlayerCreature and runs the same fixed 60 Hz tick as the game;
+// clients (--connect) send their input every tick and get snapshots back 20 times a
+// second. Everything runs over UDP and works on loopback.
+//
+// Snapshots only carry creatures near the receiving player (interest management),
+// positions quantized to 16 bits, and are delta encoded against the last snapshot
+// the client acknowledged. Packets are capped at MAX_PACKET bytes, nearest creatures
+// first, so a client's bandwidth stays bounded however many creatures the tank has.
+// Packets use SnapshotWriter's raw byte order, so both ends must be the same kind of box.
+namespace NetProtocol {
+const uint32_t MAGIC = 0x4e515141; // "AQQN"
+const uint8_t VERSION = 1;
+const int SNAPSHOT_INTERVAL = 3;    // ticks between snapshots, 20 a second
+const size_t MAX_PACKET = 1200;     // stays under a typical MTU
+const int HISTORY = 32;             // snapshots kept on both ends to delta against
+const int INTERPOLATION_TICKS = 6;  // remote creatures are drawn this far in the past (two snapshots)
+const float INTEREST_HALF_WIDTH = 800.0f;  // a bit more than half a 1024x768 view,
+const float INTEREST_HALF_HEIGHT = 600.0f; // so creatures are known before they scroll in
+const int MAX_CLIENTS = 8;
+const int INPUT_REDUNDANCY = 4;     // each input packet repeats the last few inputs against loss
+
+enum class PacketType : uint8_t {
+    HELLO,
+    WELCOME,
+    INPUT,
+    SNAPSHOT,
+    BYE
+};
+}
+
+// One creature as a client sees it
+struct NetEntityState {
+    uint32_t id = 0;
+    uint16_t x = 0; // quantized over the tank size
+    uint16_t y = 0;
+    uint8_t type = 0;
+    uint8_t flags = 0; // FLIPPED
+
+    static const uint8_t FLIPPED = 1;
+    bool operator==(const NetEntityState& o) const { return x == o.x && y == o.y && type == o.type && flags == o.flags; }
+};
+
+struct NetPlayerState {
+    uint16_t id = 0;
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint8_t flags = 0; // FLIPPED, BOOST, HURT
+    uint8_t lives = 0;
+    uint8_t power = 0;
+    uint8_t charge = 0; // boost charge, 0..255
+    int32_t score = 0;
+
+    static const uint8_t FLIPPED = 1;
+    static const uint8_t BOOST = 2;
+    static const uint8_t HURT = 4;
+};
+
+struct NetInput {
+    uint32_t seq = 0;
+    int8_t dx = 0; // -1, 0, 1
+    int8_t dy = 0;
+    uint8_t boost = 0;
+};
+
+// Maps tank coordinates to 16 bits and back (about 0.05px in a 3072px tank)
+struct NetQuantizer {
+    float width = 1.0f;
+    float height = 1.0f;
+    uint16_t qx(float x) const { return static_cast<uint16_t>(ofClamp(x / width, 0.0f, 1.0f) * 65535.0f + 0.5f); }
+    uint16_t qy(float y) const { return static_cast<uint16_t>(ofClamp(y / height, 0.0f, 1.0f) * 65535.0f + 0.5f); }
+    float x(uint16_t q) const { return q / 65535.0f * width; }
+    float y(uint16_t q) const { return q / 65535.0f * height; }
+};
+
+// Boost rules shared by the server and the client's prediction so both agree
+struct NetBoost {
+    static constexpr float MAX = 100.0f;
+    static constexpr float DEPLETION_PER_TICK = 50.0f / 60.0f;
+    static constexpr float RECHARGE_PER_TICK = 25.0f / 60.0f;
+    static const int NORMAL_SPEED = 5;
+    static const int BOOSTED_SPEED = 12;
+
+    float charge = MAX;
+    bool active = false;
+    // applies one tick of input to the player's direction and speed
+    void apply(PlayerCreature& player, const NetInput& input);
+};
+
+
+class AquariumServer {
+public:
+    AquariumServer(std::shared_ptr<Aquarium> aquarium, std::shared_ptr<AquariumSpriteManager> sprites);
+    bool start(uint16_t port);
+    // one 60 Hz tick: read packets, move players, tick the tank, send snapshots
+    void update();
+
+    int getClientCount() const;
+
+private:
+    struct SentSnapshot {
+        uint32_t tick = 0;
+        std::vector<NetEntityState> known; // what the client has after it, sorted by id
+    };
+    struct Client {
+        bool connected = false;
+        NetAddress address;
+        uint16_t playerId = 0;
+        std::shared_ptr<PlayerCreature> player;
+        NetBoost boost;
+        std::deque<NetInput> inputs;
+        NetInput lastInput;
+        uint32_t lastInputSeq = 0;
+        uint32_t ackedTick = 0;
+        uint32_t lastHeardTick = 0;
+        std::array<SentSnapshot, NetProtocol::HISTORY> history;
+        uint64_t bytesSent = 0;    // since the last bandwidth report
+        int entitiesInView = 0;
+        int entitiesDeferred = 0;  // changed but left out by the packet cap
+    };
+
+    void receive();
+    void handlePacket(const NetAddress& from, const uint8_t* data, size_t size);
+    Client* findClient(const NetAddress& address);
+    void sendWelcome(const Client& client);
+    void sendSnapshot(Client& client);
+    void spawnPlayer(Client& client);
+    void reportBandwidth();
+
+    std::shared_ptr<Aquarium> m_aquarium;
+    std::shared_ptr<AquariumSpriteManager> m_sprites;
+    NetQuantizer m_quant;
+    UdpSocket m_socket;
+    std::array<Client, NetProtocol::MAX_CLIENTS> m_clients;
+    uint16_t m_nextPlayerId = 1;
+    uint32_t m_tick = 0;
+    AwaitFrames m_aquariumUpdate{5}; // same tank rate as the single player scene
+    SnapshotWriter m_packet;
+    std::vector<NetEntityState> m_interest; // scratch, reused for every client
+    std::vector<uint32_t> m_interestIds;
+    std::vector<NetEntityState> m_known;
+    float m_reportTimer = 0.0f;
+};
+
+
+// The game scene of a --connect client: predicts its own player from local input,
+// draws everything else interpolated between the last two snapshots.
+class NetworkGameScene : public GameScene {
+public:
+    NetworkGameScene(string name, const NetAddress& server, std::shared_ptr<AquariumSpriteManager> sprites);
+    ~NetworkGameScene();
+    string GetName() override { return m_name; }
+    void Update() override;
+    void Draw() override;
+
+    // direction -1..1 per axis and the boost key, read every tick
+    void SetInput(int dx, int dy, bool boost) { m_input.dx = dx; m_input.dy = dy; m_input.boost = boost; }
+    void Disconnect();
+    AquariumCamera& GetCamera() { return m_camera; }
+    bool IsConnected() const { return m_connected; }
+    float GetReceivedBytesPerSecond() const { return m_bytesPerSecond; }
+
+private:
+    struct ReceivedSnapshot {
+        uint32_t tick = 0;
+        std::vector<NetEntityState> entities; // sorted by id
+        std::vector<NetPlayerState> players;
+    };
+
+    void send(SnapshotWriter& packet);
+    void receive();
+    void handleWelcome(SnapshotReader& in);
+    void handleSnapshot(SnapshotReader& in);
+    void reconcile(const NetPlayerState& self, uint32_t lastInputSeq);
+    const ReceivedSnapshot* findSnapshot(uint32_t tick) const;
+    void drawEntities(float renderTick);
+    void paintHUD();
+
+    string m_name;
+    NetAddress m_server;
+    std::shared_ptr<AquariumSpriteManager> m_sprites;
+    UdpSocket m_socket;
+    bool m_connected = false;
+    uint16_t m_playerId = 0;
+    NetQuantizer m_quant;
+    std::shared_ptr<PlayerCreature> m_player; // predicted locally
+    NetBoost m_boost;
+    NetInput m_input;
+    uint32_t m_inputSeq = 0;
+    std::deque<NetInput> m_pendingInputs; // sent but not yet confirmed by a snapshot
+    NetPlayerState m_self;
+
+    std::array<ReceivedSnapshot, NetProtocol::HISTORY> m_snapshots;
+    uint32_t m_latestTick = 0;
+    uint32_t m_appliedTick = 0; // newest snapshot we actually have, what we ack; 0 for none
+    float m_renderTick = 0.0f; // server ticks, runs one per local tick and is nudged towards the latest snapshot
+    uint32_t m_localTicks = 0;
+    uint32_t m_lastHelloTick = 0;
+    uint32_t m_lastSnapshotTick = 0; // local tick the last snapshot arrived on
+    std::vector<NetEntityState> m_scratch;
+    std::vector<NetPlayerState> m_scratchPlayers;
+
+    uint64_t m_bytesReceived = 0;
+    float m_bytesPerSecond = 0.0f;
+    uint32_t m_bandwidthStartTick = 0;
+
+    AquariumCamera m_camera;
+    HudWidget m_hud;
+    SnapshotWriter m_packet;
+};
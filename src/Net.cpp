@@ -0,0 +1,98 @@
+#include "Net.h"
+#include "ofMain.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define closeSocket closesocket
+#define INVALID_SOCK INVALID_SOCKET
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define closeSocket ::close
+#define INVALID_SOCK -1
+#endif
+
+
+std::string NetAddress::toString() const {
+    return ofToString((ip >> 24) & 0xff) + "." + ofToString((ip >> 16) & 0xff) + "." + ofToString((ip >> 8) & 0xff)
+         + "." + ofToString(ip & 0xff) + ":" + ofToString(port);
+}
+
+bool NetAddress::Parse(const std::string& text, NetAddress& out) {
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos) return false;
+    std::string host = text.substr(0, colon);
+    int port = ofToInt(text.substr(colon + 1));
+    if (port <= 0 || port > 65535) return false;
+    if (host == "localhost") host = "127.0.0.1";
+    in_addr addr{};
+    if (inet_pton(AF_INET, host.c_str(), &addr) != 1) return false;
+    out.ip = ntohl(addr.s_addr);
+    out.port = static_cast<uint16_t>(port);
+    return true;
+}
+
+UdpSocket::~UdpSocket() {
+    this->close();
+}
+
+bool UdpSocket::open(uint16_t port, bool loopbackOnly) {
+    this->close();
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    auto sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == INVALID_SOCK) return false;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        closeSocket(sock);
+        return false;
+    }
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(sock, FIONBIO, &nonBlocking);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    m_socket = static_cast<intptr_t>(sock);
+    return true;
+}
+
+void UdpSocket::close() {
+    if (m_socket == -1) return;
+    closeSocket(m_socket);
+    m_socket = -1;
+}
+
+bool UdpSocket::sendTo(const NetAddress& to, const uint8_t* data, size_t size) {
+    if (m_socket == -1) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(to.port);
+    addr.sin_addr.s_addr = htonl(to.ip);
+    auto sent = sendto(m_socket, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+                       reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    return sent == static_cast<decltype(sent)>(size);
+}
+
+size_t UdpSocket::receive(uint8_t* buffer, size_t capacity, NetAddress& from) {
+    if (m_socket == -1) return 0;
+    sockaddr_in addr{};
+    socklen_t length = sizeof(addr);
+    auto received = recvfrom(m_socket, reinterpret_cast<char*>(buffer), static_cast<int>(capacity), 0,
+                             reinterpret_cast<sockaddr*>(&addr), &length);
+    if (received <= 0) return 0; // would block, or an ICMP error from a client that went away
+    from.ip = ntohl(addr.sin_addr.s_addr);
+    from.port = ntohs(addr.sin_port);
+    return static_cast<size_t>(received);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// IPv4 address and port in host byte order
+struct NetAddress {
+    uint32_t ip = 0;
+    uint16_t port = 0;
+
+    bool operator==(const NetAddress& other) const { return ip == other.ip && port == other.port; }
+    bool operator!=(const NetAddress& other) const { return !(*this == other); }
+    std::string toString() const;
+    // "127.0.0.1:7777" or "localhost:7777", no DNS on purpose
+    static bool Parse(const std::string& text, NetAddress& out);
+};
+
+// Non-blocking UDP socket, same raw socket calls as the metrics endpoint
+class UdpSocket {
+public:
+    ~UdpSocket();
+    // port 0 picks any free port (clients), loopbackOnly keeps it off the network
+    bool open(uint16_t port, bool loopbackOnly);
+    void close();
+    bool isOpen() const { return m_socket != -1; }
+
+    bool sendTo(const NetAddress& to, const uint8_t* data, size_t size);
+    // bytes received, 0 when nothing is waiting
+    size_t receive(uint8_t* buffer, size_t capacity, NetAddress& from);
+
+private:
+    intptr_t m_socket = -1;
+};
@@ -0,0 +1,96 @@
+#include "QualityGovernor.h"
+#include "ofMain.h"
+#include <algorithm>
+
+namespace {
+// particleScale, maxParticles, bubbles, rippleFade, comboEffects, overlayEffects
+const QualitySettings TIER_SETTINGS[static_cast<int>(QualityTier::COUNT)] = {
+    {1.0f, 400, 20, 8.0f, true, true},   // HIGH, what the game always did
+    {0.6f, 200, 12, 12.0f, true, true},  // MEDIUM
+    {0.3f, 80, 6, 20.0f, false, false},  // LOW
+    {0.0f, 0, 0, 40.0f, false, false},   // MINIMAL, just a quick ripple on eats
+};
+
+const float DOWNGRADE_LOAD = 0.9f; // average over this starts counting towards a lower tier
+const float UPGRADE_LOAD = 0.5f;   // and under this towards a higher one
+const int DOWNGRADE_FRAMES = 30;   // ~0.5 s at 60 fps
+const int UPGRADE_FRAMES = 180;    // ~3 s
+}
+
+const char* QualityTierToString(QualityTier tier) {
+    switch (tier) {
+        case QualityTier::HIGH: return "high";
+        case QualityTier::MEDIUM: return "medium";
+        case QualityTier::LOW: return "low";
+        case QualityTier::MINIMAL: return "minimal";
+        default: return "unknown";
+    }
+}
+
+QualityGovernor::QualityGovernor(float budgetSeconds) : m_budget(budgetSeconds) {}
+
+void QualityGovernor::observe(float workSeconds, float frameSeconds) {
+    float load = workSeconds / m_budget;
+    // a quarter over budget means we really missed a vsync, not just jitter
+    if (frameSeconds > m_budget * 1.25f) {
+        load = std::max(load, frameSeconds / m_budget);
+    }
+    m_samples[m_next] = load;
+    m_next = (m_next + 1) % WINDOW;
+    m_sampleCount = std::min(m_sampleCount + 1, WINDOW);
+
+    float sum = 0.0f;
+    for (int i = 0; i < m_sampleCount; i++) sum += m_samples[i];
+    m_load = sum / m_sampleCount;
+
+    if (!m_automatic || m_sampleCount < WINDOW) return;
+
+    if (m_load > DOWNGRADE_LOAD) {
+        m_underFrames = 0;
+        if (++m_overFrames >= DOWNGRADE_FRAMES && m_tier != QualityTier::MINIMAL) {
+            this->setTier(static_cast<QualityTier>(static_cast<int>(m_tier) + 1));
+        }
+    } else if (m_load < UPGRADE_LOAD) {
+        m_overFrames = 0;
+        if (++m_underFrames >= UPGRADE_FRAMES && m_tier != QualityTier::HIGH) {
+            this->setTier(static_cast<QualityTier>(static_cast<int>(m_tier) - 1));
+        }
+    } else {
+        // in between: stay where we are
+        m_overFrames = 0;
+        m_underFrames = 0;
+    }
+}
+
+void QualityGovernor::setMode(const std::string& mode) {
+    if (mode.empty() || mode == "auto") {
+        m_automatic = true;
+        return;
+    }
+    for (int t = 0; t < static_cast<int>(QualityTier::COUNT); t++) {
+        if (mode == QualityTierToString(static_cast<QualityTier>(t))) {
+            m_automatic = false;
+            this->setTier(static_cast<QualityTier>(t));
+            return;
+        }
+    }
+    ofLogWarning() << "Unknown effects quality " << mode << ", using auto" << std::endl;
+    m_automatic = true;
+}
+
+const QualitySettings& QualityGovernor::getSettings() const {
+    return TIER_SETTINGS[static_cast<int>(m_tier)];
+}
+
+void QualityGovernor::setTier(QualityTier tier) {
+    if (tier != m_tier) {
+        ofLogNotice() << "Effects quality " << QualityTierToString(m_tier) << " -> " << QualityTierToString(tier)
+                      << " (load " << m_load << ")" << std::endl;
+    }
+    m_tier = tier;
+    m_overFrames = 0;
+    m_underFrames = 0;
+    // judge the new tier on its own frames
+    m_sampleCount = 0;
+    m_next = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+enum class QualityTier {
+    HIGH,
+    MEDIUM,
+    LOW,
+    MINIMAL,
+    COUNT
+};
+
+const char* QualityTierToString(QualityTier tier);
+
+// What each tier lets the effects do
+struct QualitySettings {
+    float particleScale;  // share of each particle burst that gets spawned
+    int maxParticles;     // live particles at most
+    int bubbles;          // background bubbles drawn
+    float rippleFade;     // alpha lost per frame, higher is a shorter ripple
+    bool comboEffects;    // combo text shadow and pulse
+    bool overlayEffects;  // rounded, bordered controls overlay instead of a plain box
+};
+
+// Watches how much of the frame budget update() + draw() use and moves through the
+// quality tiers. Going down needs about half a second over budget, going back up
+// needs a few seconds well under it, so it doesn't flip between tiers every frame.
+class QualityGovernor {
+public:
+    // budgetSeconds is the frame we want to hit, 1/60 s by default
+    explicit QualityGovernor(float budgetSeconds = 1.0f / 60.0f);
+
+    // workSeconds: time spent in update() and draw(), frameSeconds: time between frames.
+    // A late frame counts even if our own work was cheap (the GPU or the OS took it).
+    void observe(float workSeconds, float frameSeconds);
+
+    // "auto" lets the governor decide, a tier name pins it
+    void setMode(const std::string& mode);
+    bool isAutomatic() const { return m_automatic; }
+
+    QualityTier getTier() const { return m_tier; }
+    const QualitySettings& getSettings() const;
+    // average share of the budget used over the last window, 1.0 is exactly on budget
+    float getLoad() const { return m_load; }
+
+private:
+    void setTier(QualityTier tier);
+
+    static constexpr int WINDOW = 30; // frames averaged
+    float m_budget;
+    std::array<float, WINDOW> m_samples{};
+    int m_sampleCount = 0;
+    int m_next = 0;
+    float m_load = 0.0f;
+    int m_overFrames = 0;  // consecutive frames with the average over budget
+    int m_underFrames = 0; // consecutive frames with the average comfortably under
+    QualityTier m_tier = QualityTier::HIGH;
+    bool m_automatic = true;
+};
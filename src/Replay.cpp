@@ -0,0 +1,327 @@
+#include "Replay.h"
+#include "ofApp.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+
+// ReplaySession
+bool ReplaySession::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+    *this = ReplaySession();
+    std::string word;
+    while (file >> word) {
+        if (word == "seed") {
+            file >> seed;
+        } else if (word == "frames") {
+            file >> frames;
+        } else if (word == "key_down" || word == "key_up") {
+            ReplayKeyEvent event;
+            event.pressed = (word == "key_down");
+            file >> event.frame >> event.key;
+            events.push_back(event);
+        } else if (word[0] == '#') {
+            std::getline(file, word);
+        } else {
+            ofLogError() << "Unknown replay entry '" << word << "' in " << path << std::endl;
+            return false;
+        }
+        if (!file) return false;
+    }
+    // events must be in frame order for the playback cursor
+    std::stable_sort(events.begin(), events.end(), [](const ReplayKeyEvent& a, const ReplayKeyEvent& b) {
+        return a.frame < b.frame;
+    });
+    return frames > 0;
+}
+
+bool ReplaySession::Save(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+    file << "seed " << seed << "\n";
+    file << "frames " << frames << "\n";
+    for (const ReplayKeyEvent& event : events) {
+        file << (event.pressed ? "key_down " : "key_up ") << event.frame << " " << event.key << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+
+// ReplayExpectation
+bool ReplayExpectation::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+    *this = ReplayExpectation();
+    std::string word;
+    while (file >> word) {
+        if (word[0] == '#') { std::getline(file, word); continue; }
+        if (word == "state_hash") { file >> stateHash; continue; }
+        double value = 0;
+        file >> value;
+        if (word == "p50_us") budgetP50 = value;
+        else if (word == "p95_us") budgetP95 = value;
+        else if (word == "p99_us") budgetP99 = value;
+        else if (word == "tolerance") tolerance = value;
+        else if (word == "slack_us") slackMicros = value;
+        else if (word == "baseline_p50_us") baselineP50 = value; // older files kept them here
+        else if (word == "baseline_p95_us") baselineP95 = value;
+        else if (word == "baseline_p99_us") baselineP99 = value;
+        else ofLogWarning() << "Unknown expectation '" << word << "' in " << path << std::endl;
+    }
+    return true;
+}
+
+bool ReplayExpectation::LoadBaseline(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string word;
+    while (file >> word) {
+        if (word[0] == '#') { std::getline(file, word); continue; }
+        double value = 0;
+        file >> value;
+        if (word == "baseline_p50_us") baselineP50 = value;
+        else if (word == "baseline_p95_us") baselineP95 = value;
+        else if (word == "baseline_p99_us") baselineP99 = value;
+        else ofLogWarning() << "Unknown baseline '" << word << "' in " << path << std::endl;
+    }
+    return true;
+}
+
+bool ReplayExpectation::Save(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+    file << "# budgets, microseconds per aquarium tick\n";
+    file << "p50_us " << budgetP50 << "\n";
+    file << "p95_us " << budgetP95 << "\n";
+    file << "p99_us " << budgetP99 << "\n";
+    file << "tolerance " << tolerance << "\n";
+    file << "slack_us " << slackMicros << "\n";
+    file << "# written by --replay_update_baseline\n";
+    if (!stateHash.empty()) file << "state_hash " << stateHash << "\n";
+    return static_cast<bool>(file);
+}
+
+bool ReplayExpectation::SaveBaseline(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+    file << "# this machine's timings, written by --replay_update_baseline and not committed\n";
+    file << "baseline_p50_us " << baselineP50 << "\n";
+    file << "baseline_p95_us " << baselineP95 << "\n";
+    file << "baseline_p99_us " << baselineP99 << "\n";
+    return static_cast<bool>(file);
+}
+
+
+// Harness
+static double percentile(const std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return static_cast<double>(sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1]);
+}
+
+// hands the app every key event stamped up to this frame
+static void feedEvents(ofApp& app, const ReplaySession& session, int frame, size_t& cursor) {
+    while (cursor < session.events.size() && session.events[cursor].frame <= frame) {
+        const ReplayKeyEvent& event = session.events[cursor++];
+        if (event.pressed) app.keyPressed(event.key);
+        else app.keyReleased(event.key);
+    }
+}
+
+static ReplayResult playReplay(const ReplaySession& session) {
+    // a fresh app per replay so nothing carries over from the window's own game
+    auto app = std::make_shared<ofApp>();
+    app->options.headless = true;
+    app->options.seed = session.seed;
+    app->setup();
+    ofSetLogLevel(OF_LOG_WARNING); // creature logging would dominate the timings
+
+    std::vector<int64_t> ticks;
+    ticks.reserve(session.frames / 5 + 1);
+    size_t cursor = 0;
+    for (int frame = 0; frame < session.frames; frame++) {
+        feedEvents(*app, session, frame, cursor);
+        app->update();
+        auto gameScene = std::dynamic_pointer_cast<AquariumGameScene>(app->gameManager->GetActiveScene());
+        if (gameScene != nullptr && gameScene->GetLastTickMicros() >= 0) {
+            ticks.push_back(gameScene->GetLastTickMicros());
+        }
+    }
+
+    ReplayResult result;
+    std::sort(ticks.begin(), ticks.end());
+    result.ticks = ticks.size();
+    result.p50 = percentile(ticks, 0.50);
+    result.p95 = percentile(ticks, 0.95);
+    result.p99 = percentile(ticks, 0.99);
+
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(app->gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)AquariumSnapshot::StateHash(*gameScene->GetAquarium(), *gameScene->GetPlayer()));
+    result.stateHash = hash;
+    app->exit();
+    ofSetLogLevel(OF_LOG_NOTICE);
+    return result;
+}
+
+// logs every problem and returns false if there was at least one
+static bool checkResult(const std::string& name, const ReplayResult& result, const ReplayExpectation& expect) {
+    bool ok = true;
+    auto checkBudget = [&](const char* label, double measured, double budget) {
+        if (budget > 0 && measured > budget) {
+            ofLogError() << name << ": " << label << " " << measured << " us is over the budget of " << budget << " us" << std::endl;
+            ok = false;
+        }
+    };
+    auto checkBaseline = [&](const char* label, double measured, double baseline) {
+        if (baseline > 0 && measured > baseline * (1.0 + expect.tolerance) + expect.slackMicros) {
+            ofLogError() << name << ": " << label << " " << measured << " us regressed more than "
+                         << expect.tolerance * 100 << "% and " << expect.slackMicros << " us from the baseline of "
+                         << baseline << " us" << std::endl;
+            ok = false;
+        }
+    };
+    checkBudget("p50", result.p50, expect.budgetP50);
+    checkBudget("p95", result.p95, expect.budgetP95);
+    checkBudget("p99", result.p99, expect.budgetP99);
+    checkBaseline("p50", result.p50, expect.baselineP50);
+    checkBaseline("p95", result.p95, expect.baselineP95);
+    checkBaseline("p99", result.p99, expect.baselineP99);
+
+    if (expect.stateHash.empty()) {
+        // without one a determinism regression would pass unnoticed
+        ofLogError() << name << ": no state_hash stored, run with --replay_update_baseline to record one" << std::endl;
+        ok = false;
+    } else if (expect.stateHash != result.stateHash) {
+        ofLogError() << name << ": final state hash " << result.stateHash << " does not match " << expect.stateHash
+                     << ", the simulation no longer behaves the same" << std::endl;
+        ok = false;
+    }
+    if (result.ticks == 0) {
+        ofLogError() << name << ": the aquarium never ticked, did the replay start the game?" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+int RunReplayChecks(const std::string& directory, bool updateBaseline) {
+    ofDirectory dir(directory);
+    dir.allowExt("aqreplay");
+    dir.listDir();
+    dir.sort();
+    if (dir.size() == 0) {
+        ofLogError() << "No replays found in " << directory << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < dir.size(); i++) {
+        std::string replayPath = dir.getPath(i);
+        std::string name = dir.getName(i);
+        ReplaySession session;
+        if (!session.Load(replayPath)) {
+            ofLogError() << name << ": could not read replay" << std::endl;
+            failures++;
+            continue;
+        }
+        std::string expectPath = ofFilePath::removeExt(replayPath) + ".expect";
+        ReplayExpectation expect;
+        if (!expect.Load(expectPath)) {
+            ofLogWarning() << name << ": no " << ofFilePath::getFileName(expectPath) << ", run with --replay_update_baseline to write one" << std::endl;
+        }
+        // without a baseline only the budgets and the hash are checked
+        std::string baselinePath = ofFilePath::removeExt(replayPath) + ".baseline";
+        expect.LoadBaseline(baselinePath);
+
+        ReplayResult result = playReplay(session);
+        ofLogNotice() << name << ": " << result.ticks << " ticks, p50 " << result.p50 << " us, p95 " << result.p95
+                      << " us, p99 " << result.p99 << " us, state " << result.stateHash << std::endl;
+
+        if (updateBaseline) {
+            expect.baselineP50 = result.p50;
+            expect.baselineP95 = result.p95;
+            expect.baselineP99 = result.p99;
+            expect.stateHash = result.stateHash;
+            if (!expect.Save(expectPath) || !expect.SaveBaseline(baselinePath)) {
+                ofLogError() << name << ": could not write " << expectPath << " or " << baselinePath << std::endl;
+                failures++;
+            }
+            continue;
+        }
+        if (!checkResult(name, result, expect)) {
+            failures++;
+        }
+    }
+    if (failures > 0) {
+        ofLogError() << failures << " of " << dir.size() << " replays failed" << std::endl;
+    } else {
+        ofLogNotice() << "All " << dir.size() << " replays passed" << std::endl;
+    }
+    return failures;
+}
+
+
+// Rendering
+int RunReplayRender(const std::string& replayPath, const ReplayRenderSettings& settings) {
+    ReplaySession session;
+    if (!session.Load(replayPath)) {
+        ofLogError() << "Could not read replay " << replayPath << std::endl;
+        return 1;
+    }
+    FrameRecorder recorder;
+    if (!recorder.start(settings.outDir, settings.format, settings.compare)) {
+        return 1;
+    }
+
+    auto app = std::make_shared<ofApp>();
+    app->options.headless = true;
+    app->options.seed = session.seed;
+    app->setup();
+    // the governor follows the machine's frame times, pin it so every run looks the same
+    app->quality.setMode(QualityTierToString(QualityTier::HIGH));
+    ofSetLogLevel(OF_LOG_WARNING);
+
+    // the same size as the window, draw() lays the HUD out with ofGetWidth()/ofGetHeight()
+    ofFbo fbo;
+    fbo.allocate(ofGetWidth(), ofGetHeight(), GL_RGB);
+    int every = std::max(1, settings.every);
+    uint64_t start = ofGetElapsedTimeMicros();
+    size_t cursor = 0;
+    int rendered = 0;
+    for (int frame = 0; frame < session.frames; frame++) {
+        feedEvents(*app, session, frame, cursor);
+        app->update();
+        if (frame % every != 0) continue;
+        fbo.begin();
+        ofClear(0, 0, 0, 255);
+        ofSetColor(255);
+        app->draw();
+        fbo.end();
+        ofPixels pixels;
+        fbo.readToPixels(pixels);
+        recorder.enqueue(frame, std::move(pixels)); // blocks when the encoder falls behind
+        rendered++;
+    }
+    recorder.stop();
+    double seconds = (ofGetElapsedTimeMicros() - start) * 1e-6;
+    app->exit();
+    ofSetLogLevel(OF_LOG_NOTICE);
+
+    FrameCompareResult result = recorder.getResult();
+    ofLogNotice() << ofFilePath::getFileName(replayPath) << ": rendered " << rendered << " of " << session.frames << " frames in "
+                  << ofToString(seconds, 2) << " s (" << ofToString(session.frames / 60.0 / std::max(seconds, 1e-6), 1)
+                  << "x real time), " << result.frames << " written to " << settings.outDir << std::endl;
+    if (result.frames != rendered) {
+        return 1;
+    }
+    if (settings.compare.goldenDir.empty()) {
+        return 0;
+    }
+    if (settings.compare.updateGolden) {
+        ofLogNotice() << "Golden images updated in " << settings.compare.goldenDir << std::endl;
+        return 0;
+    }
+    ofLogNotice() << result.compared << " frames compared, " << result.failed << " differ, " << result.missing << " have no golden image" << std::endl;
+    return result.failed > 0 || result.missing > 0 ? 1 : 0;
+}
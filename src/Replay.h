@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "FrameRecorder.h"
+
+// A recorded session: the seed the game started with and every key event, stamped
+// with the number of ofApp::update() calls that ran before it. Stored as text,
+//   seed 1234
+//   frames 3600
+//   key_down 120 32
+//   key_up 180 32
+// so small replays can be written or tweaked by hand.
+struct ReplayKeyEvent {
+    int frame;
+    bool pressed;
+    int key;
+};
+
+struct ReplaySession {
+    uint32_t seed = 0;
+    int frames = 0;
+    std::vector<ReplayKeyEvent> events;
+
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+};
+
+// <replay name>.expect next to the replay. Budgets are hard limits in microseconds
+// per aquarium tick; the baseline is what the last accepted run measured and a run
+// fails when it is more than tolerance (0.25 = 25%) slower than that. Any value left
+// at 0 (or an empty hash) is not checked.
+struct ReplayExpectation {
+    double budgetP50 = 0;
+    double budgetP95 = 0;
+    double budgetP99 = 0;
+    double tolerance = 0.25;
+    double slackMicros = 20; // on top of the tolerance, timer and scheduler noise on short ticks
+    double baselineP50 = 0;
+    double baselineP95 = 0;
+    double baselineP99 = 0;
+    std::string stateHash;
+
+    // <name>.expect holds the budgets and the hash and is committed; the baseline
+    // percentiles depend on the machine and live next to it in <name>.baseline
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+    bool LoadBaseline(const std::string& path);
+    bool SaveBaseline(const std::string& path) const;
+};
+
+struct ReplayResult {
+    int ticks = 0;
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    std::string stateHash;
+};
+
+// Runs every *.aqreplay in a directory through a fresh headless ofApp and checks it
+// against its .expect file and, when this machine has one, its .baseline. Returns the
+// number of replays that failed. With updateBaseline the final hash goes into the
+// .expect and the measured percentiles into the .baseline instead.
+int RunReplayChecks(const std::string& directory, bool updateBaseline);
+
+// Plays a replay through a fresh headless ofApp and draws every Nth frame into an
+// offscreen FBO instead of the window, so it runs as fast as the GPU (or Mesa's
+// software rasterizer on CI) can draw. The frames go to outDir through a
+// FrameRecorder and can be compared against golden images. Returns nonzero when a
+// frame could not be written or did not match.
+struct ReplayRenderSettings {
+    std::string outDir;
+    int every = 1;
+    FrameFormat format = FrameFormat::PNG;
+    FrameCompareSettings compare;
+};
+
+int RunReplayRender(const std::string& replayPath, const ReplayRenderSettings& settings);
@@ -0,0 +1,180 @@
+#include "SfxMixer.h"
+#include <cmath>
+
+
+SfxMixer::~SfxMixer() {
+    this->close();
+}
+
+bool SfxMixer::setup(int sampleRate, int bufferSize) {
+    this->synthesize(sampleRate);
+
+    ofSoundStreamSettings settings;
+    settings.numOutputChannels = 2;
+    settings.numInputChannels = 0;
+    settings.sampleRate = sampleRate;
+    settings.bufferSize = bufferSize;
+    settings.numBuffers = 2;
+    settings.setOutListener(this);
+    m_open = m_stream.setup(settings);
+    if (!m_open) {
+        ofLogError() << "Could not open an audio stream, sound effects are off" << std::endl;
+    }
+    return m_open;
+}
+
+void SfxMixer::close() {
+    if (!m_open) return;
+    m_stream.close();
+    m_open = false;
+}
+
+// There are no effect files in bin/data, so the effects are made here: short
+// enveloped tones and noise, a few hundred KB in total.
+void SfxMixer::synthesize(int sampleRate) {
+    const float rate = static_cast<float>(sampleRate);
+    // own generator, the simulation's rand() must not be disturbed by audio
+    uint32_t noiseState = 0x1234567u;
+    auto noise = [&noiseState]() {
+        noiseState = noiseState * 1664525u + 1013904223u;
+        return (noiseState >> 8) / static_cast<float>(1 << 24) * 2.0f - 1.0f;
+    };
+    auto make = [&](SfxId id, float seconds, int priority, int maxVoices) -> std::vector<float>& {
+        Sample& sample = m_samples[static_cast<int>(id)];
+        sample.data.assign(static_cast<size_t>(seconds * rate), 0.0f);
+        sample.priority = priority;
+        sample.maxVoices = maxVoices;
+        return sample.data;
+    };
+
+    // player eat: quick rising blip
+    std::vector<float>& eat = make(SfxId::PLAYER_EAT, 0.08f, 2, 3);
+    float phase = 0;
+    for (size_t i = 0; i < eat.size(); ++i) {
+        float t = i / rate;
+        phase += TWO_PI * (600.0f + 7500.0f * t) / rate;
+        eat[i] = 0.5f * sinf(phase) * expf(-t * 30.0f);
+    }
+
+    // FastFish eat: a crunch of noise over a low thump
+    std::vector<float>& crunch = make(SfxId::FASTFISH_EAT, 0.12f, 1, 2);
+    for (size_t i = 0; i < crunch.size(); ++i) {
+        float t = i / rate;
+        crunch[i] = (0.35f * noise() + 0.4f * sinf(TWO_PI * 180.0f * t)) * expf(-t * 25.0f);
+    }
+
+    // lost life: falling square-ish tone
+    std::vector<float>& hurt = make(SfxId::LOST_LIFE, 0.35f, 3, 1);
+    phase = 0;
+    for (size_t i = 0; i < hurt.size(); ++i) {
+        float t = i / rate;
+        phase += TWO_PI * (440.0f - 900.0f * t) / rate;
+        hurt[i] = 0.35f * tanhf(4.0f * sinf(phase)) * (1.0f - t / 0.35f);
+    }
+
+    // new level: C E G C arpeggio
+    std::vector<float>& level = make(SfxId::NEW_LEVEL, 0.6f, 4, 1);
+    const float notes[] = {523.25f, 659.25f, 784.0f, 1046.5f};
+    for (size_t i = 0; i < level.size(); ++i) {
+        float t = i / rate;
+        int note = std::min(3, static_cast<int>(t / 0.15f));
+        float local = t - note * 0.15f;
+        level[i] = 0.4f * sinf(TWO_PI * notes[note] * t) * expf(-local * 8.0f);
+    }
+}
+
+void SfxMixer::trigger(SfxId id, float gain) {
+    if (!m_open) return;
+    uint32_t tail = m_queueTail.load(std::memory_order_relaxed);
+    uint32_t head = m_queueHead.load(std::memory_order_acquire);
+    if (tail - head >= QUEUE_SIZE) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_queue[tail % QUEUE_SIZE] = Trigger{id, gain};
+    m_queueTail.store(tail + 1, std::memory_order_release);
+}
+
+void SfxMixer::startVoice(const Trigger& trigger) {
+    int sampleIndex = static_cast<int>(trigger.id);
+    const Sample& sample = m_samples[sampleIndex];
+    if (sample.data.empty()) return;
+
+    // voice limiting: past its limit a sound restarts its own oldest copy
+    int copies = 0;
+    int oldestCopy = -1;
+    int freeVoice = -1;
+    int weakest = -1;
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        const Voice& v = m_voices[i];
+        if (v.sample < 0) {
+            if (freeVoice < 0) freeVoice = i;
+            continue;
+        }
+        if (v.sample == sampleIndex) {
+            ++copies;
+            if (oldestCopy < 0 || v.started < m_voices[oldestCopy].started) oldestCopy = i;
+        }
+        if (weakest < 0) {
+            weakest = i;
+        } else {
+            int p = m_samples[v.sample].priority;
+            int wp = m_samples[m_voices[weakest].sample].priority;
+            if (p < wp || (p == wp && v.started < m_voices[weakest].started)) weakest = i;
+        }
+    }
+
+    int target = -1;
+    if (copies >= sample.maxVoices) {
+        target = oldestCopy;
+    } else if (freeVoice >= 0) {
+        target = freeVoice;
+    } else if (weakest >= 0 && m_samples[m_voices[weakest].sample].priority <= sample.priority) {
+        target = weakest;
+    }
+    if (target < 0) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Voice& voice = m_voices[target];
+    voice.sample = sampleIndex;
+    voice.position = 0;
+    voice.gain = trigger.gain;
+    voice.started = ++m_voiceCounter;
+}
+
+void SfxMixer::audioOut(ofSoundBuffer& buffer) {
+    uint32_t head = m_queueHead.load(std::memory_order_relaxed);
+    uint32_t tail = m_queueTail.load(std::memory_order_acquire);
+    while (head != tail) {
+        this->startVoice(m_queue[head % QUEUE_SIZE]);
+        ++head;
+    }
+    m_queueHead.store(head, std::memory_order_release);
+
+    size_t frames = buffer.getNumFrames();
+    size_t channels = buffer.getNumChannels();
+    float volume = m_volume.load(std::memory_order_relaxed);
+    buffer.set(0);
+    int active = 0;
+    for (Voice& voice : m_voices) {
+        if (voice.sample < 0) continue;
+        const std::vector<float>& data = m_samples[voice.sample].data;
+        size_t count = std::min(frames, data.size() - voice.position);
+        float gain = voice.gain * volume;
+        for (size_t f = 0; f < count; ++f) {
+            float s = data[voice.position + f] * gain;
+            for (size_t c = 0; c < channels; ++c) {
+                buffer[f * channels + c] += s;
+            }
+        }
+        voice.position += count;
+        if (voice.position >= data.size()) voice.sample = -1;
+        else ++active;
+    }
+    // several loud voices at once: soft clip instead of wrapping around
+    for (size_t i = 0; i < frames * channels; ++i) {
+        buffer[i] = tanhf(buffer[i]);
+    }
+    m_activeVoices.store(active, std::memory_order_relaxed);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include "ofMain.h"
+
+enum class SfxId : uint8_t {
+    PLAYER_EAT,
+    FASTFISH_EAT,
+    LOST_LIFE,
+    NEW_LEVEL,
+    COUNT
+};
+
+// Sound effects mixed into our own output stream from a fixed pool of voices.
+// Samples are made once in setup(), triggers go through a fixed size queue that the
+// audio callback drains, so nothing allocates or locks after setup however many
+// events fire. When the pool is full the new sound takes over the lowest priority
+// (then oldest) voice, or is dropped if everything playing is more important.
+class SfxMixer : public ofBaseSoundOutput {
+public:
+    static constexpr int MAX_VOICES = 8;
+    static constexpr int QUEUE_SIZE = 64;
+
+    ~SfxMixer();
+    // a small buffer keeps the trigger to sound latency at a few milliseconds
+    bool setup(int sampleRate = 44100, int bufferSize = 256);
+    void close();
+    void setVolume(float volume) { m_volume.store(volume, std::memory_order_relaxed); }
+
+    // main thread only (single producer)
+    void trigger(SfxId id, float gain = 1.0f);
+
+    void audioOut(ofSoundBuffer& buffer) override;
+
+    int getActiveVoices() const { return m_activeVoices.load(std::memory_order_relaxed); }
+    uint64_t getDroppedTriggers() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Sample {
+        std::vector<float> data; // mono
+        int priority = 0;        // higher wins when voices run out
+        int maxVoices = 1;       // copies of this sound allowed at once
+    };
+    struct Voice {
+        int sample = -1; // -1 when free
+        size_t position = 0;
+        float gain = 0.0f;
+        uint64_t started = 0;
+    };
+    struct Trigger {
+        SfxId id;
+        float gain;
+    };
+
+    void synthesize(int sampleRate);
+    void startVoice(const Trigger& trigger); // audio thread
+
+    std::array<Sample, static_cast<int>(SfxId::COUNT)> m_samples;
+    std::array<Voice, MAX_VOICES> m_voices; // only touched by the audio thread
+    uint64_t m_voiceCounter = 0;
+
+    std::array<Trigger, QUEUE_SIZE> m_queue;
+    std::atomic<uint32_t> m_queueHead{0}; // next to read, audio thread
+    std::atomic<uint32_t> m_queueTail{0}; // next to write, main thread
+
+    std::atomic<float> m_volume{0.8f};
+    std::atomic<int> m_activeVoices{0};
+    std::atomic<uint64_t> m_dropped{0};
+    ofSoundStream m_stream;
+    bool m_open = false;
+};
@@ -0,0 +1,132 @@
+#include "Snapshot.h"
+#include "Aquarium.h"
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+
+void AquariumSnapshot::Save(const Aquarium& aquarium, const PlayerCreature& player,
+                            const AquariumEffectTimers& effects, std::vector<uint8_t>& out) {
+    SnapshotWriter writer;
+    writer.reserve(64 + aquarium.getCreatureCount() * 64);
+    writer.write(MAGIC);
+    writer.write(VERSION);
+    const size_t seedAt = writer.data().size();
+    writer.write(uint32_t(0)); // filled in below
+    writer.write(effects);
+    player.writeState(writer);
+    aquarium.writeState(writer);
+
+    // FNV-1a of everything after the seed, folded to 32 bits
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = seedAt + sizeof(uint32_t); i < writer.data().size(); i++) {
+        hash ^= writer.data()[i];
+        hash *= 1099511628211ull;
+    }
+    uint32_t seed = static_cast<uint32_t>(hash ^ (hash >> 32));
+    std::memcpy(writer.data().data() + seedAt, &seed, sizeof(seed));
+    out.swap(writer.data());
+}
+
+bool AquariumSnapshot::Load(const std::vector<uint8_t>& in, Aquarium& aquarium, PlayerCreature& player,
+                            AquariumEffectTimers& effects) {
+    SnapshotReader reader(in.data(), in.size());
+    if (reader.read<uint32_t>() != MAGIC) {
+        ofLogError() << "Not an aquarium snapshot" << std::endl;
+        return false;
+    }
+    uint16_t version = reader.read<uint16_t>();
+    if (version != VERSION) {
+        ofLogError() << "Snapshot version " << version << " is not supported (expected " << VERSION << ")" << std::endl;
+        return false;
+    }
+    uint32_t seed = reader.read<uint32_t>();
+    AquariumEffectTimers loadedEffects = reader.read<AquariumEffectTimers>();
+
+    // player and aquarium only commit when everything they read was valid
+    PlayerCreature loadedPlayer = player;
+    loadedPlayer.readState(reader);
+    if (!reader.ok() || !aquarium.readState(reader)) {
+        ofLogError() << "Snapshot is truncated or corrupt" << std::endl;
+        return false;
+    }
+    player = loadedPlayer;
+    effects = loadedEffects;
+    srand(seed);
+    ofSeedRandom(seed);
+    return true;
+}
+
+uint64_t AquariumSnapshot::StateHash(const Aquarium& aquarium, const PlayerCreature& player) {
+    SnapshotWriter writer;
+    writer.reserve(64 + aquarium.getCreatureCount() * 64);
+    player.writeState(writer);
+    aquarium.writeState(writer);
+    uint64_t hash = 14695981039346656037ull;
+    for (uint8_t byte : writer.data()) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool AquariumSnapshot::WriteFile(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(file);
+}
+
+bool AquariumSnapshot::ReadFile(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    data.resize(size);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+
+AquariumSnapshotFileWriter::~AquariumSnapshotFileWriter() {
+    this->stop();
+}
+
+void AquariumSnapshotFileWriter::enqueue(const std::string& path, std::vector<uint8_t> data) {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        m_jobs.push_back(Job{path, std::move(data)});
+    }
+    if (!isThreadRunning()) {
+        startThread();
+    }
+    m_wake.notify_one();
+}
+
+void AquariumSnapshotFileWriter::stop() {
+    if (!isThreadRunning()) return;
+    {
+        // under the lock so the worker can't miss the wakeup between its check and its wait
+        std::lock_guard<std::mutex> guard(mutex);
+        stopThread();
+    }
+    m_wake.notify_one();
+    waitForThread(false); // the thread drains the queue before it exits
+}
+
+void AquariumSnapshotFileWriter::threadedFunction() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> guard(mutex);
+            m_wake.wait(guard, [this] { return !m_jobs.empty() || !isThreadRunning(); });
+            if (m_jobs.empty()) return; // asked to stop and nothing left to write
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        if (AquariumSnapshot::WriteFile(job.path, job.data)) {
+            ofLogNotice() << "Snapshot written to " << job.path << " (" << job.data.size() << " bytes)" << std::endl;
+        } else {
+            ofLogError() << "Failed to write snapshot " << job.path << std::endl;
+        }
+    }
+}
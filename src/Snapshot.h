@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <condition_variable>
+#include "ofMain.h"
+
+class Aquarium;
+class PlayerCreature;
+
+// Flat little byte stream for snapshots. Values are copied as raw bytes in the
+// machine's byte order, snapshots are meant for the same build on the same kind of box.
+class SnapshotWriter {
+public:
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot fields must be plain data");
+        size_t at = m_data.size();
+        m_data.resize(at + sizeof(T));
+        std::memcpy(m_data.data() + at, &value, sizeof(T));
+    }
+    void reserve(size_t bytes) { m_data.reserve(bytes); }
+    std::vector<uint8_t>& data() { return m_data; }
+private:
+    std::vector<uint8_t> m_data;
+};
+
+// Reads back what SnapshotWriter wrote. Running past the end marks the reader as
+// failed and every later read returns zeroes, so callers can check ok() once at the end.
+class SnapshotReader {
+public:
+    SnapshotReader(const uint8_t* data, size_t size) : m_cursor(data), m_end(data + size) {}
+    template <typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot fields must be plain data");
+        T value{};
+        if (!m_ok || static_cast<size_t>(m_end - m_cursor) < sizeof(T)) {
+            m_ok = false;
+            return value;
+        }
+        std::memcpy(&value, m_cursor, sizeof(T));
+        m_cursor += sizeof(T);
+        return value;
+    }
+    void fail() { m_ok = false; }
+    size_t remaining() const { return m_end - m_cursor; }
+    bool ok() const { return m_ok; }
+    const uint8_t* position() const { return m_cursor; } // for formats that mix in their own encoding
+private:
+    const uint8_t* m_cursor;
+    const uint8_t* m_end;
+    bool m_ok = true;
+};
+
+// Effect state that lives in ofApp but still belongs in a snapshot
+struct AquariumEffectTimers {
+    float powerUpCharge = 100.0f;
+    bool powerUpActive = false;
+    int comboCount = 0;
+    float comboTimer = 0.0f;
+    float shakeIntensity = 0.0f;
+    float shakeDuration = 0.0f;
+    float waterOverlayPulse = 0.0f;
+};
+
+class AquariumSnapshot {
+public:
+    static constexpr uint32_t MAGIC = 0x4e535141; // "AQSN"
+    static constexpr uint16_t VERSION = 2; // 2: player hue instead of its color
+
+    // Serializes the whole game into out. rand() and ofRandom() state can't be read
+    // back, so the snapshot stores a seed that Load reseeds both with. The seed is a
+    // hash of the saved state rather than a draw from rand(), so saving leaves the
+    // running game's numbers alone and every load of a snapshot plays out the same.
+    static void Save(const Aquarium& aquarium, const PlayerCreature& player,
+                     const AquariumEffectTimers& effects, std::vector<uint8_t>& out);
+    // Applies a snapshot, leaves everything untouched and returns false if it is
+    // truncated or from another version.
+    static bool Load(const std::vector<uint8_t>& in, Aquarium& aquarium, PlayerCreature& player,
+                     AquariumEffectTimers& effects);
+
+    // FNV-1a over the serialized player and aquarium. Unlike Save this leaves the
+    // random seeds alone, so it can be taken without disturbing a run.
+    static uint64_t StateHash(const Aquarium& aquarium, const PlayerCreature& player);
+
+    static bool WriteFile(const std::string& path, const std::vector<uint8_t>& data);
+    static bool ReadFile(const std::string& path, std::vector<uint8_t>& data);
+};
+
+// Writes snapshots to disk on a background thread so saving never waits on the disk
+class AquariumSnapshotFileWriter : public ofThread {
+public:
+    ~AquariumSnapshotFileWriter();
+    void enqueue(const std::string& path, std::vector<uint8_t> data);
+    void stop();
+protected:
+    void threadedFunction() override;
+private:
+    struct Job {
+        std::string path;
+        std::vector<uint8_t> data;
+    };
+    std::deque<Job> m_jobs;
+    std::condition_variable m_wake;
+};
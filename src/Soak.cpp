@@ -0,0 +1,338 @@
+#include "Soak.h"
+#include "ofApp.h"
+#include "AllocTracker.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+
+// Autopilot
+static const float SIGHT_RADIUS = 900.0f;  // a bit more than a screen away
+static const float DANGER_RADIUS = 160.0f; // flee from what it can't eat inside this
+static const float DEAD_ZONE = 8.0f;       // close enough on an axis to stop pressing it
+
+SoakAutopilot::Keys SoakAutopilot::decide(Aquarium& aquarium, const PlayerCreature& player) {
+    int levels = aquarium.getLevelCount();
+    // levels are circular, past the last one every level has been played
+    m_reckless = levels > 0 && aquarium.getCurrentLevel() >= levels;
+    m_recklessDecisions = m_reckless ? m_recklessDecisions + 1 : 0;
+    if (aquarium.isSpatialGridDirty()) return m_last; // grid ids are stale until the next tick
+
+    float px = player.getX();
+    float py = player.getY();
+    const AquariumFoodWeb& web = aquarium.getFoodWeb();
+    float bestD2 = FLT_MAX;
+    ofVec2f target;
+    ofVec2f away(0, 0);
+    aquarium.getSpatialGrid().forEachInRadius(px, py, SIGHT_RADIUS, [&](int id, float dx, float dy, float d2) {
+        const NPCreature& fish = static_cast<const NPCreature&>(*aquarium.getCreatureAt(id));
+        bool edible = web.playerCanEat(fish.GetType(), player.getPower());
+        if (edible != m_reckless) {
+            if (d2 < bestD2) {
+                bestD2 = d2;
+                target.set(dx, dy);
+            }
+        } else if (!m_reckless && d2 < DANGER_RADIUS * DANGER_RADIUS && d2 > 0.0f) {
+            away -= ofVec2f(dx, dy) / std::sqrt(d2); // closer threats push harder
+        }
+        return true;
+    });
+
+    ofVec2f heading;
+    if (away.lengthSquared() > 0.0f) {
+        heading = away * DANGER_RADIUS;
+    } else if (bestD2 < FLT_MAX) {
+        heading = target;
+    } else {
+        // nothing in sight, swim the corners of the tank until something turns up
+        float margin = 200.0f;
+        float cornerX = (m_waypoint == 1 || m_waypoint == 2) ? aquarium.getWidth() - margin : margin;
+        float cornerY = (m_waypoint >= 2) ? aquarium.getHeight() - margin : margin;
+        heading.set(cornerX - px, cornerY - py);
+        if (heading.lengthSquared() < margin * margin) m_waypoint = (m_waypoint + 1) % 4;
+    }
+
+    Keys keys;
+    keys.dx = (heading.x > DEAD_ZONE) - (heading.x < -DEAD_ZONE);
+    keys.dy = (heading.y > DEAD_ZONE) - (heading.y < -DEAD_ZONE);
+    keys.boost = away.lengthSquared() > 0.0f || (bestD2 < FLT_MAX && bestD2 > 300.0f * 300.0f);
+    m_last = keys;
+    return keys;
+}
+
+
+// Measurements
+int64_t ReadResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return -1;
+    return static_cast<int64_t>(counters.WorkingSetSize);
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) return -1;
+    return static_cast<int64_t>(info.resident_size);
+#else
+    std::ifstream statm("/proc/self/statm");
+    int64_t size = 0;
+    int64_t resident = 0;
+    if (!(statm >> size >> resident)) return -1;
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+bool SoakSeriesGrows(const std::vector<double>& values, double tolerance, double floor, double& growth) {
+    growth = 0;
+    size_t n = values.size();
+    if (n < 3) return false;
+    // least squares line through (i, value)
+    double meanX = (n - 1) / 2.0;
+    double meanY = 0;
+    for (double v : values) meanY += v;
+    meanY /= n;
+    double covXY = 0, varX = 0, varY = 0;
+    for (size_t i = 0; i < n; i++) {
+        double dx = i - meanX;
+        double dy = values[i] - meanY;
+        covXY += dx * dy;
+        varX += dx * dx;
+        varY += dy * dy;
+    }
+    if (varY <= 0) return false; // flat
+    double slope = covXY / varX;
+    double start = meanY - slope * meanX;
+    double rSquared = covXY * covXY / (varX * varY);
+    growth = slope * (n - 1);
+    return rSquared >= 0.6 && growth > floor && growth > tolerance * std::abs(start);
+}
+
+static double percentile(std::vector<int64_t>& values, double p) {
+    if (values.empty()) return 0;
+    size_t rank = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return static_cast<double>(values[rank]);
+}
+
+
+// Runner
+namespace {
+
+// presses and releases keys so the held ones match want, through the normal key path
+void holdKeys(ofApp& app, SoakAutopilot::Keys& held, const SoakAutopilot::Keys& want) {
+    auto axis = [&app](int from, int to, int negativeKey, int positiveKey) {
+        if (from == to) return;
+        if (from < 0) app.keyReleased(negativeKey);
+        if (from > 0) app.keyReleased(positiveKey);
+        if (to < 0) app.keyPressed(negativeKey);
+        if (to > 0) app.keyPressed(positiveKey);
+    };
+    axis(held.dx, want.dx, OF_KEY_LEFT, OF_KEY_RIGHT);
+    axis(held.dy, want.dy, OF_KEY_UP, OF_KEY_DOWN);
+    if (held.boost != want.boost) {
+        if (want.boost) app.keyPressed('p');
+        else app.keyReleased('p');
+    }
+    held = want;
+}
+
+void writeHeader(std::ofstream& csv) {
+    csv << "game_hours,rss_mb,games,level,creatures,staged,retired,pending_predations,particles,ripples,"
+        << "tick_p50_us,tick_p95_us,tick_p99_us,draw_p95_us";
+    if (AllocTracker::ENABLED) {
+        for (int t = 0; t < static_cast<int>(AllocTag::COUNT); t++) {
+            csv << ",live_kb_" << AllocTagToString(static_cast<AllocTag>(t)) << ",allocs_" << AllocTagToString(static_cast<AllocTag>(t));
+        }
+    }
+    csv << "\n";
+}
+
+void writeRow(std::ofstream& csv, const SoakSample& s) {
+    csv << ofToString(s.gameHours, 3) << "," << ofToString(s.residentBytes / (1024.0 * 1024.0), 2) << "," << s.games << "," << s.level
+        << "," << s.creatures << "," << s.stagedCreatures << "," << s.retiredCreatures << "," << s.pendingPredations
+        << "," << s.particles << "," << s.ripples << "," << s.tickP50 << "," << s.tickP95 << "," << s.tickP99 << "," << s.drawP95;
+    for (size_t t = 0; t < s.liveBytes.size(); t++) {
+        csv << "," << ofToString(s.liveBytes[t] / 1024.0, 1) << "," << s.allocsPerFrame[t];
+    }
+    csv << "\n";
+    csv.flush(); // a run that gets killed still leaves its samples
+}
+
+} // namespace
+
+int RunSoak(const SoakSettings& settings) {
+    std::ofstream csv;
+    if (!settings.csvPath.empty()) {
+        ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(settings.csvPath), false, true);
+        csv.open(settings.csvPath, std::ios::trunc);
+        if (!csv) {
+            ofLogError() << "Could not write " << settings.csvPath << std::endl;
+            return 1;
+        }
+        writeHeader(csv);
+    }
+
+    auto app = std::make_shared<ofApp>();
+    app->options.headless = true;
+    app->options.seed = settings.seed;
+    app->setup();
+    // the most particles and effects, and no tier changes to blur the frame times
+    app->quality.setMode(QualityTierToString(QualityTier::HIGH));
+    // creature logging would be most of the run, the soak's own lines stay
+    ofSetLogLevel(OF_LOG_WARNING);
+    ofSetLogLevel("Soak", OF_LOG_NOTICE);
+
+    ofFbo fbo;
+    if (settings.drawEvery > 0) {
+        fbo.allocate(ofGetWidth(), ofGetHeight(), GL_RGB);
+    }
+    const int64_t totalFrames = static_cast<int64_t>(settings.gameHours * 3600.0 * 60.0);
+    const int64_t sampleFrames = std::max<int64_t>(60, static_cast<int64_t>(settings.sampleMinutes * 60.0 * 60.0));
+    const std::string intro = GameSceneKindToString(GameSceneKind::GAME_INTRO);
+    const std::string gameOver = GameSceneKindToString(GameSceneKind::GAME_OVER);
+    const std::string aquariumGame = GameSceneKindToString(GameSceneKind::AQUARIUM_GAME);
+
+    SoakAutopilot pilot;
+    SoakAutopilot::Keys held;
+    std::vector<int64_t> tickMicros;
+    std::vector<int64_t> drawMicros;
+    tickMicros.reserve(sampleFrames);
+    std::vector<SoakSample> samples;
+    int games = 1;
+    uint64_t start = ofGetElapsedTimeMicros();
+
+    for (int64_t frame = 0; frame < totalFrames; frame++) {
+        std::string scene = app->gameManager->GetActiveSceneName();
+        if (scene == intro || scene == gameOver) {
+            holdKeys(*app, held, SoakAutopilot::Keys()); // nothing stays held into the next game
+            if (scene == gameOver) games++;
+            app->keyPressed(OF_KEY_SPACE);
+            app->keyReleased(OF_KEY_SPACE);
+        } else if (scene == aquariumGame && frame % 5 == 0) {
+            // once per aquarium tick is as often as anything it looks at changes
+            auto gameScene = std::static_pointer_cast<AquariumGameScene>(app->gameManager->GetActiveScene());
+            holdKeys(*app, held, pilot.decide(*gameScene->GetAquarium(), *gameScene->GetPlayer()));
+            if (pilot.hasGivenUp() && gameScene->GetLastEvent() == nullptr) {
+                // nothing left that can end this game, so end it as losing the last life would;
+                // the next update() sees the event and goes to the game over screen
+                gameScene->GetPlayer()->setLives(0);
+                gameScene->SetLastEvent(std::make_shared<GameEvent>(GameEventType::GAME_OVER, gameScene->GetPlayer(), nullptr));
+                ofLogNotice("Soak") << "Every level played and nothing can end game " << games << ", ending it" << std::endl;
+            }
+        }
+
+        uint64_t tickStart = ofGetElapsedTimeMicros();
+        app->update();
+        tickMicros.push_back(static_cast<int64_t>(ofGetElapsedTimeMicros() - tickStart));
+
+        if (settings.drawEvery > 0 && frame % settings.drawEvery == 0) {
+            uint64_t drawStart = ofGetElapsedTimeMicros();
+            fbo.begin();
+            ofClear(0, 0, 0, 255);
+            app->draw();
+            fbo.end();
+            drawMicros.push_back(static_cast<int64_t>(ofGetElapsedTimeMicros() - drawStart));
+        }
+
+        if ((frame + 1) % sampleFrames != 0) continue;
+        auto gameScene = std::static_pointer_cast<AquariumGameScene>(app->gameManager->GetScene(aquariumGame));
+        const Aquarium& aquarium = *gameScene->GetAquarium();
+        SoakSample sample;
+        sample.gameHours = (frame + 1) / (60.0 * 3600.0);
+        sample.residentBytes = ReadResidentBytes();
+        if (AllocTracker::ENABLED) {
+            for (int t = 0; t < static_cast<int>(AllocTag::COUNT); t++) {
+                AllocStats stats = AllocTracker::GetStats(static_cast<AllocTag>(t));
+                sample.liveBytes.push_back(stats.liveBytes);
+                sample.allocsPerFrame.push_back(stats.frameAllocs);
+            }
+        }
+        sample.creatures = aquarium.getCreatureCount();
+        sample.stagedCreatures = aquarium.getStagedCreatureCount();
+        sample.retiredCreatures = aquarium.getRetiredCreatureCount();
+        sample.pendingPredations = aquarium.getPendingPredationCount();
+        sample.particles = app->particles.size();
+        sample.ripples = app->ripples.size();
+        sample.tickP50 = percentile(tickMicros, 0.50);
+        sample.tickP95 = percentile(tickMicros, 0.95);
+        sample.tickP99 = percentile(tickMicros, 0.99);
+        sample.drawP95 = percentile(drawMicros, 0.95);
+        sample.games = games;
+        sample.level = aquarium.getCurrentLevel();
+        tickMicros.clear();
+        drawMicros.clear();
+        samples.push_back(sample);
+        if (csv.is_open()) writeRow(csv, sample);
+
+        double seconds = (ofGetElapsedTimeMicros() - start) * 1e-6;
+        ofLogNotice("Soak") << ofToString(sample.gameHours, 2) << " h played in " << ofToString(seconds / 60.0, 1) << " min ("
+                            << ofToString(sample.gameHours * 3600.0 / std::max(seconds, 1e-6), 0) << "x), game " << games
+                            << " level " << sample.level << ", rss " << ofToString(sample.residentBytes / (1024.0 * 1024.0), 1)
+                            << " MB, tick p95 " << sample.tickP95 << " us" << (pilot.isReckless() ? ", all levels done" : "") << std::endl;
+    }
+    app->exit();
+
+    // the first quarter fills caches, pools and fonts, growth only counts after it
+    size_t warmup = samples.size() / 4;
+    if (samples.size() - warmup < 4) {
+        ofLogWarning("Soak") << "Only " << samples.size() << " samples, too short to judge growth" << std::endl;
+        ofSetLogLevel(OF_LOG_NOTICE);
+        return 0;
+    }
+    int flagged = 0;
+    int warned = 0;
+    auto check = [&](const std::string& name, double tolerance, double floor, auto value, bool warnOnly = false) {
+        std::vector<double> series;
+        for (size_t i = warmup; i < samples.size(); i++) series.push_back(static_cast<double>(value(samples[i])));
+        double growth = 0;
+        if (!SoakSeriesGrows(series, tolerance, floor, growth)) return;
+        std::string message = name + " keeps growing: +" + ofToString(growth, 1) + " over "
+                            + ofToString(samples.back().gameHours - samples[warmup].gameHours, 1) + " h of play";
+        if (warnOnly) {
+            ofLogWarning("Soak") << message << std::endl;
+            warned++;
+        } else {
+            ofLogError("Soak") << message << std::endl;
+            flagged++;
+        }
+    };
+    if (samples.back().residentBytes >= 0) {
+        check("resident memory (MB)", 0.10, 8.0, [](const SoakSample& s) { return s.residentBytes / (1024.0 * 1024.0); });
+    }
+    for (size_t t = 0; t < samples.back().liveBytes.size(); t++) {
+        check(std::string("live KB in ") + AllocTagToString(static_cast<AllocTag>(t)), 0.10, 1024.0,
+              [t](const SoakSample& s) { return s.liveBytes[t] / 1024.0; });
+        check(std::string("allocations per frame in ") + AllocTagToString(static_cast<AllocTag>(t)), 0.25, 16.0,
+              [t](const SoakSample& s) { return s.allocsPerFrame[t]; });
+    }
+    check("creatures", 0.25, 64.0, [](const SoakSample& s) { return s.creatures; });
+    check("retired creatures", 0.25, 32.0, [](const SoakSample& s) { return s.retiredCreatures; });
+    check("pending predation positions", 0.25, 32.0, [](const SoakSample& s) { return s.pendingPredations; });
+    check("particles", 0.25, 64.0, [](const SoakSample& s) { return s.particles; });
+    check("ripples", 0.25, 8.0, [](const SoakSample& s) { return s.ripples; });
+    // timings on a shared box wander with the rest of the machine, so these only warn, and
+    // only about a drift big enough to be the game's own
+    check("tick p50 (us)", 0.50, 200.0, [](const SoakSample& s) { return s.tickP50; }, true);
+    check("tick p95 (us)", 0.50, 200.0, [](const SoakSample& s) { return s.tickP95; }, true);
+    check("draw p95 (us)", 0.50, 1000.0, [](const SoakSample& s) { return s.drawP95; }, true);
+
+    if (warned > 0) {
+        ofLogWarning("Soak") << warned << " timing series drifted, worth a look on a quiet machine" << std::endl;
+    }
+    if (flagged > 0) {
+        ofLogError("Soak") << flagged << " series kept growing over " << games << " games, see " << settings.csvPath << std::endl;
+    } else {
+        ofLogNotice("Soak") << "No growth or drift over " << ofToString(samples.back().gameHours, 1) << " h and " << games << " games" << std::endl;
+    }
+    ofSetLogLevel(OF_LOG_NOTICE);
+    return flagged > 0 ? 1 : 0;
+}
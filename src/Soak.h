@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class Aquarium;
+class PlayerCreature;
+
+// Plays the game by itself for the soak test. Every tick it steers the player at the
+// closest fish the level's food web lets it eat and away from anything close that
+// would hurt it, boosting when the meal is far. Once every level has been played
+// through it goes for the fish it can't eat, so the game ends and starts over. When
+// its power has outgrown every fish and nothing can hurt it anymore, it gives up
+// after a while and RunSoak ends the game the way dying would.
+class SoakAutopilot {
+public:
+    struct Keys {
+        int dx = 0; // -1, 0, 1
+        int dy = 0;
+        bool boost = false;
+    };
+    Keys decide(Aquarium& aquarium, const PlayerCreature& player);
+    bool isReckless() const { return m_reckless; }
+    bool hasGivenUp() const { return m_recklessDecisions >= GIVE_UP_DECISIONS; }
+
+    static constexpr int GIVE_UP_DECISIONS = 12 * 60 * 2; // two minutes of aquarium ticks
+
+private:
+    Keys m_last;
+    bool m_reckless = false;
+    int m_recklessDecisions = 0; // decisions since every level was played
+    int m_waypoint = 0; // corner to swim to when nothing is in sight
+};
+
+// One row of the soak report, taken every sample interval of game time
+struct SoakSample {
+    double gameHours = 0;
+    int64_t residentBytes = 0;      // -1 when the platform can't tell
+    std::vector<int64_t> liveBytes; // per AllocTag, empty without AQUARIUM_ALLOC_TRACKING
+    std::vector<int64_t> allocsPerFrame;
+    int creatures = 0;
+    int stagedCreatures = 0;
+    int retiredCreatures = 0;
+    int pendingPredations = 0;
+    int particles = 0;
+    int ripples = 0;
+    double tickP50 = 0;             // microseconds of ofApp::update() over the interval
+    double tickP95 = 0;
+    double tickP99 = 0;
+    double drawP95 = 0;             // microseconds of ofApp::draw() for the frames that drew
+    int games = 0;
+    int level = 0;
+};
+
+// --soak[=<game hours>]: runs a fresh headless ofApp as fast as it goes with the
+// autopilot playing, samples memory, container sizes and frame times every
+// sampleMinutes of game time into a CSV, and at the end flags every series that
+// kept growing. Returns nonzero when something did; frame and draw times only warn,
+// they move with whatever else the machine is doing.
+struct SoakSettings {
+    double gameHours = 168.0;      // a week
+    double sampleMinutes = 10.0;
+    int drawEvery = 60;            // frames, 0 never draws
+    std::string csvPath;
+    uint32_t seed = 1;             // same seed, same games
+};
+
+int RunSoak(const SoakSettings& settings);
+
+// Resident memory of this process in bytes, -1 when unknown
+int64_t ReadResidentBytes();
+
+// True when values grew steadily: a straight line fits them well (r squared of at
+// least 0.6) and climbs by more than tolerance of where it started and more than
+// floor overall. Slow drift shows up here, one off spikes and noise do not.
+bool SoakSeriesGrows(const std::vector<double>& values, double tolerance, double floor, double& growth);
@@ -0,0 +1,38 @@
+#include "SpatialGrid.h"
+
+
+void SpatialGrid::clear(float width, float height) {
+    m_cols = std::max(1, static_cast<int>(std::ceil(width / m_cellSize)));
+    m_rows = std::max(1, static_cast<int>(std::ceil(height / m_cellSize)));
+    m_entries.clear();
+}
+
+void SpatialGrid::insert(int id, float x, float y) {
+    int cell = cellCoord(y, m_rows) * m_cols + cellCoord(x, m_cols);
+    m_entries.push_back(Entry{id, x, y, cell});
+}
+
+void SpatialGrid::finalize() {
+    int cellCount = m_cols * m_rows;
+    m_cellStart.assign(cellCount + 1, 0);
+
+    // counting sort: histogram, prefix sum, scatter
+    for (const Entry& e : m_entries) {
+        ++m_cellStart[e.cell + 1];
+    }
+    for (int c = 0; c < cellCount; ++c) {
+        m_cellStart[c + 1] += m_cellStart[c];
+    }
+
+    // after the prefix sum m_cellStart[c + 1] is the end of bucket c; scattering backwards
+    // walks each one down to its start, which keeps insertion order inside a cell
+    m_sorted.resize(m_entries.size());
+    for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+        m_sorted[--m_cellStart[it->cell + 1]] = *it;
+    }
+    // shift so that bucket c spans [m_cellStart[c], m_cellStart[c + 1])
+    for (int c = 0; c < cellCount; ++c) {
+        m_cellStart[c] = m_cellStart[c + 1];
+    }
+    m_cellStart[cellCount] = static_cast<int>(m_sorted.size());
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Uniform grid used to answer "who is near me" without walking every creature.
+// Entries are bucketed with a counting sort on every build, so after the first few
+// ticks the grid does not allocate anymore (vectors only grow, never shrink).
+class SpatialGrid {
+public:
+    explicit SpatialGrid(float cellSize = 64.0f) : m_cellSize(cellSize) {}
+
+    void setCellSize(float cellSize) { m_cellSize = std::max(1.0f, cellSize); }
+    float getCellSize() const { return m_cellSize; }
+
+    // start a new build covering [0,width) x [0,height)
+    void clear(float width, float height);
+    // id is whatever the caller uses to find the object again (usually an index)
+    void insert(int id, float x, float y);
+    // bucket everything inserted since clear(), must be called before querying
+    void finalize();
+
+    int size() const { return static_cast<int>(m_sorted.size()); }
+
+    // Visits every entry within radius of (x, y). The callback receives
+    // (id, dx, dy, distSq) with dx/dy measured from the query point to the entry
+    // and returns false to stop the search early (used to bound neighbor counts).
+    template <typename Fn>
+    void forEachInRadius(float x, float y, float radius, Fn&& fn) const {
+        if (m_sorted.empty()) return;
+        float radiusSq = radius * radius;
+        int minCx = cellCoord(x - radius, m_cols);
+        int maxCx = cellCoord(x + radius, m_cols);
+        int minCy = cellCoord(y - radius, m_rows);
+        int maxCy = cellCoord(y + radius, m_rows);
+        for (int cy = minCy; cy <= maxCy; ++cy) {
+            for (int cx = minCx; cx <= maxCx; ++cx) {
+                int cell = cy * m_cols + cx;
+                for (int i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+                    const Entry& e = m_sorted[i];
+                    float dx = e.x - x;
+                    float dy = e.y - y;
+                    float d2 = dx * dx + dy * dy;
+                    if (d2 > radiusSq) continue;
+                    if (!fn(e.id, dx, dy, d2)) return;
+                }
+            }
+        }
+    }
+
+    // Visits every entry whose position lies inside [minX,maxX] x [minY,maxY], cell
+    // by cell (so not in insertion order). fn(id) returns false to stop early.
+    template <typename Fn>
+    void forEachInRect(float minX, float minY, float maxX, float maxY, Fn&& fn) const {
+        if (m_sorted.empty()) return;
+        int minCx = cellCoord(minX, m_cols);
+        int maxCx = cellCoord(maxX, m_cols);
+        int minCy = cellCoord(minY, m_rows);
+        int maxCy = cellCoord(maxY, m_rows);
+        for (int cy = minCy; cy <= maxCy; ++cy) {
+            for (int cx = minCx; cx <= maxCx; ++cx) {
+                int cell = cy * m_cols + cx;
+                for (int i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+                    const Entry& e = m_sorted[i];
+                    if (e.x < minX || e.x > maxX || e.y < minY || e.y > maxY) continue;
+                    if (!fn(e.id)) return;
+                }
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        int id;
+        float x;
+        float y;
+        int cell;
+    };
+
+    int cellCoord(float v, int count) const {
+        int c = static_cast<int>(std::floor(v / m_cellSize));
+        return std::min(std::max(c, 0), count - 1);
+    }
+
+    float m_cellSize;
+    int m_cols = 1;
+    int m_rows = 1;
+    std::vector<Entry> m_entries;   // unsorted, in insertion order
+    std::vector<Entry> m_sorted;    // grouped by cell
+    std::vector<int> m_cellStart;   // m_cols * m_rows + 1 offsets into m_sorted
+};
@@ -0,0 +1,135 @@
+#include "SpriteBatch.h"
+#include "Core.h"
+
+// GLSL 1.20 to match the default (non programmable) renderer main.cpp creates.
+// Per sprite values come in through the fixed vertex attributes: the tint as the
+// vertex color and flash / hue in the first two components of the normal.
+static const char* SPRITE_VERTEX_SHADER = R"(
+#version 120
+varying vec2 texCoord;
+varying vec4 tint;
+varying vec2 effects;
+void main() {
+    texCoord = gl_MultiTexCoord0.xy;
+    tint = gl_Color;
+    effects = gl_Normal.xy;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+}
+)";
+
+static const char* SPRITE_FRAGMENT_SHADER = R"(
+#version 120
+uniform sampler2D tex0;
+uniform vec4 water;
+varying vec2 texCoord;
+varying vec4 tint;
+varying vec2 effects;
+// fully saturated, full brightness color for hue h in 0..1
+vec3 hueColor(float h) {
+    return clamp(abs(mod(h * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
+}
+void main() {
+    vec4 texel = texture2D(tex0, texCoord);
+    vec4 color = texel * tint;
+    if (effects.y >= 0.0) {
+        color.rgb *= hueColor(effects.y);
+    }
+    color.rgb = mix(color.rgb, texel.rgb * vec3(1.0, 0.0, 0.0), effects.x);
+    color.rgb = mix(color.rgb, water.rgb, water.a);
+    gl_FragColor = color;
+}
+)";
+
+
+SpriteBatch& SpriteBatch::Get() {
+    static SpriteBatch batch;
+    return batch;
+}
+
+void SpriteBatch::setupShader() {
+    m_shaderTried = true;
+    m_mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+    m_shaderReady = m_shader.setupShaderFromSource(GL_VERTEX_SHADER, SPRITE_VERTEX_SHADER)
+                 && m_shader.setupShaderFromSource(GL_FRAGMENT_SHADER, SPRITE_FRAGMENT_SHADER)
+                 && m_shader.linkProgram();
+    if (!m_shaderReady) {
+        ofLogError() << "Sprite shader failed to build, sprites are drawn without flash and hue effects" << std::endl;
+    }
+}
+
+void SpriteBatch::begin() {
+    if (!m_shaderTried) this->setupShader();
+    m_active = true;
+    m_drawCalls = 0;
+}
+
+void SpriteBatch::add(const GameSprite& sprite, float x, float y, const SpriteInstance& instance) {
+    if (!m_active) {
+        this->begin();
+        this->add(sprite, x, y, instance);
+        this->end();
+        return;
+    }
+    const ofTexture& texture = sprite.getTexture();
+    if (!texture.isAllocated()) return;
+    if (m_texture != &texture) {
+        this->flush();
+        m_texture = &texture;
+    }
+
+    float w = sprite.getWidth();
+    float h = sprite.getHeight();
+    ofFloatColor tint(instance.tint.r * m_tint.r, instance.tint.g * m_tint.g,
+                      instance.tint.b * m_tint.b, instance.tint.a * m_tint.a);
+
+    if (!m_shaderReady) {
+        // no shader: plain tinted draw, a negative width mirrors the quad
+        ofSetColor(instance.flash > 0.5f ? ofFloatColor(1.0f, 0.0f, 0.0f, tint.a) : tint);
+        if (instance.flipped) texture.draw(x + w, y, -w, h);
+        else texture.draw(x, y, w, h);
+        ofSetColor(ofColor::white);
+        return;
+    }
+
+    // textures are normalized (ofDisableArbTex in ofApp::setup), flipping swaps u
+    float u0 = instance.flipped ? 1.0f : 0.0f;
+    float u1 = 1.0f - u0;
+    glm::vec3 effects(instance.flash, instance.hue, 0.0f);
+    unsigned base = m_mesh.getNumVertices();
+    m_mesh.addVertex(glm::vec3(x, y, 0));
+    m_mesh.addVertex(glm::vec3(x + w, y, 0));
+    m_mesh.addVertex(glm::vec3(x + w, y + h, 0));
+    m_mesh.addVertex(glm::vec3(x, y + h, 0));
+    m_mesh.addTexCoord(glm::vec2(u0, 0));
+    m_mesh.addTexCoord(glm::vec2(u1, 0));
+    m_mesh.addTexCoord(glm::vec2(u1, 1));
+    m_mesh.addTexCoord(glm::vec2(u0, 1));
+    for (int i = 0; i < 4; ++i) {
+        m_mesh.addColor(tint);
+        m_mesh.addNormal(effects);
+    }
+    m_mesh.addIndex(base);
+    m_mesh.addIndex(base + 1);
+    m_mesh.addIndex(base + 2);
+    m_mesh.addIndex(base);
+    m_mesh.addIndex(base + 2);
+    m_mesh.addIndex(base + 3);
+}
+
+void SpriteBatch::flush() {
+    if (m_mesh.getNumVertices() == 0 || m_texture == nullptr) return;
+    m_shader.begin();
+    m_shader.setUniformTexture("tex0", *m_texture, 0);
+    m_shader.setUniform4f("water", m_water.r, m_water.g, m_water.b, m_water.a);
+    m_mesh.draw();
+    m_shader.end();
+    m_mesh.clear(); // keeps the capacity, so steady frames don't allocate
+    ++m_drawCalls;
+}
+
+void SpriteBatch::end() {
+    this->flush();
+    m_texture = nullptr;
+    m_active = false;
+    m_lastDrawCalls = m_drawCalls;
+}
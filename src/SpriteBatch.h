@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+
+class GameSprite;
+
+// Everything that can differ between two draws of the same sprite. It travels with
+// the vertices, so sprites sharing a texture still go out in one draw call.
+struct SpriteInstance {
+    bool flipped = false;
+    ofFloatColor tint = ofFloatColor(1.0f, 1.0f, 1.0f, 1.0f);
+    float flash = 0.0f; // 0..1, how far towards the red damage flash
+    float hue = -1.0f;  // 0..1 rainbow hue multiplied in, negative turns it off
+};
+
+// Collects sprite quads and draws them through one shader. Consecutive sprites with
+// the same texture share a draw call, so keeping creatures of a type together in
+// draw order keeps the call count at about one per sprite type.
+class SpriteBatch {
+public:
+    static SpriteBatch& Get();
+
+    void begin();
+    // outside begin()/end() the sprite is drawn right away
+    void add(const GameSprite& sprite, float x, float y, const SpriteInstance& instance);
+    void end();
+
+    // multiplied into every instance's tint, Aquarium uses it for the level fade
+    void setTint(const ofFloatColor& tint) { m_tint = tint; }
+    // color blended over every sprite by its alpha, the water tint pulse
+    void setWaterTint(const ofFloatColor& water) { m_water = water; }
+    // draw calls issued by the last end(), for the profiler overlay
+    int getLastDrawCalls() const { return m_lastDrawCalls; }
+
+private:
+    SpriteBatch() = default;
+    void flush();
+    void setupShader();
+
+    ofShader m_shader;
+    bool m_shaderReady = false;
+    bool m_shaderTried = false;
+    ofMesh m_mesh;
+    const ofTexture* m_texture = nullptr;
+    bool m_active = false;
+    ofFloatColor m_tint = ofFloatColor(1.0f, 1.0f, 1.0f, 1.0f);
+    ofFloatColor m_water = ofFloatColor(0.0f, 0.0f, 0.0f, 0.0f);
+    int m_drawCalls = 0;
+    int m_lastDrawCalls = 0;
+};
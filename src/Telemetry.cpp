@@ -0,0 +1,262 @@
+#include "Telemetry.h"
+#include "Snapshot.h"
+#include <cmath>
+#include <fstream>
+
+std::string TelemetryLayer::Name(int layer) {
+    if (layer == PLAYER) return "player";
+    if (layer == EATEN_BY_PLAYER) return "eaten_by_player";
+    if (layer >= CREATURES && layer < EATEN_BY_PLAYER) {
+        return AquariumCreatureTypeToString(static_cast<AquariumCreatureType>(layer - CREATURES));
+    }
+    if (layer >= EATEN_BY && layer < COUNT) {
+        return "eaten_by_" + AquariumCreatureTypeToString(static_cast<AquariumCreatureType>(layer - EATEN_BY));
+    }
+    return "layer" + ofToString(layer);
+}
+
+
+SpatialTelemetry::~SpatialTelemetry() {
+    this->stop();
+}
+
+void SpatialTelemetry::setup(int worldWidth, int worldHeight) {
+    m_worldWidth = static_cast<float>(std::max(1, worldWidth));
+    m_worldHeight = static_cast<float>(std::max(1, worldHeight));
+    // square-ish cells whatever the tank's shape
+    m_rows = std::max(1, static_cast<int>(std::lround(COLUMNS * m_worldHeight / m_worldWidth)));
+    m_cellsPerLayer = COLUMNS * m_rows;
+    m_cellsPerUnitX = COLUMNS / m_worldWidth;
+    m_cellsPerUnitY = m_rows / m_worldHeight;
+    m_counts.assign(static_cast<size_t>(m_cellsPerLayer) * TelemetryLayer::COUNT, 0);
+    m_tick = 0;
+    m_recordStartTick = 0;
+}
+
+bool SpatialTelemetry::start(const std::string& path, float flushSeconds) {
+    if (!this->isSetup()) return false;
+    ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(path), false, true);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        ofLogError() << "Could not open telemetry file " << path << std::endl;
+        return false;
+    }
+    SnapshotWriter header;
+    header.write(MAGIC);
+    header.write(VERSION);
+    header.write(static_cast<uint16_t>(COLUMNS));
+    header.write(static_cast<uint16_t>(m_rows));
+    header.write(static_cast<uint8_t>(TelemetryLayer::COUNT));
+    header.write(m_worldWidth);
+    header.write(m_worldHeight);
+    file.write(reinterpret_cast<const char*>(header.data().data()), header.data().size());
+
+    m_path = path;
+    m_flushSeconds = std::max(1.0f, flushSeconds);
+    m_lastFlush = ofGetElapsedTimef();
+    startThread();
+    ofLogNotice() << "Spatial telemetry (" << COLUMNS << "x" << m_rows << " cells) goes to " << path
+                  << " every " << m_flushSeconds << " s" << std::endl;
+    return static_cast<bool>(file);
+}
+
+void SpatialTelemetry::stop() {
+    if (!isThreadRunning()) return;
+    this->flush(); // the last partial window
+    {
+        // under the lock so the worker can't miss the wakeup between its check and its wait
+        std::lock_guard<std::mutex> guard(mutex);
+        stopThread();
+    }
+    m_wake.notify_one();
+    waitForThread(false); // the thread drains the queue before it exits
+}
+
+void SpatialTelemetry::endTick() {
+    m_tick++;
+    if (m_path.empty()) return;
+    float now = ofGetElapsedTimef();
+    if (now - m_lastFlush >= m_flushSeconds) {
+        m_lastFlush = now;
+        this->flush();
+    }
+}
+
+void SpatialTelemetry::flush() {
+    if (m_tick == m_recordStartTick) return; // nothing counted
+    Record record;
+    record.firstTick = m_recordStartTick;
+    record.ticks = m_tick - m_recordStartTick;
+    // the thread gets these counts, the next window starts from zero in a fresh buffer
+    record.counts.assign(m_counts.size(), 0);
+    record.counts.swap(m_counts);
+    m_recordStartTick = m_tick;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        m_records.push_back(std::move(record));
+    }
+    m_wake.notify_one();
+}
+
+void SpatialTelemetry::threadedFunction() {
+    while (true) {
+        Record record;
+        {
+            std::unique_lock<std::mutex> guard(mutex);
+            m_wake.wait(guard, [this] { return !m_records.empty() || !isThreadRunning(); });
+            if (m_records.empty()) return; // asked to stop and nothing left to write
+            record = std::move(m_records.front());
+            m_records.pop_front();
+        }
+        if (!this->writeRecord(record)) {
+            ofLogError() << "Failed to append telemetry to " << m_path << std::endl;
+        }
+    }
+}
+
+bool SpatialTelemetry::writeRecord(const Record& record) {
+    m_encoded.clear();
+    SnapshotWriter head;
+    head.write(record.firstTick);
+    head.write(record.ticks);
+    m_encoded.insert(m_encoded.end(), head.data().begin(), head.data().end());
+    for (int layer = 0; layer < TelemetryLayer::COUNT; layer++) {
+        EncodeLayer(record.counts.data() + layer * m_cellsPerLayer, m_cellsPerLayer, m_encoded);
+    }
+    std::ofstream file(m_path, std::ios::binary | std::ios::app);
+    file.write(reinterpret_cast<const char*>(m_encoded.data()), m_encoded.size());
+    return static_cast<bool>(file);
+}
+
+static void writeVarint(uint32_t value, std::vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool readVarint(const uint8_t*& cursor, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && cursor < end; shift += 7) {
+        uint8_t byte = *cursor++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+void SpatialTelemetry::EncodeLayer(const uint32_t* cells, int count, std::vector<uint8_t>& out) {
+    int at = 0;
+    while (true) {
+        int run = 0;
+        while (at + run < count && cells[at + run] == 0) run++;
+        writeVarint(run, out);
+        at += run;
+        if (at == count) break;
+        writeVarint(cells[at++], out);
+        if (at == count) break;
+    }
+}
+
+bool SpatialTelemetry::DecodeLayer(const uint8_t*& cursor, const uint8_t* end, uint32_t* cells, int count) {
+    int at = 0;
+    while (true) {
+        uint32_t run = 0;
+        if (!readVarint(cursor, end, run) || run > static_cast<uint32_t>(count - at)) return false;
+        at += run;
+        if (at == count) return true;
+        uint32_t value = 0;
+        if (!readVarint(cursor, end, value)) return false;
+        cells[at++] += value; // summed over the records
+        if (at == count) return true;
+    }
+}
+
+
+// Heatmaps
+static ofColor heatColor(float t) {
+    // dark blue, blue, cyan, yellow, white
+    static const ofColor stops[] = {ofColor(8, 8, 32), ofColor(20, 40, 160), ofColor(0, 190, 255), ofColor(255, 220, 0), ofColor(255, 255, 255)};
+    const int last = sizeof(stops) / sizeof(stops[0]) - 1;
+    float scaled = ofClamp(t, 0.0f, 1.0f) * last;
+    int i = std::min(static_cast<int>(scaled), last - 1);
+    return stops[i].getLerped(stops[i + 1], scaled - i);
+}
+
+static const size_t MAX_HEATMAP_CELLS = 1 << 22; // 16 MB of sums, the game writes a few thousand per layer
+
+int RenderTelemetryHeatmaps(const std::string& path, const std::string& outDir) {
+    ofBuffer buffer = ofBufferFromFile(path, true);
+    const uint8_t* cursor = reinterpret_cast<const uint8_t*>(buffer.getData());
+    const uint8_t* end = cursor + buffer.size();
+    SnapshotReader header(cursor, buffer.size());
+    uint32_t magic = header.read<uint32_t>();
+    uint8_t version = header.read<uint8_t>();
+    int columns = header.read<uint16_t>();
+    int rows = header.read<uint16_t>();
+    int layers = header.read<uint8_t>();
+    header.read<float>();
+    header.read<float>();
+    if (!header.ok() || magic != SpatialTelemetry::MAGIC || version != SpatialTelemetry::VERSION || columns == 0 || rows == 0) {
+        ofLogError() << path << " is not a telemetry file" << std::endl;
+        return -1;
+    }
+    cursor = header.position();
+
+    // the header is read straight from disk, a damaged one must not size the sums
+    size_t totalCells = static_cast<size_t>(columns) * rows * layers;
+    if (layers == 0 || totalCells > MAX_HEATMAP_CELLS) {
+        ofLogError() << path << ": " << columns << "x" << rows << " cells in " << layers << " layers is not a sane grid" << std::endl;
+        return -1;
+    }
+    int cells = columns * rows; // fits, it is at most MAX_HEATMAP_CELLS
+    std::vector<uint32_t> sums(totalCells, 0);
+    uint64_t ticks = 0;
+    int records = 0;
+    while (cursor + 8 <= end) {
+        SnapshotReader head(cursor, end - cursor);
+        head.read<uint32_t>(); // first tick
+        ticks += head.read<uint32_t>();
+        cursor = head.position();
+        bool ok = true;
+        for (int layer = 0; layer < layers && ok; layer++) {
+            ok = SpatialTelemetry::DecodeLayer(cursor, end, sums.data() + layer * cells, cells);
+        }
+        if (!ok) {
+            // the game may have been killed halfway through an append
+            ofLogWarning() << path << ": record " << records << " is cut off, using the ones before it" << std::endl;
+            break;
+        }
+        records++;
+    }
+
+    ofDirectory::createDirectory(outDir, false, true);
+    const int scale = 8; // pixels per cell
+    std::string name = ofFilePath::getBaseName(path);
+    int written = 0;
+    for (int layer = 0; layer < layers; layer++) {
+        const uint32_t* counts = sums.data() + layer * cells;
+        uint32_t peak = *std::max_element(counts, counts + cells);
+        if (peak == 0) continue;
+        // log scale, otherwise a single busy cell makes the rest of the tank black
+        float norm = 1.0f / std::log1p(static_cast<float>(peak));
+        ofPixels pixels;
+        pixels.allocate(columns * scale, rows * scale, OF_IMAGE_COLOR);
+        for (int y = 0; y < rows * scale; y++) {
+            for (int x = 0; x < columns * scale; x++) {
+                uint32_t count = counts[(y / scale) * columns + x / scale];
+                pixels.setColor(x, y, heatColor(std::log1p(static_cast<float>(count)) * norm));
+            }
+        }
+        std::string out = ofFilePath::join(outDir, name + "_" + TelemetryLayer::Name(layer) + ".png");
+        if (ofSaveImage(pixels, out)) {
+            written++;
+        } else {
+            ofLogError() << "Could not write " << out << std::endl;
+        }
+    }
+    ofLogNotice() << path << ": " << records << " records, " << ticks << " ticks, " << written
+                  << " heatmaps written to " << outDir << std::endl;
+    return written;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+#include "ofMain.h"
+#include "Aquarium.h"
+
+// Where things happen in the tank, for level design and load analysis. The tank is
+// cut into a fixed grid (COLUMNS wide, rows follow the tank's aspect) and every
+// aquarium tick adds one to the cell of the player and of every creature that got
+// eaten (one layer per predator, the player included). Creatures (one layer per type)
+// are sampled: each tick counts every CREATURE_STRIDE-th one, a different slice each
+// tick, with a weight of CREATURE_STRIDE. Over a few ticks that is the same density,
+// and at 10k creatures the counting stays well under 1% of the tick, where counting
+// all of them took 1-2% (the increments land all over the grid and miss the cache).
+//
+// Every flush_seconds the counts so far are handed to a background thread, which
+// appends them to the telemetry file as one record and the counting starts over.
+// RenderTelemetryHeatmaps (--heatmap=<file>) sums the records into one PNG per layer.
+//
+// File layout, raw bytes in the machine's order like the snapshots:
+//   header  "AQHM" u32, version u8, columns u16, rows u16, layers u8, world width f32, height f32
+//   record  first tick u32, ticks u32, then per layer the cells row by row as varints:
+//           (zero run, count) pairs, a layer ends where its last cell is reached
+// Most cells of a layer are empty, so a record is a few KB instead of 120.
+namespace TelemetryLayer {
+const int PLAYER = 0;
+const int CREATURES = 1;                                        // + AquariumCreatureType
+const int EATEN_BY_PLAYER = CREATURES + AQUARIUM_CREATURE_TYPE_COUNT;
+const int EATEN_BY = EATEN_BY_PLAYER + 1;                       // + the predator's AquariumCreatureType
+const int COUNT = EATEN_BY + AQUARIUM_CREATURE_TYPE_COUNT;
+
+inline int Creature(AquariumCreatureType type) { return CREATURES + static_cast<int>(type); }
+inline int EatenBy(AquariumCreatureType predator) { return EATEN_BY + static_cast<int>(predator); }
+std::string Name(int layer);
+}
+
+class SpatialTelemetry : public ofThread {
+public:
+    static constexpr uint32_t MAGIC = 0x4d485141; // "AQHM"
+    static constexpr uint8_t VERSION = 1;
+    static constexpr int COLUMNS = 64;
+    static constexpr int CREATURE_STRIDE = 8;
+
+    ~SpatialTelemetry();
+    // sizes the grid for the tank, counting works from here on even without a file
+    void setup(int worldWidth, int worldHeight);
+    // appends a record to path every flushSeconds, false when the file can't be written
+    bool start(const std::string& path, float flushSeconds);
+    // writes what has been counted since the last flush and waits for the thread
+    void stop();
+    bool isSetup() const { return !m_counts.empty(); }
+
+    void add(int layer, float x, float y, uint32_t weight = 1) {
+        int cx = static_cast<int>(x * m_cellsPerUnitX);
+        int cy = static_cast<int>(y * m_cellsPerUnitY);
+        cx = cx < 0 ? 0 : (cx >= COLUMNS ? COLUMNS - 1 : cx);
+        cy = cy < 0 ? 0 : (cy >= m_rows ? m_rows - 1 : cy);
+        m_counts[layer * m_cellsPerLayer + cy * COLUMNS + cx] += weight;
+    }
+    // index of the first creature to sample this tick, the next ones follow every CREATURE_STRIDE
+    int getCreatureOffset() const { return m_tick % CREATURE_STRIDE; }
+    // called after every aquarium tick, flushes when it is time
+    void endTick();
+
+    int getRows() const { return m_rows; }
+    uint32_t getTicks() const { return m_tick; }
+    const std::vector<uint32_t>& getCounts() const { return m_counts; } // since the last flush
+
+    // the encoding used in records, exposed for the heatmap tool
+    static void EncodeLayer(const uint32_t* cells, int count, std::vector<uint8_t>& out);
+    static bool DecodeLayer(const uint8_t*& cursor, const uint8_t* end, uint32_t* cells, int count);
+
+protected:
+    void threadedFunction() override;
+
+private:
+    struct Record {
+        uint32_t firstTick = 0;
+        uint32_t ticks = 0;
+        std::vector<uint32_t> counts;
+    };
+    void flush();
+    bool writeRecord(const Record& record);
+
+    int m_rows = 1;
+    int m_cellsPerLayer = COLUMNS;
+    float m_cellsPerUnitX = 0.0f;
+    float m_cellsPerUnitY = 0.0f;
+    float m_worldWidth = 0.0f;
+    float m_worldHeight = 0.0f;
+    std::vector<uint32_t> m_counts; // layer after layer, rows after rows
+
+    uint32_t m_tick = 0;
+    uint32_t m_recordStartTick = 0;
+    std::string m_path;
+    float m_flushSeconds = 10.0f;
+    float m_lastFlush = 0.0f;
+
+    std::deque<Record> m_records; // waiting for the thread
+    std::condition_variable m_wake;
+    std::vector<uint8_t> m_encoded; // the thread's scratch
+};
+
+// Sums every record of a telemetry file and writes <outDir>/<file name>_<layer>.png
+// for each layer that has counts, log scaled from dark blue to white. Returns the
+// number of images written, -1 when the file could not be read.
+int RenderTelemetryHeatmaps(const std::string& path, const std::string& outDir);
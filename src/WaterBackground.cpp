@@ -0,0 +1,114 @@
+#include "WaterBackground.h"
+#include <cmath>
+
+static const char* WATER_VERTEX_SHADER = R"(
+#version 120
+varying vec2 texCoord;
+void main() {
+    texCoord = gl_MultiTexCoord0.xy;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+}
+)";
+
+// Bubble positions come in from bubbleAt() each frame (x, y, size), the pixels only
+// measure the distance to them.
+static const char* WATER_FRAGMENT_SHADER = R"(
+#version 120
+#define MAX_BUBBLES 32
+uniform sampler2D background;
+uniform vec2 resolution;
+uniform vec2 shake;
+uniform vec4 waterTint;
+uniform int bubbleCount;
+uniform vec3 bubbles[MAX_BUBBLES];
+varying vec2 texCoord;
+void main() {
+    vec2 pixel = texCoord * resolution - shake;
+    vec3 color = texture2D(background, clamp(pixel / resolution, 0.0, 1.0)).rgb;
+    for (int i = 0; i < MAX_BUBBLES; i++) {
+        if (i >= bubbleCount) break;
+        vec3 bubble = bubbles[i];
+        float d = length(pixel - bubble.xy);
+        color = mix(color, vec3(1.0), 0.7 * (1.0 - smoothstep(bubble.z - 1.0, bubble.z, d)));
+    }
+    gl_FragColor = vec4(mix(color, waterTint.rgb, waterTint.a), 1.0);
+}
+)";
+
+
+void WaterBackground::setup(int bubbleCount, float width, float height) {
+    bubbleCount = std::min(bubbleCount, MAX_BUBBLES);
+    m_bubbles.clear();
+    for (int i = 0; i < bubbleCount; i++) {
+        Bubble b;
+        b.pos.set(ofRandom(width), ofRandom(height));
+        b.size = ofRandom(3, 10);
+        b.speed = ofRandom(0.5, 2.0);
+        b.wobble = ofRandom(0, TWO_PI);
+        m_bubbles.push_back(b);
+    }
+    m_visibleBubbles = m_bubbles.size();
+
+    m_shaderReady = m_shader.setupShaderFromSource(GL_VERTEX_SHADER, WATER_VERTEX_SHADER)
+                 && m_shader.setupShaderFromSource(GL_FRAGMENT_SHADER, WATER_FRAGMENT_SHADER)
+                 && m_shader.linkProgram();
+    if (!m_shaderReady) {
+        ofLogError() << "Water shader failed to build, drawing the background the slow way" << std::endl;
+    }
+}
+
+void WaterBackground::draw(const ofTexture& background, float width, float height, double frames,
+                           const ofFloatColor& waterTint, const ofVec2f& shake) const {
+    if (!m_shaderReady || !m_useShader) {
+        this->drawWithoutShader(background, width, height, frames, waterTint, shake);
+        return;
+    }
+    m_shader.begin();
+    m_shader.setUniformTexture("background", background, 0);
+    m_shader.setUniform2f("resolution", width, height);
+    m_shader.setUniform2f("shake", shake.x, shake.y);
+    m_shader.setUniform4f("waterTint", waterTint.r, waterTint.g, waterTint.b, waterTint.a);
+    m_shader.setUniform1i("bubbleCount", m_visibleBubbles);
+    if (m_visibleBubbles > 0) {
+        // once per bubble here instead of once per bubble and pixel in the shader
+        m_bubbleUniforms.clear();
+        for (int i = 0; i < m_visibleBubbles; i++) {
+            ofVec2f p = this->bubbleAt(m_bubbles[i], height, frames);
+            m_bubbleUniforms.insert(m_bubbleUniforms.end(), {p.x, p.y, m_bubbles[i].size});
+        }
+        m_shader.setUniform3fv("bubbles", m_bubbleUniforms.data(), m_visibleBubbles);
+    }
+    ofSetColor(ofColor::white);
+    background.draw(0, 0, width, height); // the quad the shader runs over
+    m_shader.end();
+}
+
+// Up by speed pixels a frame, swaying by the integral of sin(wobble) * 0.5, respawning
+// at the bottom 20 pixels past the top. Worked out in double: in float speed * frames
+// stops resolving a pixel after a few days and frames itself stops counting at 2^24
+ofVec2f WaterBackground::bubbleAt(const Bubble& bubble, float height, double frames) const {
+    double span = height + 40.0;
+    double y = std::fmod(bubble.pos.y - bubble.speed * frames + 20.0, span);
+    if (y < 0) y += span;
+    double sway = std::fmod(0.05 * frames, TWO_PI); // cos() is only accurate on small angles
+    double x = bubble.pos.x + 10.0 * (std::cos(bubble.wobble) - std::cos(bubble.wobble + sway));
+    return ofVec2f(static_cast<float>(x), static_cast<float>(y - 20.0));
+}
+
+void WaterBackground::drawWithoutShader(const ofTexture& background, float width, float height, double frames,
+                                        const ofFloatColor& waterTint, const ofVec2f& shake) const {
+    ofPushMatrix();
+    ofTranslate(shake.x, shake.y);
+    ofSetColor(ofColor::white);
+    background.draw(0, 0, width, height);
+    ofSetColor(255, 255, 255, 180);
+    for (int i = 0; i < m_visibleBubbles; i++) {
+        const Bubble& bubble = m_bubbles[i];
+        ofVec2f p = this->bubbleAt(bubble, height, frames);
+        ofDrawCircle(p.x, p.y, bubble.size);
+    }
+    ofPopMatrix();
+    ofSetColor(waterTint);
+    ofDrawRectangle(0, 0, width, height);
+    ofSetColor(ofColor::white);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Start values of one rising bubble, where it is later is worked out from the clock
+struct Bubble {
+    ofVec2f pos;
+    float size;
+    float speed;  // pixels per frame
+    float wobble; // sideways sway phase
+};
+
+// Background image, rising bubbles, the water tint pulse and the screen shake in
+// one full screen shader pass. Before this every aquarium frame filled the screen
+// twice (image and tint overlay) and drew each bubble on its own.
+class WaterBackground {
+public:
+    static constexpr int MAX_BUBBLES = 32;
+
+    void setup(int bubbleCount, float width, float height);
+    // frames drives the bubbles, waterTint is the pulse color (alpha = strength)
+    // and shake is the screen shake offset in pixels. frames is a double so the
+    // bubbles keep moving smoothly on a kiosk that runs for weeks
+    void draw(const ofTexture& background, float width, float height, double frames,
+              const ofFloatColor& waterTint, const ofVec2f& shake) const;
+    // draw only the first count bubbles, the quality governor turns this down
+    void setVisibleBubbles(int count) { m_visibleBubbles = std::max(0, std::min(count, int(m_bubbles.size()))); }
+    int getVisibleBubbles() const { return m_visibleBubbles; }
+    // draws the old way (image, bubbles, tint overlay) even when the shader built,
+    // so the fill rate benchmark can compare the two
+    void setUseShader(bool use) { m_useShader = use; }
+
+private:
+    void drawWithoutShader(const ofTexture& background, float width, float height, double frames,
+                           const ofFloatColor& waterTint, const ofVec2f& shake) const;
+    ofVec2f bubbleAt(const Bubble& bubble, float height, double frames) const;
+
+    ofShader m_shader;
+    bool m_shaderReady = false;
+    bool m_useShader = true;
+    std::vector<Bubble> m_bubbles;
+    int m_visibleBubbles = 0;
+    mutable std::vector<float> m_bubbleUniforms; // x, y, size per bubble for this frame
+};
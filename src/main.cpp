@@ -1,17 +1,34 @@
 #include "ofMain.h"
+#include "ofAppNoWindow.h"
 #include "ofApp.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char* argv[]){
 
-	//Use ofGLFWWindowSettings for more options like multi-monitor fullscreen
-	ofGLWindowSettings settings;
+	AppOptions options = AppOptions::Parse(argc, argv);
+
+	//ofGLFWWindowSettings has more options like multi-monitor fullscreen
+	ofGLFWWindowSettings settings;
 	settings.setSize(1024, 768);
 	settings.windowMode = OF_WINDOW; //can also be OF_FULLSCREEN
+	// --render and --soak draw offscreen, the window is only there for its GL context.
+	// On CI run them under xvfb-run with LIBGL_ALWAYS_SOFTWARE=1 (Mesa llvmpipe)
+	settings.visible = options.renderReplay.empty() && options.soakHours <= 0;
 
-	auto window = ofCreateWindow(settings);
+	std::shared_ptr<ofAppBaseWindow> window;
+	if(options.serverPort != 0 || !options.heatmapPath.empty()){
+		// the multiplayer server has nothing to draw, --heatmap only writes PNGs
+		auto noWindow = std::make_shared<ofAppNoWindow>();
+		ofGetMainLoop()->addWindow(noWindow);
+		noWindow->setup(settings);
+		window = noWindow;
+	} else {
+		window = ofCreateWindow(settings);
+	}
 
-	ofRunApp(window, std::make_shared<ofApp>());
-	ofRunMainLoop();
+	auto app = std::make_shared<ofApp>();
+	app->options = options;
+	ofRunApp(window, app);
+	return ofRunMainLoop(); // nonzero when --replay_check found a failure
 
 }
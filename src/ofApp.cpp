@@ -1,18 +1,179 @@
 #include "ofApp.h"
+#include "Benchmark.h"
+#include <ctime>
+#include <cstdlib>
+
+//--------------------------------------------------------------
+AppOptions AppOptions::Parse(int argc, char* argv[]){
+    AppOptions opts;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        auto value = [&arg](const std::string& prefix){ return arg.substr(prefix.size()); };
+        if(arg == "--benchmark"){
+            opts.benchmark = true;
+        } else if(arg.rfind("--benchmark_out=", 0) == 0){
+            opts.benchmark = true;
+            opts.benchmarkOut = value("--benchmark_out=");
+        } else if(arg.rfind("--benchmark_filter=", 0) == 0){
+            opts.benchmark = true;
+            opts.benchmarkFilter = value("--benchmark_filter=");
+        } else if(arg.rfind("--benchmark_min_time=", 0) == 0){
+            opts.benchmarkMinSeconds = ofToFloat(value("--benchmark_min_time="));
+        } else if(arg.rfind("--seed=", 0) == 0){
+            std::string text = value("--seed=");
+            char* end = nullptr;
+            unsigned long long seed = std::strtoull(text.c_str(), &end, 10);
+            if(text.empty() || !isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' || seed == 0 || seed > UINT32_MAX){
+                ofLogWarning() << "Ignoring " << arg << ", the seed has to be a number from 1 to " << UINT32_MAX << std::endl;
+            } else {
+                opts.seed = static_cast<uint32_t>(seed);
+            }
+        } else if(arg.rfind("--record=", 0) == 0){
+            opts.recordPath = value("--record=");
+        } else if(arg == "--replay_check"){
+            opts.replayCheck = true;
+        } else if(arg.rfind("--replay_check=", 0) == 0){
+            opts.replayCheck = true;
+            opts.replayDir = value("--replay_check=");
+        } else if(arg == "--replay_update_baseline"){
+            opts.replayCheck = true;
+            opts.replayUpdateBaseline = true;
+        } else if(arg == "--input_latency"){
+            opts.inputLatency = true;
+        } else if(arg == "--pack_assets"){
+            opts.packAssets = true;
+        } else if(arg == "--check_pack"){
+            opts.checkPack = true;
+        } else if(arg == "--server"){
+            opts.serverPort = 7777;
+        } else if(arg.rfind("--server=", 0) == 0){
+            opts.serverPort = static_cast<uint16_t>(ofToInt(value("--server=")));
+        } else if(arg.rfind("--connect=", 0) == 0){
+            opts.connectAddress = value("--connect=");
+        } else if(arg.rfind("--render=", 0) == 0){
+            opts.renderReplay = value("--render=");
+        } else if(arg.rfind("--render_out=", 0) == 0){
+            opts.renderOut = value("--render_out=");
+        } else if(arg.rfind("--render_every=", 0) == 0){
+            opts.renderEvery = std::max(1, ofToInt(value("--render_every=")));
+        } else if(arg == "--render_raw"){
+            opts.renderRaw = true;
+        } else if(arg.rfind("--render_golden=", 0) == 0){
+            opts.renderGolden = value("--render_golden=");
+        } else if(arg.rfind("--render_tolerance=", 0) == 0){
+            opts.renderTolerance = ofClamp(ofToInt(value("--render_tolerance=")), 0, 255);
+        } else if(arg == "--render_update_golden"){
+            opts.renderUpdateGolden = true;
+        } else if(arg.rfind("--heatmap=", 0) == 0){
+            opts.heatmapPath = value("--heatmap=");
+        } else if(arg == "--soak"){
+            opts.soakHours = SoakSettings().gameHours;
+        } else if(arg.rfind("--soak=", 0) == 0){
+            opts.soakHours = ofToDouble(value("--soak="));
+        } else if(arg.rfind("--soak_sample=", 0) == 0){
+            opts.soakSampleMinutes = ofToDouble(value("--soak_sample="));
+        } else if(arg.rfind("--soak_out=", 0) == 0){
+            opts.soakOut = value("--soak_out=");
+        } else if(arg.rfind("--soak_draw_every=", 0) == 0){
+            opts.soakDrawEvery = std::max(0, ofToInt(value("--soak_draw_every=")));
+        } else {
+            ofLogWarning() << "Unknown argument " << arg << std::endl;
+        }
+    }
+    return opts;
+}
 
 //--------------------------------------------------------------
 void ofApp::setup(){
+    ALLOC_SCOPE(AllocTag::ASSETS);
+    ofDisableArbTex(); // the sprite shader samples 0..1 texture coordinates
+
+    if(options.packAssets){
+        std::string dataDir = ofToDataPath("", true);
+        bool packed = AssetPack::Write(dataDir, AssetPack::StartupAssets(dataDir), ofToDataPath("assets.aqpack", true));
+        ofExit(packed ? 0 : 1);
+        return;
+    }
+    if(!options.heatmapPath.empty()){
+        int written = RenderTelemetryHeatmaps(ofToDataPath(options.heatmapPath, true), ofToDataPath("heatmaps", true));
+        ofExit(written > 0 ? 0 : 1);
+        return;
+    }
+    // the soak plays its own headless app, so this one starts no music, sound,
+    // exporters or telemetry that would run along for the whole soak
+    if(options.soakHours > 0){
+        SoakSettings soak;
+        soak.gameHours = options.soakHours;
+        soak.sampleMinutes = options.soakSampleMinutes;
+        soak.drawEvery = options.soakDrawEvery;
+        soak.csvPath = ofToDataPath(options.soakOut, true);
+        if(options.seed != 0) soak.seed = options.seed;
+        ofExit(RunSoak(soak));
+        return;
+    }
+    // one mapped file for every startup image when it has been packed, see AssetPack.h
+    AssetPack::Get().setCheckSources(options.checkPack);
+    AssetPack::Get().open(ofToDataPath("assets.aqpack", true));
+
+    // the simulation only uses rand(), seeding it here makes a run repeatable
+    uint32_t seed = options.seed;
+    if(seed == 0 && !options.recordPath.empty()){
+        seed = static_cast<uint32_t>(time(nullptr));
+    }
+    if(seed != 0){
+        srand(seed);
+        ofSeedRandom(seed);
+        recording.seed = seed;
+    }
+
+    ofXml settings;
+    bool hasSettings = settings.load("settings.xml");
+    auto group = settings.getChild("group");
 
     ofSetFrameRate(60);
+    // the tank can be bigger than the window (settings.xml)
+    int worldWidth = std::max(ofGetWindowWidth(), group.getChild("world_width").getIntValue());
+    int worldHeight = std::max(ofGetWindowHeight(), group.getChild("world_height").getIntValue());
+    if(hasSettings && group.getChild("idle_fps")){
+        idleFrameRate = ofClamp(group.getChild("idle_fps").getIntValue(), 1, 60);
+    }
+    if(hasSettings && group.getChild("ai_decisions_per_tick")){
+        aiDecisionsPerTick = group.getChild("ai_decisions_per_tick").getIntValue();
+    }
+    // telemetry counts from here on, the aquarium only reports to it when there is a file
+    telemetry.setup(worldWidth, worldHeight);
+    if(hasSettings && !options.headless && !group.getChild("telemetry_file").getValue().empty()){
+        float flushSeconds = group.getChild("telemetry_flush_seconds").getFloatValue();
+        telemetry.start(ofToDataPath(group.getChild("telemetry_file").getValue(), true), flushSeconds > 0 ? flushSeconds : 10.0f);
+    }
+    // a time budget depends on the machine, replays and the server have to repeat exactly
+    if(hasSettings && !options.headless && options.serverPort == 0){
+        aiBudgetMicros = group.getChild("ai_budget_us").getFloatValue();
+    }
+
+    if(options.serverPort != 0){
+        // no window and no GL, the sprites only need their sizes
+        GameSprite::SetUseTextures(false);
+        spriteManager = std::make_shared<AquariumSpriteManager>();
+        AssetPack::Get().close();
+        server = std::make_unique<AquariumServer>(createAquarium(worldWidth, worldHeight), spriteManager);
+        if(!server->start(options.serverPort)){
+            ofExit(1);
+        }
+        return;
+    }
+
     ofSetBackgroundColor(ofColor::blue);
-    backgroundImage.load("background.png");
+    AssetPack::Get().loadImage("background.png", backgroundImage);
     backgroundImage.resize(ofGetWindowWidth(), ofGetWindowHeight());
 
-    // load background ambient music (preload to avoid first-play hitch)
-    // Try .wav first, then .ogg as fallback
-    if (!bgMusic.load("ambient.wav")) {
+    // background ambient music, streamed from disk in small chunks instead of
+    // decoding the whole file into memory. Try .wav first, then .ogg as fallback
+    if (options.headless) {
+        // replays don't need sound
+    } else if (!bgMusic.load("ambient.wav", true)) {
         ofLogWarning() << "Failed to load ambient.wav, trying ambient.ogg";
-        if (!bgMusic.load("ambient.ogg")) {
+        if (!bgMusic.load("ambient.ogg", true)) {
             ofLogError() << "Failed to load both ambient.wav and ambient.ogg";
         } else {
             ofLogNotice() << "Successfully loaded ambient.ogg";
@@ -43,21 +204,17 @@ void ofApp::setup(){
     spriteManager = std::make_shared<AquariumSpriteManager>();
 
     // Lets setup the aquarium
-    myAquarium = std::make_shared<Aquarium>(ofGetWindowWidth(), ofGetWindowHeight(), spriteManager);
-    player = std::make_shared<PlayerCreature>(ofGetWindowWidth()/2 - 50, ofGetWindowHeight()/2 - 50, DEFAULT_SPEED, this->spriteManager->GetSprite(AquariumCreatureType::NPCreature));
-    player->setDirection(0, 0); // Initially stationary
-    player->setBounds(ofGetWindowWidth() - 20, ofGetWindowHeight() - 20);
-
-
-    myAquarium->addAquariumLevel(std::make_shared<Level_0>(0, 25));
-    myAquarium->addAquariumLevel(std::make_shared<Level_1>(1, 50));
-    myAquarium->addAquariumLevel(std::make_shared<Level_2>(2, 200));
-    myAquarium->Repopulate(); // initial population
+    myAquarium = createAquarium(worldWidth, worldHeight);
+    player = createPlayer(worldWidth, worldHeight);
 
     // now that we are mostly set, lets pass the player and the aquarium downstream
-    gameManager->AddScene(std::make_shared<AquariumGameScene>(
-        std::move(player), std::move(myAquarium), GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)
-    )); // player and aquarium are owned by the scene moving forward
+    auto aquariumScene = std::make_shared<AquariumGameScene>(
+        player, std::move(myAquarium), GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)
+    ); // player and aquarium are owned by the scene moving forward
+    aquariumScene->GetCamera().setWorld(worldWidth, worldHeight);
+    aquariumScene->GetCamera().setViewport(ofGetWindowWidth(), ofGetWindowHeight());
+    aquariumScene->GetCamera().snapTo(player->getX(), player->getY());
+    gameManager->AddScene(aquariumScene);
 
     // Load font for game over message
     gameOverTitle.load("Verdana.ttf", 12, true, true);
@@ -76,25 +233,192 @@ void ofApp::setup(){
         std::make_shared<GameSprite>("game-over.png", ofGetWindowWidth(), ofGetWindowHeight())
     ));
 
-    // Initialize bubbles
-    for(int i = 0; i < 20; i++){
-        Bubble b;
-        b.pos.set(ofRandom(ofGetWidth()), ofRandom(ofGetHeight()));
-        b.size = ofRandom(3, 10);
-        b.speed = ofRandom(0.5, 2.0);
-        b.wobble = ofRandom(0, TWO_PI);
-        bubbles.push_back(b);
+    if(!options.connectAddress.empty()){
+        NetAddress address;
+        if(NetAddress::Parse(options.connectAddress, address)){
+            networkScene = std::make_shared<NetworkGameScene>(GameSceneKindToString(GameSceneKind::NETWORK_GAME), address, spriteManager);
+            gameManager->AddScene(networkScene);
+        } else {
+            ofLogError() << "Bad --connect address " << options.connectAddress << ", expected host:port" << std::endl;
+        }
+    }
+
+    waterBackground.setup(20, ofGetWidth(), ofGetHeight());
+    // every image is decoded and on the GPU by now
+    AssetPack::Get().close();
+    if(hasSettings){
+        quality.setMode(group.getChild("effects_quality").getValue());
     }
 
     ofSetLogLevel(OF_LOG_NOTICE); // Set default log level
+
+    // sound effects for eating, getting hurt and new levels
+    if(!options.headless){
+        sfx.setup();
+        if(hasSettings && group.getChild("sfx_volume")){
+            sfx.setVolume(group.getChild("sfx_volume").getFloatValue());
+        }
+    }
+
+    // metrics are off unless settings.xml asks for a port or a file
+    if(!options.headless && hasSettings){
+        int metricsPort = group.getChild("metrics_port").getIntValue();
+        std::string metricsFile = group.getChild("metrics_file").getValue();
+        float flushSeconds = group.getChild("metrics_flush_seconds").getFloatValue();
+        metricsExporter.start(metricsPort, metricsFile.empty() ? "" : ofToDataPath(metricsFile), flushSeconds > 0 ? flushSeconds : 10.0f);
+    }
+
+    if(options.benchmark){
+        runBenchmarks();
+        ofExit(0);
+    }
+    if(options.replayCheck){
+        int failures = RunReplayChecks(ofToDataPath(options.replayDir, true), options.replayUpdateBaseline);
+        ofExit(failures > 0 ? 1 : 0);
+    }
+    if(!options.renderReplay.empty()){
+        ReplayRenderSettings render;
+        std::string name = ofFilePath::getBaseName(options.renderReplay);
+        render.outDir = ofToDataPath(options.renderOut.empty() ? "renders/" + name : options.renderOut, true);
+        render.every = options.renderEvery;
+        render.format = options.renderRaw ? FrameFormat::RAW : FrameFormat::PNG;
+        if(!options.renderGolden.empty()){
+            render.compare.goldenDir = ofToDataPath(options.renderGolden, true);
+        }
+        render.compare.channelTolerance = options.renderTolerance;
+        render.compare.updateGolden = options.renderUpdateGolden;
+        ofExit(RunReplayRender(ofToDataPath(options.renderReplay, true), render));
+    }
+}
+
+//--------------------------------------------------------------
+// the tank with its levels, shared by the single player game and the server
+std::shared_ptr<Aquarium> ofApp::createAquarium(int worldWidth, int worldHeight){
+    auto aquarium = std::make_shared<Aquarium>(worldWidth, worldHeight, spriteManager);
+    aquarium->setAiBudget(aiDecisionsPerTick, aiBudgetMicros);
+    if(telemetry.isThreadRunning()){
+        aquarium->setTelemetry(&telemetry);
+    }
+    // level populations were made for one window, keep the same density in a bigger tank
+    float populationScale = float(worldWidth) * worldHeight / (float(ofGetWindowWidth()) * ofGetWindowHeight());
+    std::vector<std::shared_ptr<AquariumLevel>> levels = {
+        std::make_shared<Level_0>(0, 25),
+        std::make_shared<Level_1>(1, 50),
+        std::make_shared<Level_2>(2, 200)
+    };
+    for(auto& level : levels){
+        level->ScalePopulation(populationScale);
+        aquarium->addAquariumLevel(level);
+    }
+    aquarium->Repopulate(); // initial population
+    return aquarium;
+}
+
+// the player in the middle of the tank, also used for every restart
+std::shared_ptr<PlayerCreature> ofApp::createPlayer(int worldWidth, int worldHeight){
+    auto player = std::make_shared<PlayerCreature>(worldWidth/2 - 50, worldHeight/2 - 50, DEFAULT_SPEED, this->spriteManager->GetSprite(AquariumCreatureType::NPCreature));
+    player->setDirection(0, 0); // Initially stationary
+    player->setBounds(worldWidth - 20, worldHeight - 20);
+    return player;
+}
+
+// SPACE on the game over screen: a new tank and player, the effects start over
+void ofApp::restartGame(){
+    auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+    int worldWidth = aquariumScene->GetAquarium()->getWidth();
+    int worldHeight = aquariumScene->GetAquarium()->getHeight();
+    auto player = createPlayer(worldWidth, worldHeight);
+    aquariumScene->Restart(player, createAquarium(worldWidth, worldHeight));
+
+    particles.clear();
+    ripples.clear();
+    comboCount = 0;
+    comboTimer = 0.0f;
+    shakeIntensity = 0.0f;
+    shakeDuration = 0.0f;
+    shakeOffset.set(0, 0);
+    powerUpCharge = powerUpMax;
+    powerUpActive = false;
+    lastScore = 0;
+    lastLives = player->getLives();
+    lastLevel = 0;
+    paused = false;
+
+    gameManager->Transition(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME));
+    if(!options.headless && !bgMusic.isPlaying()){
+        bgMusic.play();
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::runBenchmarks(){
+    BenchmarkRunner runner;
+    RegisterAquariumBenchmarks(runner);
+    std::string outPath = ofToDataPath(options.benchmarkOut, true);
+    ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(outPath), false, true);
+    ofSetLogLevel(OF_LOG_NOTICE); // verbose creature logging would dominate every timing
+    runner.run(outPath, options.benchmarkFilter, options.benchmarkMinSeconds);
 }
 
 //--------------------------------------------------------------
 void ofApp::update() {
+    if(server){
+        server->update();
+        return;
+    }
+    AllocTracker::BeginFrame();
+    frameWorkStart = ofGetElapsedTimeMicros();
+
+    if(options.inputLatency){
+        inputLatencyLogTimer += ofGetLastFrameTime();
+        if(inputLatencyLogTimer >= 5.0f){
+            inputLatencyLogTimer = 0.0f;
+            logInputLatency();
+        }
+    }
+
+    // static scenes drop to idle_fps, anything that moves brings back 60
+    bool idle = isIdleScene();
+    if(idle != lowPower){
+        lowPower = idle;
+        idleFrame.invalidate();
+        if(!options.headless){
+            ofSetFrameRate(lowPower ? idleFrameRate : 60);
+        }
+    }
+
+    // the simulation runs in whole 1/60 s ticks out of the real time that went by, a slow frame
+    // catches up with a few of them and a fast one may run none. headless runs (replays, soak,
+    // renders) have no real time to follow and take exactly one tick per update
+    int ticks = 1;
+    if(!options.headless){
+        tickAccumulator = std::min(tickAccumulator + ofGetLastFrameTime(), MAX_TICKS_PER_FRAME * TICK_SECONDS);
+        ticks = static_cast<int>(tickAccumulator / TICK_SECONDS);
+        tickAccumulator -= ticks * TICK_SECONDS;
+    }
+    for(int i = 0; i < ticks; i++){
+        simulationTick();
+    }
+
+    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
+        AquariumMetrics& metrics = AquariumMetrics::Get();
+        metrics.frameSeconds->observe(ofGetLastFrameTime());
+        metrics.particles->set(particles.size());
+        metrics.ripples->set(ripples.size());
+    }
+}
+
+// one fixed 1/60 s step of the game, the only place that looks at the keys
+void ofApp::simulationTick() {
+    updateFrame++;
+    input.sample(ofGetElapsedTimeMicros());
 
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::GAME_OVER)){
         return; //stop updating if game is over or exiting
     }
+    if(paused){
+        return; // the tank, the effects and their timers are frozen
+    }
 
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
         auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
@@ -106,18 +430,33 @@ void ofApp::update() {
         }
     }
 
-    gameManager->UpdateActiveScene();
+    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
+        applyInput();
+    }
+    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::NETWORK_GAME)){
+        ofVec2f direction = inputDirection();
+        networkScene->SetInput(direction.x, direction.y, input.isDown('p'));
+    }
+
+    {
+        ALLOC_SCOPE(AllocTag::SIM);
+        gameManager->UpdateActiveScene();
+    }
 
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
+        ALLOC_SCOPE(AllocTag::EFFECTS);
         auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
         auto player = gameScene->GetPlayer();
         auto aquarium = gameScene->GetAquarium();
         
-        // Check for FastFish eating and spawn red particles
-        std::vector<ofVec2f> fastFishEatPositions = aquarium->GetAndClearFastFishEatPositions();
-        for(const auto& pos : fastFishEatPositions){
+        // Check for creatures eating each other (FastFish in the stock levels) and spawn red particles
+        std::vector<ofVec2f> predationPositions = aquarium->GetAndClearPredationPositions();
+        for(const auto& pos : predationPositions){
+            // quieter when it happens off screen
+            sfx.trigger(SfxId::FASTFISH_EAT, gameScene->GetCamera().isVisible(pos.x, pos.y) ? 0.8f : 0.3f);
             // Spawn red particle burst
-            for(int i = 0; i < 8; i++){
+            int burst = particleBurst(8);
+            for(int i = 0; i < burst; i++){
                 Particle p;
                 p.pos = pos;
                 float angle = ofRandom(TWO_PI);
@@ -130,13 +469,13 @@ void ofApp::update() {
             }
         }
 
-        float deltaTime = 1.0f / 60.0f; 
+        float deltaTime = static_cast<float>(TICK_SECONDS);
         
         // Track player score to detect consumption and increment combo
-        static int lastScore = 0;
         int currentScore = player->getScore();
         if(currentScore > lastScore){
             // Player just consumed something!
+            sfx.trigger(SfxId::PLAYER_EAT);
             comboCount++;
             comboTimer = comboResetTime; // reset timer
             
@@ -144,16 +483,19 @@ void ofApp::update() {
             shakeIntensity = 5.0f;
             shakeDuration = 0.15f; // shake for 0.15 seconds
             
-            // Spawn ripple at player position
+            // Spawn ripple at player position, a few at most however fast the eating goes
             Ripple r;
             r.pos.set(player->getX(), player->getY());
             r.radius = 0;
             r.alpha = 255;
             r.maxRadius = 80;
-            ripples.push_back(r);
+            if(ripples.size() < MAX_RIPPLES){
+                ripples.push_back(r);
+            }
             
             // Spawn particle burst
-            for(int i = 0; i < 10; i++){
+            int burst = particleBurst(10);
+            for(int i = 0; i < burst; i++){
                 Particle p;
                 p.pos.set(player->getX(), player->getY());
                 float angle = ofRandom(TWO_PI);
@@ -170,6 +512,15 @@ void ofApp::update() {
             lastScore = currentScore;
         }
         
+        if(player->getLives() < lastLives){
+            sfx.trigger(SfxId::LOST_LIFE);
+        }
+        lastLives = player->getLives();
+        if(aquarium->getCurrentLevel() != lastLevel){
+            sfx.trigger(SfxId::NEW_LEVEL);
+            lastLevel = aquarium->getCurrentLevel();
+        }
+
         // Update combo timer
         if(comboTimer > 0){
             comboTimer -= deltaTime;
@@ -192,14 +543,14 @@ void ofApp::update() {
             if(powerUpCharge <= 0.0f){
                 powerUpCharge = 0.0f;
                 powerUpActive = false; // stops boost when empty
-                player->currentColor = ofColor::white; // reset color
+                player->setHueCycle(-1.0f); // reset color
             } else {
                 // boost player speed
                 player->setSpeed(boostedSpeed);
 
-                // rainbow color effect
-                float time = ofGetElapsedTimef();
-                player->currentColor.setHsb(fmod(time * 100, 255), 255, 255); 
+                // rainbow color effect, the sprite shader turns the hue into a color
+                hue = fmod(hue + deltaTime * 100.0f / 255.0f, 1.0f);
+                player->setHueCycle(hue);
             }
         } else {
             // powerup recharge
@@ -207,26 +558,16 @@ void ofApp::update() {
             if(powerUpCharge > powerUpMax) powerUpCharge = powerUpMax;
 
             player->setSpeed(DEFAULT_SPEED);
-            player->currentColor = ofColor::white; // reset to normal
+            player->setHueCycle(-1.0f); // reset to normal
         }
         
-        // Update bubbles
-        for(auto& bubble : bubbles){
-            bubble.pos.y -= bubble.speed;
-            bubble.wobble += 0.05;
-            bubble.pos.x += sin(bubble.wobble) * 0.5;
-            
-            // Respawn at bottom when reaching top
-            if(bubble.pos.y < -20){
-                bubble.pos.y = ofGetHeight() + 20;
-                bubble.pos.x = ofRandom(ofGetWidth());
-            }
-        }
+        // the water background works the bubbles out from this clock
+        bubbleFrames += 1.0;
         
         // Update ripples
         for(auto it = ripples.begin(); it != ripples.end();){
             it->radius += 3.0f;
-            it->alpha -= 8.0f;
+            it->alpha -= quality.getSettings().rippleFade;
             if(it->alpha <= 0 || it->radius > it->maxRadius){
                 it = ripples.erase(it);
             } else {
@@ -251,30 +592,134 @@ void ofApp::update() {
     }
 }
 
+// particles to spawn for a burst that has fullCount at full quality, never past the cap
+int ofApp::particleBurst(int fullCount) const {
+    const QualitySettings& settings = quality.getSettings();
+    int count = static_cast<int>(fullCount * settings.particleScale + 0.5f);
+    int room = settings.maxParticles - static_cast<int>(particles.size());
+    return std::max(0, std::min(count, room));
+}
+
+
+// intro, game over and the paused tank show the same picture until a key is pressed
+bool ofApp::isIdleScene() const {
+    std::string scene = gameManager->GetActiveSceneName();
+    return scene == GameSceneKindToString(GameSceneKind::GAME_INTRO)
+        || scene == GameSceneKindToString(GameSceneKind::GAME_OVER)
+        || (paused && scene == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME));
+}
+
+void ofApp::setPaused(bool pause){
+    paused = pause;
+    if(!options.headless){
+        bgMusic.setPaused(pause);
+    }
+    ofLogNotice() << (pause ? "Paused" : "Resumed") << std::endl;
+}
+
+//--------------------------------------------------------------
+// Turns the sampled keys into player movement and the boost. Movement uses the key
+// level (plus taps that started and ended inside the tick), the boost uses the edges.
+void ofApp::applyInput(){
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
+    auto player = gameScene->GetPlayer();
+
+    ofVec2f direction = inputDirection();
+    player->setDirection(direction.x, direction.y);
+
+    if(input.wasPressed('p') && powerUpCharge > 0.0f){
+        powerUpActive = true; //start boost
+    }
+    if(input.wasReleased('p') && !input.isDown('p')){
+        powerUpActive = false; //stops boost when key released
+    }
+}
+
+ofVec2f ofApp::inputDirection() const {
+    float dx = (input.isActive(OF_KEY_RIGHT) ? 1.0f : 0.0f) - (input.isActive(OF_KEY_LEFT) ? 1.0f : 0.0f);
+    float dy = (input.isActive(OF_KEY_DOWN) ? 1.0f : 0.0f) - (input.isActive(OF_KEY_UP) ? 1.0f : 0.0f);
+    return ofVec2f(dx, dy);
+}
+
+void ofApp::logInputLatency(){
+    const InputBuffer::LatencyStats& toTick = input.getInputToTick();
+    const InputBuffer::LatencyStats& toFrame = input.getInputToFrame();
+    ofLogNotice() << "Input latency over " << toTick.samples << " presses: to tick avg "
+                  << ofToString(toTick.averageMicros / 1000.0, 2) << " ms max " << ofToString(toTick.maxMicros / 1000.0, 2)
+                  << " ms, to frame avg " << ofToString(toFrame.averageMicros / 1000.0, 2) << " ms max "
+                  << ofToString(toFrame.maxMicros / 1000.0, 2) << " ms, ignored repeats " << input.getIgnoredRepeats() << std::endl;
+}
 
 //--------------------------------------------------------------
 void ofApp::draw(){
+    if(server) return;
+    ALLOC_SCOPE(AllocTag::UI);
+    if(lowPower){
+        // nothing on screen moves, the frame is only composed again when the key changes
+        if(!idleFrame.isAllocated()){
+            idleFrame.allocate(ofGetWidth(), ofGetHeight());
+        }
+        int64_t scene = static_cast<int64_t>(std::hash<std::string>()(gameManager->GetActiveSceneName()));
+        ofSetColor(255);
+        idleFrame.draw(0, 0, HudWidget::Key({scene, paused, showControlsOverlay, idleGeneration}), [&](){
+            drawScene();
+        });
+    } else {
+        drawScene();
+    }
+
+    if(showProfilerOverlay){
+        drawProfilerOverlay();
+    }
+    lastHudRepaints = HudWidget::TakeRepaintCount();
+
+    // the frame is submitted here, the buffer swap after this isn't counted
+    uint64_t frameWorkEnd = ofGetElapsedTimeMicros();
+    input.frameDrawn(frameWorkEnd);
+
+    // pick the effects quality for the next frame, idle frames are slow on purpose
+    if(!lowPower){
+        quality.observe((frameWorkEnd - frameWorkStart) * 1e-6f, ofGetLastFrameTime());
+    }
+    waterBackground.setVisibleBubbles(quality.getSettings().bubbles);
+    AquariumMetrics::Get().effectsQuality->set(static_cast<int>(quality.getTier()));
+}
+
+// everything but the profiler overlay
+void ofApp::drawScene(){
+    bool inAquarium = gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME);
+
+    // water tint pulse, the background pass and the sprite shader both blend it in
+    // so there is no full screen overlay on top anymore
+    ofFloatColor waterTint(0.0f, 100 / 255.0f, 150 / 255.0f, (10 + sin(waterOverlayPulse) * 5) / 255.0f);
+    if(inAquarium){
+        // background, bubbles, tint and the shake in one full screen pass
+        waterBackground.draw(backgroundImage.getTexture(), ofGetWidth(), ofGetHeight(), bubbleFrames, waterTint, shakeOffset);
+        SpriteBatch::Get().setWaterTint(waterTint);
+    }
+
     ofPushMatrix();
     
     // Apply screen shake offset
     ofTranslate(shakeOffset.x, shakeOffset.y);
     
-    backgroundImage.draw(0, 0);
+    if(!inAquarium){
+        backgroundImage.draw(0, 0);
+    }
     gameManager->DrawActiveScene();
 
-if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-    
-    // Draw bubbles
-    ofSetColor(255, 255, 255, 180); // Made more visible
-    for(const auto& bubble : bubbles){
-        ofDrawCircle(bubble.pos.x, bubble.pos.y, bubble.size);
-    }
+if(inAquarium){
     
+    // ripples and particles live in the tank, skip the ones the camera can't see
+    const AquariumCamera& camera = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene())->GetCamera();
+    camera.begin();
+
     // Draw ripples
     ofNoFill();
+    ofSetLineWidth(2);
     for(const auto& ripple : ripples){
+        if(!camera.isVisible(ripple.pos.x, ripple.pos.y, ripple.radius)) continue;
         ofSetColor(100, 200, 255, ripple.alpha);
-        ofSetLineWidth(2);
         ofDrawCircle(ripple.pos.x, ripple.pos.y, ripple.radius);
     }
     ofFill();
@@ -282,63 +727,116 @@ if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQU
     
     // Draw particles
     for(const auto& particle : particles){
+        if(!camera.isVisible(particle.pos.x, particle.pos.y, particle.size)) continue;
         ofSetColor(particle.color.r, particle.color.g, particle.color.b, particle.alpha);
         ofDrawCircle(particle.pos.x, particle.pos.y, particle.size);
     }
+    camera.end();
     
-    // Draw water color overlay with pulse
-    float pulseAlpha = 10 + sin(waterOverlayPulse) * 5;
-    ofSetColor(0, 100, 150, pulseAlpha);
-    ofDrawRectangle(0, 0, ofGetWidth(), ofGetHeight());
-    
+    // HUD pieces are cached in FBOs and only repainted when what they show changes
     float barWidth = 200.0f;
     float barHeight = 20.0f;
     float x = ofGetWidth() / 2 - barWidth / 2;
     float y = 20.0f;
 
-    ofSetColor(100, 100, 100);
-    ofDrawRectangle(x, y, barWidth, barHeight);
+    if(!powerBarWidget.isAllocated()){
+        powerBarWidget.allocate(barWidth + 2, barHeight + 2);
+    }
+    int chargePixels = static_cast<int>(barWidth * (powerUpCharge / 100.0f));
+    ofSetColor(255);
+    powerBarWidget.draw(x - 1, y - 1, HudWidget::Key({chargePixels}), [&](){
+        ofSetColor(100, 100, 100);
+        ofDrawRectangle(1, 1, barWidth, barHeight);
 
-    ofSetColor(50, 200, 50); //green
-    ofDrawRectangle(x, y, barWidth * (powerUpCharge / 100.0f), barHeight);
+        ofSetColor(50, 200, 50); //green
+        ofDrawRectangle(1, 1, chargePixels, barHeight);
 
-    ofNoFill();
-    ofSetColor(255);
-    ofDrawRectangle(x, y, barWidth, barHeight);
-    ofFill();
+        ofNoFill();
+        ofSetColor(255);
+        ofDrawRectangle(1, 1, barWidth, barHeight);
+        ofFill();
+    });
     
     // Draw combo counter
     if(comboCount > 1){
-        ofSetColor(255, 255, 0); // yellow
         string comboText = "COMBO x" + ofToString(comboCount);
+        bool comboEffects = quality.getSettings().comboEffects;
+        uint64_t comboKey = HudWidget::Key({comboCount, comboEffects});
         float comboSize = 20 + comboCount * 2; // size grows with combo
-        
-        ofTrueTypeFont comboFont;
-        comboFont.load("Verdana.ttf", comboSize, true, true);
+        if(comboFontSize != comboSize){
+            comboFont.load("Verdana.ttf", comboSize, true, true);
+            comboFontSize = comboSize;
+        }
+        // text box relative to the baseline, the shadow needs 2px more
+        ofRectangle box = comboFont.getStringBoundingBox(comboText, 0, 0);
+        if(box.width + 4 > comboWidgetSize.x || box.height + 4 > comboWidgetSize.y){
+            comboWidgetSize.set(std::max(comboWidgetSize.x, box.width + 4), std::max(comboWidgetSize.y, box.height + 4));
+            comboWidget.allocate(comboWidgetSize.x, comboWidgetSize.y);
+        }
         
         float comboWidth = comboFont.stringWidth(comboText);
         float comboX = ofGetWidth() / 2 - comboWidth / 2;
         float comboY = 80;
         
-        // Shadow
-        ofSetColor(0, 0, 0, 180);
-        comboFont.drawString(comboText, comboX + 2, comboY + 2);
-        
-        // Main text with pulsing effect
-        float pulse = sin(ofGetElapsedTimef() * 10) * 0.5 + 0.5;
-        ofSetColor(255, 255, 0, 150 + pulse * 105);
-        comboFont.drawString(comboText, comboX, comboY);
+        // Main text with pulsing effect, shadow and pulse only when there is frame time to spare.
+        // The pulse follows the ticks, not the wall clock, so --render frames repeat exactly
+        float pulse = comboEffects ? sin(updateFrame / 60.0f * 10) * 0.5 + 0.5 : 1.0f;
+        ofSetColor(255, 255, 255, 150 + pulse * 105);
+        comboWidget.draw(comboX + box.x, comboY + box.y, comboKey, [&](){
+            if(comboEffects){
+                ofSetColor(0, 0, 0, 180);
+                comboFont.drawString(comboText, 2 - box.x, 2 - box.y);
+            }
+            ofSetColor(255, 255, 0); // yellow
+            comboFont.drawString(comboText, -box.x, -box.y);
+        });
     }
     
     // Draw controls overlay
     if(showControlsOverlay){
-        // Semi-transparent dark overlay
-        ofSetColor(0, 0, 0, overlayAlpha);
         float overlayWidth = 500;
         float overlayHeight = 380;
         float overlayX = ofGetWidth() / 2 - overlayWidth / 2;
         float overlayY = ofGetHeight() / 2 - overlayHeight / 2;
-        
+        // the content never changes, only the quality tier can change how it looks
+        if(!controlsWidget.isAllocated()){
+            controlsWidget.allocate(overlayWidth + 4, overlayHeight + 4);
+        }
+        bool overlayEffects = quality.getSettings().overlayEffects;
+        ofSetColor(255);
+        controlsWidget.draw(overlayX - 2, overlayY - 2, HudWidget::Key({overlayEffects}), [&](){
+            paintControlsOverlay(2, 2, overlayWidth, overlayHeight, overlayEffects);
+        });
+    }
+
+    if(paused){
+        paintPausedBanner();
+    }
+}
+
+    ofPopMatrix(); // End screen shake transform
+}
+
+//--------------------------------------------------------------
+void ofApp::paintPausedBanner(){
+    // dim the frozen tank, the frame is cached so this costs nothing while paused
+    ofSetColor(0, 0, 0, 120);
+    ofDrawRectangle(0, 0, ofGetWidth(), ofGetHeight());
+
+    float bannerY = ofGetHeight() - 90;
+    ofSetColor(100, 200, 255);
+    string title = "PAUSED";
+    controlsTitleFont.drawString(title, ofGetWidth() / 2 - controlsTitleFont.stringWidth(title) / 2, bannerY);
+    ofSetColor(255, 255, 100);
+    string hint = "Press SPACE to resume";
+    controlsFont.drawString(hint, ofGetWidth() / 2 - controlsFont.stringWidth(hint) / 2, bannerY + 35);
+}
+
+//--------------------------------------------------------------
+void ofApp::paintControlsOverlay(float overlayX, float overlayY, float overlayWidth, float overlayHeight, bool effects){
+    // Semi-transparent dark overlay
+    ofSetColor(0, 0, 0, overlayAlpha);
+    if(effects){
         // Draw rounded rectangle background
         ofDrawRectRounded(overlayX, overlayY, overlayWidth, overlayHeight, 15);
         
@@ -349,74 +847,201 @@ if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQU
         ofDrawRectRounded(overlayX, overlayY, overlayWidth, overlayHeight, 15);
         ofFill();
         ofSetLineWidth(1);
-        
-        // Title
-        ofSetColor(100, 200, 255);
-        string title = "CONTROLS";
-        float titleWidth = controlsTitleFont.stringWidth(title);
-        controlsTitleFont.drawString(title, overlayX + overlayWidth/2 - titleWidth/2, overlayY + 45);
-        
-        // Draw controls text
-        ofSetColor(255, 255, 255);
-        float textX = overlayX + 50;
-        float textY = overlayY + 90;
-        float lineSpacing = 35;
-        
-        controlsFont.drawString("MOVEMENT", textX, textY);
-        textY += lineSpacing;
-        
-        ofSetColor(200, 200, 200);
-        controlsFont.drawString("Arrow Keys / WASD - Move your fish", textX + 20, textY);
-        textY += lineSpacing;
-        
-        ofSetColor(255, 255, 255);
-        controlsFont.drawString("POWER-UP", textX, textY);
-        textY += lineSpacing;
-        
-        ofSetColor(200, 200, 200);
-        controlsFont.drawString("Hold P - Activate speed boost", textX + 20, textY);
-        textY += lineSpacing;
-        controlsFont.drawString("(Depletes green bar, recharges when off)", textX + 20, textY);
-        textY += lineSpacing + 10;
-        
-        ofSetColor(255, 255, 255);
-        controlsFont.drawString("OBJECTIVE", textX, textY);
-        textY += lineSpacing;
-        
-        ofSetColor(200, 200, 200);
-        controlsFont.drawString("Consume smaller creatures to score points", textX + 20, textY);
-        textY += lineSpacing;
-        controlsFont.drawString("Reach target score to advance levels", textX + 20, textY);
-        textY += lineSpacing;
-        controlsFont.drawString("Avoid or consume larger fish!", textX + 20, textY);
-        
-        // Close instruction at bottom
-        textY = overlayY + overlayHeight - 40;
-        ofSetColor(255, 255, 100);
-        string closeMsg = "Press C to close this overlay";
-        float closeMsgWidth = controlsFont.stringWidth(closeMsg);
-        controlsFont.drawString(closeMsg, overlayX + overlayWidth/2 - closeMsgWidth/2, textY);
+    } else {
+        ofDrawRectangle(overlayX, overlayY, overlayWidth, overlayHeight);
     }
+    
+    // Title
+    ofSetColor(100, 200, 255);
+    string title = "CONTROLS";
+    float titleWidth = controlsTitleFont.stringWidth(title);
+    controlsTitleFont.drawString(title, overlayX + overlayWidth/2 - titleWidth/2, overlayY + 45);
+    
+    // Draw controls text
+    ofSetColor(255, 255, 255);
+    float textX = overlayX + 50;
+    float textY = overlayY + 90;
+    float lineSpacing = 35;
+    
+    controlsFont.drawString("MOVEMENT", textX, textY);
+    textY += lineSpacing;
+    
+    ofSetColor(200, 200, 200);
+    controlsFont.drawString("Arrow Keys / WASD - Move your fish", textX + 20, textY);
+    textY += lineSpacing;
+    
+    ofSetColor(255, 255, 255);
+    controlsFont.drawString("POWER-UP", textX, textY);
+    textY += lineSpacing;
+    
+    ofSetColor(200, 200, 200);
+    controlsFont.drawString("Hold P - Activate speed boost", textX + 20, textY);
+    textY += lineSpacing;
+    controlsFont.drawString("(Depletes green bar, recharges when off)", textX + 20, textY);
+    textY += lineSpacing + 10;
+    
+    ofSetColor(255, 255, 255);
+    controlsFont.drawString("OBJECTIVE", textX, textY);
+    textY += lineSpacing;
+    
+    ofSetColor(200, 200, 200);
+    controlsFont.drawString("Consume smaller creatures to score points", textX + 20, textY);
+    textY += lineSpacing;
+    controlsFont.drawString("Reach target score to advance levels", textX + 20, textY);
+    textY += lineSpacing;
+    controlsFont.drawString("Avoid or consume larger fish!", textX + 20, textY);
+    
+    // Close instruction at bottom
+    textY = overlayY + overlayHeight - 40;
+    ofSetColor(255, 255, 100);
+    string closeMsg = "Press C to close this overlay";
+    float closeMsgWidth = controlsFont.stringWidth(closeMsg);
+    controlsFont.drawString(closeMsg, overlayX + overlayWidth/2 - closeMsgWidth/2, textY);
 }
 
-    ofPopMatrix(); // End screen shake transform
-
+//--------------------------------------------------------------
+void ofApp::drawProfilerOverlay(){
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+    float x = 10;
+    float y = 20;
+    ofDrawBitmapStringHighlight("FPS: " + ofToString(ofGetFrameRate(), 1) + "  frame: " + ofToString(ofGetLastFrameTime() * 1000.0f, 2) + " ms", x, y);
+    y += 18;
+    ofDrawBitmapStringHighlight("creatures: " + ofToString(gameScene->GetAquarium()->getCreatureCount())
+                                + "  particles: " + ofToString(particles.size())
+                                + "  ripples: " + ofToString(ripples.size())
+                                + "  sprite draw calls: " + ofToString(SpriteBatch::Get().getLastDrawCalls())
+                                + "  hud repaints: " + ofToString(lastHudRepaints), x, y);
+    y += 18;
+    ofDrawBitmapStringHighlight("sfx voices: " + ofToString(sfx.getActiveVoices()) + "/" + ofToString(SfxMixer::MAX_VOICES)
+                                + "  dropped: " + ofToString(sfx.getDroppedTriggers()), x, y);
+    y += 18;
+    ofDrawBitmapStringHighlight("effects quality: " + std::string(QualityTierToString(quality.getTier()))
+                                + (quality.isAutomatic() ? " (auto)" : " (fixed)")
+                                + "  load: " + ofToString(quality.getLoad() * 100.0f, 0) + "% of frame budget"
+                                + "  bubbles: " + ofToString(waterBackground.getVisibleBubbles()), x, y);
+    y += 18;
+    const AiScheduler& ai = gameScene->GetAquarium()->getAiScheduler();
+    ofDrawBitmapStringHighlight("ai decisions/tick: " + ofToString(ai.getLastDecisions()) + "/" + ofToString(ai.getMaxDecisions())
+                                + "  deferred: " + ofToString(ai.getLastDeferred())
+                                + "  " + ofToString(ai.getLastMicros(), 0) + " us", x, y);
+    y += 18;
+    ofDrawBitmapStringHighlight("input to tick: " + ofToString(input.getInputToTick().lastMicros / 1000.0, 2) + " ms (avg "
+                                + ofToString(input.getInputToTick().averageMicros / 1000.0, 2) + ")  to frame: "
+                                + ofToString(input.getInputToFrame().lastMicros / 1000.0, 2) + " ms (avg "
+                                + ofToString(input.getInputToFrame().averageMicros / 1000.0, 2) + ")", x, y);
+    y += 18;
+
+    if(!AllocTracker::ENABLED){
+        ofDrawBitmapStringHighlight("allocation tracking off (define AQUARIUM_ALLOC_TRACKING)", x, y);
+        return;
+    }
+    ofDrawBitmapStringHighlight("subsystem  allocs/frame  bytes/frame      live KB  peak KB/frame", x, y);
+    y += 18;
+    for(int t = 0; t < static_cast<int>(AllocTag::COUNT); t++){
+        AllocStats stats = AllocTracker::GetStats(static_cast<AllocTag>(t));
+        char line[128];
+        snprintf(line, sizeof(line), "%-9s %12lld %12lld %12.1f %14.1f", AllocTagToString(static_cast<AllocTag>(t)),
+                 (long long)stats.frameAllocs, (long long)stats.frameBytes, stats.liveBytes / 1024.0, stats.framePeakBytes / 1024.0);
+        ofDrawBitmapStringHighlight(line, x, y);
+        y += 18;
+    }
+    ofDrawBitmapStringHighlight("sprite textures: " + ofToString(AllocTracker::GetTextureBytes() / (1024.0 * 1024.0), 2) + " MB", x, y);
 }
 
 //--------------------------------------------------------------
 void ofApp::exit(){
+    if(networkScene) networkScene->Disconnect();
     if (bgMusic.isPlaying()) bgMusic.stop();
     bgMusic.unload();
+    if(!options.recordPath.empty()){
+        recording.frames = updateFrame;
+        std::string path = ofToDataPath(options.recordPath, true);
+        ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(path), false, true);
+        if(recording.Save(path)){
+            ofLogNotice() << "Replay of " << updateFrame << " frames written to " << path << std::endl;
+        } else {
+            ofLogError() << "Could not write replay to " << path << std::endl;
+        }
+    }
+    if(options.inputLatency){
+        logInputLatency();
+    }
+    sfx.close();
+    snapshotWriter.stop(); // finish any snapshot still being written
+    metricsExporter.stop();
+    telemetry.stop(); // writes the last partial window
 }
 
 //--------------------------------------------------------------
-void ofApp::keyPressed(int key){
-  if(key == 'p'){ //activate boost
-    if(powerUpCharge > 0.0f){
-        powerUpActive = true; //start boost
+AquariumEffectTimers ofApp::captureEffectTimers() const {
+    AquariumEffectTimers timers;
+    timers.powerUpCharge = powerUpCharge;
+    timers.powerUpActive = powerUpActive;
+    timers.comboCount = comboCount;
+    timers.comboTimer = comboTimer;
+    timers.shakeIntensity = shakeIntensity;
+    timers.shakeDuration = shakeDuration;
+    timers.waterOverlayPulse = waterOverlayPulse;
+    return timers;
+}
+
+void ofApp::restoreEffectTimers(const AquariumEffectTimers& timers) {
+    powerUpCharge = timers.powerUpCharge;
+    powerUpActive = timers.powerUpActive;
+    comboCount = timers.comboCount;
+    comboTimer = timers.comboTimer;
+    shakeIntensity = timers.shakeIntensity;
+    shakeDuration = timers.shakeDuration;
+    waterOverlayPulse = timers.waterOverlayPulse;
+}
+
+void ofApp::saveSnapshot(){
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+    uint64_t start = ofGetElapsedTimeMicros();
+    std::vector<uint8_t> data;
+    AquariumSnapshot::Save(*gameScene->GetAquarium(), *gameScene->GetPlayer(), captureEffectTimers(), data);
+    ofLogNotice() << "Snapshot captured in " << (ofGetElapsedTimeMicros() - start) << " us" << std::endl;
+
+    ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(ofToDataPath(snapshotPath)), false, true);
+    snapshotWriter.enqueue(ofToDataPath(snapshotPath), std::move(data));
+}
+
+void ofApp::loadSnapshot(){
+    std::vector<uint8_t> data;
+    if(!AquariumSnapshot::ReadFile(ofToDataPath(snapshotPath), data)){
+        ofLogError() << "No snapshot found at " << snapshotPath << std::endl;
+        return;
+    }
+    auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
+    AquariumEffectTimers timers = captureEffectTimers();
+    uint64_t start = ofGetElapsedTimeMicros();
+    if(!AquariumSnapshot::Load(data, *gameScene->GetAquarium(), *gameScene->GetPlayer(), timers)){
+        return;
     }
+    ofLogNotice() << "Snapshot loaded in " << (ofGetElapsedTimeMicros() - start) << " us" << std::endl;
+    restoreEffectTimers(timers);
+    lastScore = gameScene->GetPlayer()->getScore(); // don't count the loaded score as a combo
+    lastLives = gameScene->GetPlayer()->getLives();
+    lastLevel = gameScene->GetAquarium()->getCurrentLevel();
+    gameScene->GetCamera().snapTo(gameScene->GetPlayer()->getX(), gameScene->GetPlayer()->getY());
+    particles.clear();
+    ripples.clear();
 }
-  
+
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key){
+  if(!options.recordPath.empty()){
+    recording.events.push_back(ReplayKeyEvent{updateFrame, true, key});
+  }
+
+  input.keyPressed(key, ofGetElapsedTimeMicros());
+  idleGeneration++; // an idle frame may show something else now
+
+  if(key == OF_KEY_F3){ //toggle profiler overlay
+    showProfilerOverlay = !showProfilerOverlay;
+    return;
+  }
+
   if(key == 'c' || key == 'C'){ //toggle controls overlay
     showControlsOverlay = !showControlsOverlay;
     return;
@@ -427,40 +1052,38 @@ void ofApp::keyPressed(int key){
         return; // Ignore other keys after game over
     }
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
-        switch(key){
-            case OF_KEY_UP:
-                gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, -1);
-                break;
-                case OF_KEY_DOWN:
-                gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, 1);
-                break;
-            case OF_KEY_LEFT:
-                gameScene->GetPlayer()->setDirection(-1, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-                gameScene->GetPlayer()->setFlipped(true);
-                break;
-                case OF_KEY_RIGHT:
-                gameScene->GetPlayer()->setDirection(1, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-                gameScene->GetPlayer()->setFlipped(false);
-                break;
-            default:
-                break;
+        if(key == OF_KEY_F5 || key == OF_KEY_F9){
+            if(!options.recordPath.empty()){
+                ofLogWarning() << "Snapshots are off while recording a replay" << std::endl;
+                return;
+            }
+            if(key == OF_KEY_F5) saveSnapshot();
+            else loadSnapshot();
+            return;
         }
-    
-        
-    
-        gameScene->GetPlayer()->move();
+        if(key == OF_KEY_SPACE){
+            setPaused(!paused);
+            return;
+        }
+        // movement and the boost are read from the input buffer by the next tick
         return;
 
     }
 
+    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::GAME_OVER)){
+        if(key == OF_KEY_SPACE){
+            restartGame();
+        }
+        return;
+    }
+
     if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::GAME_INTRO)){
         switch (key)
         {
         case OF_KEY_SPACE:
-            gameManager->Transition(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME));
+            gameManager->Transition(GameSceneKindToString(networkScene ? GameSceneKind::NETWORK_GAME : GameSceneKind::AQUARIUM_GAME));
             // start ambient music when entering aquarium scene
-            if (!bgMusic.isPlaying()) {
+            if (!options.headless && !bgMusic.isPlaying()) {
                 bgMusic.play();
                 ofLogNotice() << "Playing ambient music now!";
             }
@@ -478,26 +1101,12 @@ void ofApp::keyPressed(int key){
 
 //--------------------------------------------------------------
 void ofApp::keyReleased(int key){
-  
-if(key == 'p'){
-    powerUpActive = false; //stops boost when key released
-}
-
-    if(gameManager->GetActiveSceneName() == GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)){
-        auto gameScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetActiveScene());
-    if( key == OF_KEY_UP || key == OF_KEY_DOWN){
-        gameScene->GetPlayer()->setDirection(gameScene->GetPlayer()->isXDirectionActive()?gameScene->GetPlayer()->getDx():0, 0);
-        gameScene->GetPlayer()->move();
-        return;
-    }
-    
-    if(key == OF_KEY_LEFT || key == OF_KEY_RIGHT){
-        gameScene->GetPlayer()->setDirection(0, gameScene->GetPlayer()->isYDirectionActive()?gameScene->GetPlayer()->getDy():0);
-        gameScene->GetPlayer()->move();
-        return;
-    }
+  if(!options.recordPath.empty()){
+    recording.events.push_back(ReplayKeyEvent{updateFrame, false, key});
+  }
 
-    }
+  input.keyReleased(key);
+  idleGeneration++;
 }
 
 //--------------------------------------------------------------
@@ -538,10 +1147,13 @@ void ofApp::mouseExited(int x, int y){
 //--------------------------------------------------------------
 void ofApp::windowResized(int w, int h){
     backgroundImage.resize(w, h);
+    // the tank keeps its size, the camera just shows more or less of it
     auto aquariumScene = std::static_pointer_cast<AquariumGameScene>(gameManager->GetScene(GameSceneKindToString(GameSceneKind::AQUARIUM_GAME)));
-    aquariumScene->GetAquarium()->setBounds(w,h);
-    aquariumScene->GetPlayer()->setBounds(w - 20, h - 20);
-
+    aquariumScene->GetCamera().setViewport(w, h);
+    if(networkScene) networkScene->GetCamera().setViewport(w, h);
+    if(idleFrame.isAllocated()){
+        idleFrame.allocate(w, h);
+    }
 }
 
 //--------------------------------------------------------------
@@ -2,15 +2,19 @@
 
 #include "ofMain.h"
 #include "Aquarium.h"
+#include "Snapshot.h"
+#include "Metrics.h"
+#include "Replay.h"
+#include "WaterBackground.h"
+#include "SfxMixer.h"
+#include "InputBuffer.h"
+#include "QualityGovernor.h"
+#include "HudWidget.h"
+#include "Multiplayer.h"
+#include "Telemetry.h"
+#include "Soak.h"
 
 // Visual effects structures
-struct Bubble {
-    ofVec2f pos;
-    float size;
-    float speed;
-    float wobble;
-};
-
 struct Ripple {
     ofVec2f pos;
     float radius;
@@ -26,9 +30,44 @@ struct Particle {
     ofColor color; // Color of the particle
 };
 
+// Command line switches, see AppOptions::Parse
+struct AppOptions {
+	bool benchmark = false;                              // --benchmark
+	std::string benchmarkOut = "benchmarks/results.json"; // --benchmark_out=<file>, relative to bin/data
+	std::string benchmarkFilter;                         // --benchmark_filter=<regex>
+	double benchmarkMinSeconds = 0.2;                    // --benchmark_min_time=<seconds>
+	uint32_t seed = 0;                                   // --seed=<n>, 0 keeps openFrameworks' own seeding
+	std::string recordPath;                              // --record=<file>, replay written on exit
+	bool replayCheck = false;                            // --replay_check[=<dir>]
+	std::string replayDir = "replays";                   // relative to bin/data
+	bool replayUpdateBaseline = false;                   // --replay_update_baseline
+	bool headless = false;                               // set by the replay harness, no music or exporters
+	bool inputLatency = false;                           // --input_latency, logs input latency every few seconds
+	bool packAssets = false;                             // --pack_assets, writes bin/data/assets.aqpack and exits
+	bool checkPack = false;                              // --check_pack, loose images edited since packing win over the pack
+	uint16_t serverPort = 0;                             // --server[=<port>], headless authoritative tank, no window
+	std::string connectAddress;                          // --connect=<host:port>, join a server instead of playing alone
+	std::string renderReplay;                            // --render=<replay>, draws it offscreen to an image sequence and exits
+	std::string renderOut;                               // --render_out=<dir>, default renders/<replay name>
+	int renderEvery = 1;                                 // --render_every=<n>, keeps every nth frame
+	bool renderRaw = false;                              // --render_raw, raw RGB frames instead of PNG
+	std::string renderGolden;                            // --render_golden=<dir>, compares the frames to the PNGs in it
+	int renderTolerance = 8;                             // --render_tolerance=<0..255>, per channel
+	bool renderUpdateGolden = false;                     // --render_update_golden, writes the golden images instead
+	std::string heatmapPath;                             // --heatmap=<telemetry file>, writes heatmaps/<name>_<layer>.png and exits
+	double soakHours = 0;                                // --soak[=<game hours>], plays itself headless, default a week
+	double soakSampleMinutes = 10;                       // --soak_sample=<game minutes>
+	std::string soakOut = "soak/soak.csv";               // --soak_out=<file>, relative to bin/data
+	int soakDrawEvery = 60;                              // --soak_draw_every=<n>, 0 never draws
+
+	static AppOptions Parse(int argc, char* argv[]);
+};
+
 class ofApp : public ofBaseApp{
 
 	public:
+		AppOptions options;
+
 		void setup() override;
 		void update() override;
 		void draw() override;
@@ -48,7 +87,20 @@ class ofApp : public ofBaseApp{
 		void gotMessage(ofMessage msg) override;
 	
 		
-		char moveDirection;
+		// update() runs as many fixed 1/60 s ticks as the real time asks for, at most
+		// MAX_TICKS_PER_FRAME so a long stall doesn't turn into a burst of catch up
+		static constexpr double TICK_SECONDS = 1.0 / 60.0;
+		static constexpr int MAX_TICKS_PER_FRAME = 5;
+		double tickAccumulator = 0.0; // real seconds not yet turned into ticks
+		void simulationTick();
+
+		// keys go in here, simulationTick() samples it once per tick
+		InputBuffer input;
+		void applyInput();
+		ofVec2f inputDirection() const;
+		float inputLatencyLogTimer = 0.0f;
+		void logInputLatency();
+
 		int DEFAULT_SPEED = 5;
 
         float powerUpCharge = 100.0f;         
@@ -71,15 +123,56 @@ class ofApp : public ofBaseApp{
 
 	ofImage backgroundImage;
 
-    // Background ambient music for the aquarium scene
+    // Background ambient music for the aquarium scene, streamed
     ofSoundPlayer bgMusic;
+    // Sound effects, triggered from update when something happens
+    SfxMixer sfx;
+    int lastLives = 0; // to hear lives being lost
+    int lastLevel = 0; // to hear level changes
 
 	std::unique_ptr<GameSceneManager> gameManager;
 	std::shared_ptr<AquariumSpriteManager> spriteManager;
+	std::shared_ptr<Aquarium> createAquarium(int worldWidth, int worldHeight);
+	std::shared_ptr<PlayerCreature> createPlayer(int worldWidth, int worldHeight);
+	void restartGame();
+	// creature AI budget per tick (ai_decisions_per_tick, ai_budget_us in settings.xml)
+	int aiDecisionsPerTick = 2048;
+	double aiBudgetMicros = 0.0;
+
+	// Multiplayer (--server, --connect), see Multiplayer.h
+	std::unique_ptr<AquariumServer> server;
+	std::shared_ptr<NetworkGameScene> networkScene;
 	
 	// Controls overlay
 	bool showControlsOverlay = true;
 	float overlayAlpha = 220.0f;
+	void paintControlsOverlay(float overlayX, float overlayY, float overlayWidth, float overlayHeight, bool effects);
+
+	// HUD pieces cached in FBOs, repainted only when their values change
+	HudWidget powerBarWidget;
+	HudWidget comboWidget;
+	HudWidget controlsWidget;
+	ofVec2f comboWidgetSize; // grows with the biggest combo text so far
+	ofTrueTypeFont comboFont;
+	float comboFontSize = 0;
+	int lastHudRepaints = 0;
+
+	// Low power idle: the intro, game over and the paused tank (SPACE) don't change on
+	// their own, so their composed frame is cached in idleFrame and the app drops to
+	// idle_fps (settings.xml) until a key is pressed or the scene changes
+	bool paused = false;
+	bool lowPower = false;
+	int idleFrameRate = 10;
+	int idleGeneration = 0; // bumped by every key, part of the cached frame's key
+	HudWidget idleFrame;
+	bool isIdleScene() const;
+	void setPaused(bool pause);
+	void drawScene();
+	void paintPausedBanner();
+
+	// Profiler overlay (F3): frame time, counts and allocations per subsystem
+	bool showProfilerOverlay = false;
+	void drawProfilerOverlay();
 	
 	// Combo system
 	int comboCount = 0;
@@ -92,8 +185,33 @@ class ofApp : public ofBaseApp{
 	ofVec2f shakeOffset;
 	
 	// Visual effects
-	std::vector<Bubble> bubbles;
+	WaterBackground waterBackground;
+	double bubbleFrames = 0.0; // frames the bubbles have been rising, double so it never stalls
 	std::vector<Ripple> ripples;
+	static const size_t MAX_RIPPLES = 16;
 	std::vector<Particle> particles;
 	float waterOverlayPulse = 0.0f;
+	// scales the effects down when frames run over budget (effects_quality in settings.xml)
+	QualityGovernor quality;
+	uint64_t frameWorkStart = 0; // when this frame's update() started
+	int particleBurst(int fullCount) const;
+
+	// Operational metrics, configured in settings.xml
+	MetricsExporter metricsExporter;
+	// Player, creature and eat density grids (telemetry_file in settings.xml)
+	SpatialTelemetry telemetry;
+
+	// Snapshots (F5 save, F9 load)
+	int lastScore = 0; // used to detect the player eating something
+	AquariumSnapshotFileWriter snapshotWriter;
+	std::string snapshotPath = "snapshots/quicksave.aqsnap";
+	void runBenchmarks();
+
+	// Replays (--record, --replay_check)
+	int updateFrame = 0; // simulation ticks so far, replay events are stamped with it
+	ReplaySession recording;
+	void saveSnapshot();
+	void loadSnapshot();
+	AquariumEffectTimers captureEffectTimers() const;
+	void restoreEffectTimers(const AquariumEffectTimers& timers);
 };